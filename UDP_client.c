@@ -1,3 +1,4 @@
+#define _GNU_SOURCE // sendmmsg
 #include <netdb.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -5,11 +6,29 @@
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <time.h>
 #include <arpa/inet.h>
 #include "UDP_client.h"
+#include "ldc_time.h"
+
+#define ACK_SLOTS 256 // commands awaiting acknowledgement; older ones count as lost
 
 int UDP_fd=0;
 
+// Send times of the last ACK_SLOTS numbered commands, indexed by seq % ACK_SLOTS.
+// Acknowledgements carry the kernel's CLOCK_REALTIME arrival stamp (SO_TIMESTAMPNS),
+// so send times are on that clock too and the latency does not depend on how
+// often UDP_poll_acks() is called.
+struct ack_slot {
+    uint32_t seq;
+    uint64_t sent_ns;   // CLOCK_REALTIME, 0 once acknowledged
+};
+
+static int ack_on = 0;
+static uint32_t next_seq = 0;
+static struct ack_slot ack_slots[ACK_SLOTS];
+static struct udp_ack_stats ack;
+
 int UDP_init(char *ip, char *port){
 
     int sfd; // socket file descriptor
@@ -81,13 +100,121 @@ int UDP_send(union CMD_DATA data){
     ssize_t len = CMD_SIZE;
     ssize_t sent = 0;
 
-    sent = send(UDP_fd, data.bytes, len, 0);
-    if (sent != len) {
-        fprintf(stderr, "partial/failed write\n");
-    }
+    sent = send(UDP_fd, data.bytes, len, 0); // a short or failed write is the caller's to report
     return(sent);
 }
 
+void UDP_cmd_fill(struct cmd_frame *frame, int16_t value){
+    int16_t wire = (int16_t)htons((uint16_t)value); // swapped once, then a plain fill
+    for (int i = 0; i < CMD_CHANNELS; i++) {
+        frame->data.values[i] = wire;
+    }
+}
+
+// Stamp frame with the next sequence number and remember when it went out
+static void number_frame(struct cmd_frame *frame, uint64_t now){
+    uint32_t seq = ++next_seq;
+    frame->seq = htonl(seq);
+    ack_slots[seq % ACK_SLOTS] = (struct ack_slot){ seq, now };
+    ack.sent++;
+}
+
+int UDP_send_cmd(struct cmd_frame *frame){
+    size_t len = CMD_SIZE;
+    if (ack_on) {
+        number_frame(frame, ldc_realtime_ns());
+        len += sizeof(frame->seq);
+    }
+    return (int)send(UDP_fd, frame, len, 0);
+}
+
+int UDP_send_burst(struct cmd_frame *frames, int count){
+    struct mmsghdr msgs[CMD_MAX_BURST];
+    struct iovec iov[CMD_MAX_BURST];
+    size_t len = CMD_SIZE + (ack_on ? sizeof(frames->seq) : 0);
+    int done = 0;
+
+    memset(msgs, 0, sizeof(msgs));
+    while (done < count) {
+        int n = (count - done > CMD_MAX_BURST) ? CMD_MAX_BURST : count - done;
+        uint64_t now = ack_on ? ldc_realtime_ns() : 0;
+        for (int i = 0; i < n; i++) {
+            if (ack_on) number_frame(&frames[done + i], now);
+            iov[i].iov_base = &frames[done + i];
+            iov[i].iov_len = len;
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        int sent = sendmmsg(UDP_fd, msgs, n, 0);
+        if (sent < 0) {
+            if (ack_on) ack.sent -= n;
+            return (done > 0) ? done : -1;
+        }
+        if (ack_on) {
+            ack.sent -= n - sent; // the rest is numbered again when retried
+            UDP_poll_acks();      // before their slots are reused by the next chunk
+        }
+        done += sent;
+    }
+    return done;
+}
+
+void UDP_ack_enable(int on){
+    int opt = on;
+    // Without kernel stamps the arrival time falls back to when the acknowledgement is read
+    setsockopt(UDP_fd, SOL_SOCKET, SO_TIMESTAMPNS, &opt, sizeof(opt));
+    ack_on = on;
+}
+
+int UDP_poll_acks(void){
+    unsigned char buf[BUF_SIZE];
+    unsigned char control[CMSG_SPACE(sizeof(struct timespec))];
+    struct iovec iov = { buf, sizeof(buf) };
+    struct msghdr msg;
+    uint32_t seq;
+    int matched = 0;
+    ssize_t n;
+
+    for (;;) {
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        n = recvmsg(UDP_fd, &msg, MSG_DONTWAIT);
+        if (n < 0) break;
+        if (n < (ssize_t)sizeof(seq)) continue;
+
+        uint64_t now = 0;
+        for (struct cmsghdr *c = CMSG_FIRSTHDR(&msg); c != NULL; c = CMSG_NXTHDR(&msg, c)) {
+            if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPNS) {
+                struct timespec ts;
+                memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+                now = ldc_timespec_to_ns(&ts);
+            }
+        }
+        if (now == 0) now = ldc_realtime_ns();
+        memcpy(&seq, buf + n - sizeof(seq), sizeof(seq));
+        seq = ntohl(seq);
+        struct ack_slot *slot = &ack_slots[seq % ACK_SLOTS];
+        if (slot->seq != seq || slot->sent_ns == 0) {
+            continue; // not ours, a duplicate, or sent too long ago
+        }
+        uint64_t ns = (now > slot->sent_ns) ? now - slot->sent_ns : 0;
+        slot->sent_ns = 0;
+        if (ack.acked == 0 || ns < ack.min_ns) ack.min_ns = ns;
+        if (ns > ack.max_ns) ack.max_ns = ns;
+        ack.sum_ns += ns;
+        ack.acked++;
+        matched++;
+    }
+    return matched;
+}
+
+void UDP_ack_stats(struct udp_ack_stats *out){
+    *out = ack;
+}
+
 
 
 #ifdef UDP_TESTING
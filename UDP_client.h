@@ -1,3 +1,6 @@
+#ifndef INC_UDP_CLIENT_H_
+#define INC_UDP_CLIENT_H_
+
 #include <netdb.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -5,6 +8,7 @@
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <stdint.h>
 #include <arpa/inet.h>
 
 #define BUF_SIZE 500
@@ -25,3 +29,63 @@ union CMD_DATA {
 int UDP_init(char *ip, char *port);
 
 int UDP_send(union CMD_DATA data);
+
+#define CMD_CHANNELS  (CMD_SIZE/2) // actuator channels per command
+#define CMD_MAX_BURST 64           // commands per UDP_send_burst() system call
+
+/*
+ * Command frame kept in network byte order, so channels are updated one at a
+ * time as they change and the frame is sent as is, without conversion or copy.
+ * With acknowledgements on, a sequence number follows the 52 command bytes and
+ * the KASM board is expected to send it back: any datagram ending in the
+ * 4-byte sequence number (e.g. an echo of the frame) acknowledges it.
+ */
+struct cmd_frame {
+    union CMD_DATA data;    // network byte order
+    uint32_t seq;           // network byte order, sent only with acknowledgements on
+} __attribute__((packed));
+
+// Acknowledgement latency of sequence-numbered commands
+struct udp_ack_stats {
+    uint64_t sent;          // sequence-numbered commands sent
+    uint64_t acked;         // matched by an acknowledgement
+    uint64_t sum_ns;
+    uint64_t min_ns;
+    uint64_t max_ns;
+};
+
+// Set one actuator channel
+static inline void UDP_cmd_set(struct cmd_frame *frame, int channel, int16_t value) {
+    frame->data.values[channel] = (int16_t)htons((uint16_t)value);
+}
+
+// Set every actuator channel to the same value
+void UDP_cmd_fill(struct cmd_frame *frame, int16_t value);
+
+/**
+ * @brief: sends a command frame as is, numbering it first if acknowledgements are on
+ * @return: bytes sent, -1 on failure
+ */
+int UDP_send_cmd(struct cmd_frame *frame);
+
+/**
+ * @brief: sends a scripted sequence of command frames with as few system calls as possible (sendmmsg)
+ * @param: frames to send in order, numbered first if acknowledgements are on
+ * @param: count number of frames
+ * @return: frames sent, -1 if the first one failed
+ */
+int UDP_send_burst(struct cmd_frame *frames, int count);
+
+// Turn sequence numbers and acknowledgement tracking on (1) or off (0)
+void UDP_ack_enable(int on);
+
+/**
+ * @brief: reads the acknowledgements that have arrived, without blocking
+ * @return: acknowledgements matched to a command sent
+ */
+int UDP_poll_acks(void);
+
+// Copy the acknowledgement statistics
+void UDP_ack_stats(struct udp_ack_stats *out);
+
+#endif /* INC_UDP_CLIENT_H_ */
@@ -0,0 +1,65 @@
+/*
+ * bench.h
+ *
+ * Shared helpers for the benchmark programs.
+ *
+ * Every result is printed as one JSON object per line on stdout, tagged with
+ * the benchmark name and $BENCH_REV (set by `make bench` to the git commit),
+ * so runs from different commits can be collected and compared by line.
+ */
+
+#ifndef INC_BENCH_H_
+#define INC_BENCH_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../ldc_time.h"
+
+// CPU time consumed by the calling thread
+static inline uint64_t bench_thread_cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ldc_timespec_to_ns(&ts);
+}
+
+static int bench_cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static inline void bench_sort(uint64_t *v, size_t n) {
+    qsort(v, n, sizeof(*v), bench_cmp_u64);
+}
+
+// p-th percentile (0..1) of n values sorted with bench_sort()
+static inline uint64_t bench_percentile(const uint64_t *v, size_t n, double p) {
+    if (n == 0) return 0;
+    return v[(size_t)(p * (n - 1) + 0.5)];
+}
+
+/**
+ * @brief Start a result line: {"bench":"<bench>","case":"<name>","rev":"<BENCH_REV>"
+ * @note Add fields with bench_field_*() and finish the line with bench_end().
+ */
+static inline void bench_begin(const char *bench, const char *name) {
+    const char *rev = getenv("BENCH_REV");
+    printf("{\"bench\":\"%s\",\"case\":\"%s\",\"rev\":\"%s\"", bench, name, rev ? rev : "");
+}
+
+static inline void bench_field_u64(const char *key, uint64_t value) {
+    printf(",\"%s\":%llu", key, (unsigned long long)value);
+}
+
+static inline void bench_field_f(const char *key, double value) {
+    printf(",\"%s\":%.3f", key, value);
+}
+
+static inline void bench_end(void) {
+    printf("}\n");
+    fflush(stdout);
+}
+
+#endif /* INC_BENCH_H_ */
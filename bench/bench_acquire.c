@@ -0,0 +1,133 @@
+// Per-sample cost of the acquisition path: burst reads and full polling iterations.
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "bench.h"
+#include "../ldc1614.h"
+#include "../ldc_bus.h"
+#include "../ldc_sim.h"
+#include "../ldc_event.h"
+#include "../ldc_ring.h"
+
+#define BENCH "acquire"
+
+static struct ldc_ring rings[LDC1614_NUM_CHANNELS];
+
+static int open_device(struct ldc_bus *bus, const char *spec, uint8_t channel_mask) {
+    struct ldc1614_channel_config channels[LDC1614_NUM_CHANNELS];
+    for (int ch = 0; ch < LDC1614_NUM_CHANNELS; ch++) {
+        // Shortest sensible conversion so the simulator is never the bottleneck
+        channels[ch] = (struct ldc1614_channel_config){0x0100, 0x000A, 0x1001, 0xB000};
+    }
+    if (ldc_bus_open(bus, spec, LDC1614_ADDR) != 0) return -1;
+    if (ldc1614_configure(bus, channel_mask, channels, error_config) != 0) {
+        ldc_bus_close(bus);
+        return -1;
+    }
+    return 0;
+}
+
+// Back-to-back STATUS + DATA bursts, the floor of every sample
+static int bench_burst(const char *spec, uint8_t channel_mask, long iterations) {
+    struct ldc_bus bus;
+    struct ldc1614_burst burst;
+    char name[32];
+
+    if (open_device(&bus, spec, channel_mask) != 0) return -1;
+    uint64_t t0 = ldc_now_ns(), cpu0 = bench_thread_cpu_ns();
+    for (long i = 0; i < iterations; i++) {
+        if (ldc1614_read_burst(&bus, channel_mask, &burst) != 0) {
+            perror("Burst read failed");
+            ldc_bus_close(&bus);
+            return -1;
+        }
+    }
+    uint64_t wall = ldc_now_ns() - t0, cpu = bench_thread_cpu_ns() - cpu0;
+
+    snprintf(name, sizeof(name), "burst_mask_0x%X", channel_mask);
+    bench_begin(BENCH, name);
+    bench_field_u64("reads", iterations);
+    bench_field_f("ns_per_read", (double)wall / iterations);
+    bench_field_f("cpu_ns_per_read", (double)cpu / iterations);
+    bench_end();
+    ldc_bus_close(&bus);
+    return 0;
+}
+
+// What polling_worker does per data-ready event: wait, burst read, publish every channel
+static int bench_poll(const char *spec, uint8_t channel_mask, long iterations) {
+    struct ldc_bus bus;
+    struct ldc_event_source src;
+    struct ldc1614_burst burst;
+    uint64_t samples = 0, overruns = 0;
+    char name[32];
+
+    if (open_device(&bus, spec, channel_mask) != 0) return -1;
+    if (ldc_bus_is_sim(&bus) ? ldc_event_open_sim(&src, &bus)
+                             : ldc_event_open_gpio(&src, LDC_GPIO_CHIP, LDC_INTB_LINE)) {
+        ldc_bus_close(&bus);
+        return -1;
+    }
+    for (int ch = 0; ch < LDC1614_NUM_CHANNELS; ch++) {
+        ldc_ring_init(&rings[ch]);
+    }
+
+    uint64_t t0 = ldc_now_ns(), cpu0 = bench_thread_cpu_ns();
+    for (long i = 0; i < iterations; i++) {
+        uint64_t t_event = 0;
+        if (src.wait(&src, 100, &t_event) < 0) break;
+        if (ldc1614_read_burst(&bus, channel_mask, &burst) != 0) continue;
+        for (int ch = 0; ch < LDC1614_NUM_CHANNELS; ch++) {
+            if (!(channel_mask & (1 << ch))) continue;
+            ldc_ring_publish(&rings[ch], t_event, burst.value[ch], burst.errors[ch]);
+            samples++;
+        }
+    }
+    uint64_t wall = ldc_now_ns() - t0, cpu = bench_thread_cpu_ns() - cpu0;
+    overruns = src.overruns;
+
+    snprintf(name, sizeof(name), "poll_mask_0x%X", channel_mask);
+    bench_begin(BENCH, name);
+    bench_field_u64("samples", samples);
+    bench_field_f("samples_per_sec", samples * 1e9 / wall);
+    bench_field_f("ns_per_sample", (double)wall / samples);
+    bench_field_f("cpu_ns_per_sample", (double)cpu / samples);
+    bench_field_f("cpu_load", (double)cpu / wall);
+    bench_field_u64("overruns", overruns);
+    bench_end();
+    ldc_event_close(&src);
+    ldc_bus_close(&bus);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int opt = 0;
+    const char *spec = "sim:virtual"; // full speed on any host
+    long iterations = 200000;
+
+    while ((opt = getopt(argc, argv, "hd:n:")) != -1) {
+        switch (opt) {
+            case 'd':
+                spec = optarg;
+                break;
+            case 'n':
+                iterations = atol(optarg);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-d bus] [-n iterations]\n", argv[0]);
+                return (opt == 'h') ? 0 : -1;
+        }
+    }
+    if (iterations <= 0) {
+        fprintf(stderr, "Number of iterations must be greater than 0\n");
+        return -1;
+    }
+
+    if (bench_burst(spec, 0x01, iterations) != 0 || bench_burst(spec, 0x0F, iterations) != 0 ||
+        bench_poll(spec, 0x01, iterations) != 0 || bench_poll(spec, 0x0F, iterations) != 0) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,160 @@
+// Actuator command throughput and acknowledgement latency over loopback, against a local sink.
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "bench.h"
+#include "../UDP_client.h"
+
+#define BENCH "cmd"
+
+struct sink {
+    pthread_t thread;
+    int sock;
+    int echo;                   // send every datagram back, acknowledging it
+    _Atomic uint64_t received;
+    _Atomic int stop;
+};
+
+static void *sink_thread(void *arg) {
+    struct sink *s = arg;
+    uint8_t buf[BUF_SIZE];
+    struct sockaddr_storage from;
+
+    while (!atomic_load(&s->stop)) {
+        socklen_t from_len = sizeof(from);
+        ssize_t n = recvfrom(s->sock, buf, sizeof(buf), 0, (struct sockaddr *)&from, &from_len);
+        if (n < 0) continue; // receive timeout, check stop
+        atomic_fetch_add(&s->received, 1);
+        if (s->echo) sendto(s->sock, buf, n, 0, (struct sockaddr *)&from, from_len);
+    }
+    return NULL;
+}
+
+// The command path main.c had before: fill and swap every slot, pass the union by value
+static int legacy_send(int16_t value) {
+    union CMD_DATA buf_data;
+    for (int i = 0; i < CMD_SIZE/2; i++) {
+        buf_data.values[i] = htons(value);
+    }
+    return UDP_send(buf_data);
+}
+
+static void report(const char *name, long count, uint64_t wall, const struct sink *s, uint64_t received0) {
+    bench_begin(BENCH, name);
+    bench_field_u64("commands", count);
+    bench_field_f("commands_per_sec", count * 1e9 / wall);
+    bench_field_f("ns_per_command", (double)wall / count);
+    bench_field_u64("received", atomic_load(&s->received) - received0);
+    bench_end();
+}
+
+int main(int argc, char *argv[]) {
+    int opt = 0;
+    int port = 5599;
+    long count = 200000;
+    char port_arg[16];
+    static struct cmd_frame frames[CMD_MAX_BURST];
+    struct cmd_frame frame;
+    struct sink sink = { 0 };
+    struct sockaddr_in addr = { .sin_family = AF_INET };
+    struct timeval tv = { 0, 100000 };
+
+    while ((opt = getopt(argc, argv, "hp:n:")) != -1) {
+        switch (opt) {
+            case 'p':
+                port = atoi(optarg);
+                break;
+            case 'n':
+                count = atol(optarg);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-p port] [-n commands per case]\n", argv[0]);
+                return (opt == 'h') ? 0 : -1;
+        }
+    }
+
+    sink.sock = socket(AF_INET, SOCK_DGRAM, 0);
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    setsockopt(sink.sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    if (bind(sink.sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        perror("Failed to bind the sink");
+        return 1;
+    }
+    pthread_create(&sink.thread, NULL, sink_thread, &sink);
+
+    snprintf(port_arg, sizeof(port_arg), "%d", port);
+    if (UDP_init("127.0.0.1", port_arg) < 0) {
+        return 1;
+    }
+
+    // Same value in every slot, as the open-loop staircase sends it
+    uint64_t received0 = atomic_load(&sink.received);
+    uint64_t t0 = ldc_now_ns();
+    for (long i = 0; i < count; i++) {
+        legacy_send((int16_t)i);
+    }
+    report("legacy_fill_send", count, ldc_now_ns() - t0, &sink, received0);
+
+    received0 = atomic_load(&sink.received);
+    t0 = ldc_now_ns();
+    for (long i = 0; i < count; i++) {
+        UDP_cmd_fill(&frame, (int16_t)i);
+        UDP_send_cmd(&frame);
+    }
+    report("frame_fill_send", count, ldc_now_ns() - t0, &sink, received0);
+
+    // One channel changing per command: only that slot is rewritten
+    UDP_cmd_fill(&frame, 0);
+    received0 = atomic_load(&sink.received);
+    t0 = ldc_now_ns();
+    for (long i = 0; i < count; i++) {
+        UDP_cmd_set(&frame, i % CMD_CHANNELS, (int16_t)i);
+        UDP_send_cmd(&frame);
+    }
+    report("frame_set_send", count, ldc_now_ns() - t0, &sink, received0);
+
+    for (int i = 0; i < CMD_MAX_BURST; i++) {
+        UDP_cmd_fill(&frames[i], (int16_t)(i * 100));
+    }
+    received0 = atomic_load(&sink.received);
+    t0 = ldc_now_ns();
+    for (long i = 0; i < count; i += CMD_MAX_BURST) {
+        UDP_send_burst(frames, CMD_MAX_BURST);
+    }
+    report("burst_64", (count + CMD_MAX_BURST - 1) / CMD_MAX_BURST * CMD_MAX_BURST,
+           ldc_now_ns() - t0, &sink, received0);
+
+    // Acknowledged one at a time: the round trip to an echoing board
+    struct udp_ack_stats stats;
+    long acked_count = count / 10;
+    sink.echo = 1;
+    UDP_ack_enable(1);
+    for (long i = 0; i < acked_count; i++) {
+        UDP_send_cmd(&frame);
+        uint64_t deadline = ldc_now_ns() + 100000000; // a lost echo counts as unacknowledged
+        while (UDP_poll_acks() == 0 && ldc_now_ns() < deadline) {
+        }
+    }
+    UDP_ack_stats(&stats);
+    bench_begin(BENCH, "ack_round_trip");
+    bench_field_u64("commands", stats.sent);
+    bench_field_u64("acked", stats.acked);
+    bench_field_f("mean_us", stats.acked ? stats.sum_ns / 1e3 / stats.acked : 0.0);
+    bench_field_f("min_us", stats.min_ns / 1e3);
+    bench_field_f("max_us", stats.max_ns / 1e3);
+    bench_end();
+
+    atomic_store(&sink.stop, 1);
+    pthread_join(sink.thread, NULL);
+    close(sink.sock);
+    return 0;
+}
@@ -0,0 +1,105 @@
+// Throughput of the sample handoff between the polling thread and its readers.
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "bench.h"
+#include "../ldc_ring.h"
+
+#define BENCH "ring"
+#define MAX_READERS 8
+#define READ_BATCH  64
+
+static struct ldc_ring ring;
+static _Atomic int done;
+
+struct reader {
+    pthread_t thread;
+    uint64_t samples;   // samples copied
+    uint64_t lost;      // samples overwritten before this reader got to them
+    uint64_t torn;      // samples whose value did not match their sequence number
+};
+
+static void *reader_thread(void *arg) {
+    struct reader *r = arg;
+    struct ldc_sample buf[READ_BATCH];
+    uint64_t next = 1;
+
+    while (!atomic_load_explicit(&done, memory_order_relaxed) || next <= ldc_ring_head(&ring)) {
+        uint64_t want = next;
+        size_t n = ldc_ring_read_since(&ring, &next, buf, READ_BATCH);
+        if (n == 0) continue;
+        r->lost += buf[0].seq - want;
+        for (size_t i = 0; i < n; i++) {
+            // The publisher writes value = seq, so anything else is a torn copy
+            if (buf[i].value != (uint32_t)buf[i].seq) r->torn++;
+        }
+        r->samples += n;
+    }
+    return NULL;
+}
+
+static void run(int num_readers, uint64_t samples) {
+    struct reader readers[MAX_READERS];
+    char name[32];
+
+    ldc_ring_init(&ring);
+    atomic_store(&done, 0);
+    memset(readers, 0, sizeof(readers));
+    for (int i = 0; i < num_readers; i++) {
+        pthread_create(&readers[i].thread, NULL, reader_thread, &readers[i]);
+    }
+
+    uint64_t t0 = ldc_now_ns(), cpu0 = bench_thread_cpu_ns();
+    for (uint64_t seq = 1; seq <= samples; seq++) {
+        ldc_ring_publish(&ring, seq, (uint32_t)seq, 0);
+    }
+    uint64_t wall = ldc_now_ns() - t0, cpu = bench_thread_cpu_ns() - cpu0;
+    atomic_store(&done, 1);
+
+    uint64_t read = 0, lost = 0, torn = 0;
+    for (int i = 0; i < num_readers; i++) {
+        pthread_join(readers[i].thread, NULL);
+        read += readers[i].samples;
+        lost += readers[i].lost;
+        torn += readers[i].torn;
+    }
+
+    snprintf(name, sizeof(name), "publish_%d_readers", num_readers);
+    bench_begin(BENCH, name);
+    bench_field_u64("samples", samples);
+    bench_field_f("publish_per_sec", samples * 1e9 / wall);
+    bench_field_f("publish_cpu_ns", (double)cpu / samples);
+    if (num_readers > 0) {
+        // Publishing is unpaced, so readers get lapped; lost counts what they skipped
+        bench_field_f("reads_per_sec_per_reader", read * 1e9 / wall / num_readers);
+        bench_field_u64("lost", lost);
+        bench_field_u64("torn", torn);
+    }
+    bench_end();
+}
+
+int main(int argc, char *argv[]) {
+    int opt = 0;
+    uint64_t samples = 20000000;
+
+    while ((opt = getopt(argc, argv, "hn:")) != -1) {
+        switch (opt) {
+            case 'n':
+                samples = strtoull(optarg, NULL, 10);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-n samples]\n", argv[0]);
+                return (opt == 'h') ? 0 : -1;
+        }
+    }
+
+    int counts[] = {0, 1, 2, 4};
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        run(counts[i], samples);
+    }
+    return 0;
+}
@@ -0,0 +1,151 @@
+// Local read cost through the shared-memory sample store against a UDP round trip to the same service.
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "bench.h"
+#include "../ldc_shm.h"
+
+#define BENCH "shm"
+#define SHM_NAME "/ldc_bench_shm"
+
+// Short conversions on all four channels, about 1.2 kHz per channel
+static char *service_args[] = {
+    NULL, "-d", "sim", "-c", "0,1,2,3", "-p", NULL, "-m", SHM_NAME,
+    "-C", "0,0x0200,0x000A,0x1001,0xB000", "-C", "1,0x0200,0x000A,0x1001,0xB000",
+    "-C", "2,0x0200,0x000A,0x1001,0xB000", "-C", "3,0x0200,0x000A,0x1001,0xB000", NULL,
+};
+
+// Legacy single-byte request for CH0, connected socket; returns the round trip or UINT64_MAX
+static uint64_t udp_latest(int sock) {
+    uint8_t req = 0, reply[64];
+    uint64_t t0 = ldc_now_ns();
+    send(sock, &req, 1, 0);
+    if (recv(sock, reply, sizeof(reply), 0) < 0) return UINT64_MAX;
+    return ldc_now_ns() - t0;
+}
+
+static void report_rtt(const char *name, uint64_t *v, size_t n) {
+    bench_sort(v, n);
+    bench_begin(BENCH, name);
+    bench_field_u64("reads", n);
+    bench_field_f("p50_us", bench_percentile(v, n, 0.50) / 1e3);
+    bench_field_f("p99_us", bench_percentile(v, n, 0.99) / 1e3);
+    bench_field_f("max_us", n ? v[n - 1] / 1e3 : 0.0);
+    bench_end();
+}
+
+int main(int argc, char *argv[]) {
+    int opt = 0;
+    const char *service = "./ldc_service";
+    int port = 5498;
+    long reads = 20000;
+    char port_arg[16];
+
+    while ((opt = getopt(argc, argv, "hs:p:n:")) != -1) {
+        switch (opt) {
+            case 's':
+                service = optarg;
+                break;
+            case 'p':
+                port = atoi(optarg);
+                break;
+            case 'n':
+                reads = atol(optarg);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-s path/to/ldc_service] [-p port] [-n reads per case]\n", argv[0]);
+                return (opt == 'h') ? 0 : -1;
+        }
+    }
+
+    snprintf(port_arg, sizeof(port_arg), "%d", port);
+    service_args[0] = (char *)service;
+    service_args[6] = port_arg;
+    pid_t pid = fork();
+    if (pid == 0) {
+        freopen("/dev/null", "w", stdout); // keep the JSON output clean
+        execv(service, service_args);
+        perror("Failed to start ldc_service");
+        _exit(127);
+    }
+
+    // The segment exists once the service answers UDP
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(port) };
+    struct timeval tv = { 0, 100000 };
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    connect(sock, (struct sockaddr *)&addr, sizeof(addr));
+    int ready = 0;
+    for (int i = 0; i < 50 && pid > 0 && !ready; i++) {
+        ready = (udp_latest(sock) != UINT64_MAX);
+        if (!ready) usleep(100000);
+    }
+    struct ldc_shm shm;
+    if (!ready || ldc_shm_open(&shm, SHM_NAME) != 0) {
+        fprintf(stderr, "ldc_service did not come up on port %d\n", port);
+        if (pid > 0) kill(pid, SIGKILL);
+        return 1;
+    }
+    const struct ldc_ring *ring = ldc_shm_ring(&shm, 0);
+    uint64_t *v = calloc(reads, sizeof(*v));
+    struct ldc_sample sample;
+
+    // Latest value straight from the ring: no system call
+    uint64_t sum = 0;
+    uint64_t t0 = ldc_now_ns();
+    for (long i = 0; i < reads; i++) {
+        ldc_ring_latest(ring, &sample);
+        sum += sample.value;
+    }
+    uint64_t wall = ldc_now_ns() - t0;
+    bench_begin(BENCH, "shm_latest");
+    bench_field_u64("reads", reads);
+    bench_field_f("ns_per_read", (double)wall / reads);
+    bench_field_u64("checksum", sum & 0xFFFF);
+    bench_end();
+
+    size_t n = 0;
+    for (long i = 0; i < reads; i++) {
+        uint64_t rtt = udp_latest(sock);
+        if (rtt != UINT64_MAX) v[n++] = rtt;
+    }
+    report_rtt("udp_latest", v, n);
+
+    // Blocking reader: age of the newest sample when the futex wakeup arrives
+    long wakes = reads / 20, empty = 0;
+    uint32_t seen = ldc_shm_generation(&shm);
+    uint64_t next = ldc_ring_head(ring) + 1;
+    n = 0;
+    for (long i = 0; i < wakes; i++) {
+        if (ldc_shm_wait(&shm, &seen, 1000) != 1) break;
+        uint64_t now = ldc_now_ns();
+        if (ldc_ring_read_since(ring, &next, &sample, 1) == 0) {
+            empty++;
+            continue;
+        }
+        next = ldc_ring_head(ring) + 1;
+        ldc_ring_latest(ring, &sample);
+        v[n++] = (now > sample.t_ns) ? now - sample.t_ns : 0;
+    }
+    report_rtt("shm_wait_sample_age", v, n);
+    bench_begin(BENCH, "shm_wait");
+    bench_field_u64("wakeups", n + empty);
+    bench_field_u64("without_new_ch0", empty);
+    bench_end();
+
+    free(v);
+    close(sock);
+    ldc_shm_close(&shm);
+    kill(pid, SIGINT);
+    waitpid(pid, NULL, 0);
+    return 0;
+}
@@ -0,0 +1,184 @@
+// Bus trace recording overhead and replay speed, checking that each replay returns the recorded samples.
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "bench.h"
+#include "../ldc1614.h"
+#include "../ldc_bus.h"
+#include "../ldc_event.h"
+#include "../ldc_trace.h"
+
+#define BENCH "trace"
+#define WAIT_TIMEOUT_MS 100 // as ldc_service's polling thread
+
+struct run {
+    uint32_t *values;        // every new conversion, in the order read
+    long count;
+    long capacity;
+    long reads;
+    uint64_t wall_ns;
+};
+
+static int open_device(struct ldc_bus *bus, const char *spec, uint8_t channel_mask, uint16_t rcount) {
+    struct ldc1614_channel_config channels[LDC1614_NUM_CHANNELS];
+    for (int ch = 0; ch < LDC1614_NUM_CHANNELS; ch++) {
+        channels[ch] = (struct ldc1614_channel_config){rcount, 0x000A, 0x1001, 0xB000};
+    }
+    if (ldc_bus_open(bus, spec, LDC1614_ADDR) != 0) return -1;
+    if (ldc1614_configure(bus, channel_mask, channels, error_config) != 0) {
+        ldc_bus_close(bus);
+        return -1;
+    }
+    return 0;
+}
+
+// Keep the new conversions of one burst
+static void collect(struct run *r, const struct ldc1614_burst *burst, uint8_t channel_mask) {
+    for (int ch = 0; ch < LDC1614_NUM_CHANNELS; ch++) {
+        if (!(channel_mask & (1 << ch)) || !(burst->status & LDC1614_UNREADCONV(ch))) continue;
+        if (r->count < r->capacity) r->values[r->count++] = burst->value[ch];
+    }
+}
+
+// Back-to-back bursts without waiting, on a bus that records, replays or neither
+static int run_bursts(const char *spec, uint8_t channel_mask, long iterations, struct run *r) {
+    struct ldc_bus bus;
+    struct ldc1614_burst burst;
+
+    if (open_device(&bus, spec, channel_mask, 0x0100) != 0) return -1;
+    uint64_t t0 = ldc_now_ns();
+    for (r->reads = 0; r->reads < iterations; r->reads++) {
+        if (ldc1614_read_burst(&bus, channel_mask, &burst) != 0) break;
+        collect(r, &burst, channel_mask);
+    }
+    r->wall_ns = ldc_now_ns() - t0;
+    ldc_bus_close(&bus);
+    return 0;
+}
+
+// The polling thread's loop: wait with its timeout and read after timeouts too
+static int run_polling(const char *spec, uint8_t channel_mask, uint16_t rcount, int waits, struct run *r) {
+    struct ldc_bus bus;
+    struct ldc_event_source src;
+    struct ldc1614_burst burst;
+    struct ldc1614_channel_config channels[LDC1614_NUM_CHANNELS];
+
+    if (open_device(&bus, spec, channel_mask, rcount) != 0) return -1;
+    for (int ch = 0; ch < LDC1614_NUM_CHANNELS; ch++) {
+        channels[ch] = (struct ldc1614_channel_config){rcount, 0x000A, 0x1001, 0xB000};
+    }
+    if (ldc_bus_is_replay(&bus)) {
+        ldc_event_open_replay(&src, &bus);
+    } else {
+        ldc_event_open_timer(&src, ldc1614_sequence_period_ns(channel_mask, channels, LDC1614_FREF_HZ));
+        if (ldc_bus_is_recording(&bus)) ldc_event_record(&src, &bus);
+    }
+    uint64_t t0 = ldc_now_ns();
+    for (int i = 0; i < waits; i++) {
+        uint64_t t_event = 0;
+        if (src.wait(&src, WAIT_TIMEOUT_MS, &t_event) < 0) break;
+        if (ldc1614_read_burst(&bus, channel_mask, &burst) != 0) break;
+        r->reads++;
+        collect(r, &burst, channel_mask);
+    }
+    r->wall_ns = ldc_now_ns() - t0;
+    ldc_event_close(&src);
+    ldc_bus_close(&bus);
+    return 0;
+}
+
+// Samples of the replay that differ from the recording, or are missing from it
+static long mismatches(const struct run *rec, const struct run *rep) {
+    long n = labs(rec->count - rep->count);
+    for (long i = 0; i < rec->count && i < rep->count; i++) {
+        n += (rec->values[i] != rep->values[i]);
+    }
+    return n;
+}
+
+static void report(const char *name, const struct run *rec, const struct run *r) {
+    bench_begin(BENCH, name);
+    bench_field_u64("reads", r->reads);
+    bench_field_u64("samples", r->count);
+    bench_field_f("ns_per_read", r->reads ? (double)r->wall_ns / r->reads : 0.0);
+    bench_field_f("wall_ms", r->wall_ns / 1e6);
+    if (rec != NULL) bench_field_u64("mismatches", mismatches(rec, r));
+    bench_end();
+}
+
+static int init_run(struct run *r, long capacity) {
+    memset(r, 0, sizeof(*r));
+    r->values = calloc(capacity, sizeof(*r->values));
+    r->capacity = capacity;
+    return (r->values != NULL) ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+    int opt = 0;
+    long iterations = 100000;
+    int waits = 8;
+    char path[64], spec[128];
+    struct run plain, rec, fast, slow;
+    long bad = 0;
+
+    while ((opt = getopt(argc, argv, "hn:w:")) != -1) {
+        switch (opt) {
+            case 'n':
+                iterations = atol(optarg);
+                break;
+            case 'w':
+                waits = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-n burst reads] [-w waits of the long-period case]\n", argv[0]);
+                return (opt == 'h') ? 0 : -1;
+        }
+    }
+    if (iterations <= 0 || waits <= 0) {
+        fprintf(stderr, "Number of reads and waits must be greater than 0\n");
+        return -1;
+    }
+    snprintf(path, sizeof(path), "/tmp/bench_trace.%d.trc", (int)getpid());
+    long capacity = iterations * LDC1614_NUM_CHANNELS;
+    if (init_run(&plain, capacity) != 0 || init_run(&rec, capacity) != 0 || init_run(&fast, capacity) != 0 ||
+        init_run(&slow, capacity) != 0) {
+        fprintf(stderr, "Failed to allocate the sample buffers\n");
+        return 1;
+    }
+
+    // Throughput: what recording adds to a burst read, and how fast a trace plays back
+    snprintf(spec, sizeof(spec), "record:%s:sim:virtual", path);
+    if (run_bursts("sim:virtual", 0x0F, iterations, &plain) != 0 || run_bursts(spec, 0x0F, iterations, &rec) != 0) {
+        return 1;
+    }
+    snprintf(spec, sizeof(spec), "replay:%s:fast", path);
+    if (run_bursts(spec, 0x0F, iterations, &fast) != 0) return 1;
+    report("burst_plain", NULL, &plain);
+    report("burst_record", NULL, &rec);
+    report("burst_replay_fast", &rec, &fast);
+    bad += mismatches(&rec, &fast);
+
+    // A sequence longer than the wait timeout (4 channels at RCOUNT 0xFFFF, 104.9 ms): the
+    // recording has timeouts followed by reads, which a replay at recorded speed has to repeat
+    rec.count = rec.reads = fast.count = fast.reads = 0;
+    snprintf(spec, sizeof(spec), "record:%s:sim", path);
+    if (run_polling(spec, 0x0F, 0xFFFF, waits, &rec) != 0) return 1;
+    snprintf(spec, sizeof(spec), "replay:%s", path);
+    if (run_polling(spec, 0x0F, 0xFFFF, waits, &slow) != 0) return 1;
+    snprintf(spec, sizeof(spec), "replay:%s:fast", path);
+    if (run_polling(spec, 0x0F, 0xFFFF, waits, &fast) != 0) return 1;
+    report("long_period_record", NULL, &rec);
+    report("long_period_replay", &rec, &slow);
+    report("long_period_replay_fast", &rec, &fast);
+    bad += mismatches(&rec, &slow) + mismatches(&rec, &fast) + (slow.reads != rec.reads) + (fast.reads != rec.reads);
+
+    unlink(path);
+    if (bad != 0) {
+        fprintf(stderr, "Replays differ from the recording\n");
+        return 1;
+    }
+    return 0;
+}
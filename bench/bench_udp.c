@@ -0,0 +1,225 @@
+// UDP request latency of ldc_service under concurrent clients, against a simulated device.
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <endian.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "bench.h"
+#include "../ldc_proto.h"
+
+#define BENCH "udp"
+#define MAX_CLIENTS 32
+
+// Short conversions on all four channels, about 1.2 kHz per channel
+static char *service_args[] = {
+    NULL, "-d", "sim", "-c", "0,1,2,3", "-p", NULL,
+    "-C", "0,0x0200,0x000A,0x1001,0xB000", "-C", "1,0x0200,0x000A,0x1001,0xB000",
+    "-C", "2,0x0200,0x000A,0x1001,0xB000", "-C", "3,0x0200,0x000A,0x1001,0xB000", "-w", NULL, NULL,
+};
+static int server_threads = 1;
+
+struct request {
+    const char *name;
+    uint8_t buf[sizeof(struct ldc_query)];
+    size_t len;
+};
+
+struct client {
+    pthread_t thread;
+    const struct request *req;
+    int port;
+    long count;
+    uint64_t *rtt_ns;  // one per request
+    long timeouts;
+};
+
+static void *client_thread(void *arg) {
+    struct client *c = arg;
+    uint8_t reply[LDC_MAX_DATAGRAM];
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(c->port) };
+    struct timeval tv = { 0, 200000 };
+
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    // connect() so replies from anything but the service are filtered out
+    connect(sock, (struct sockaddr *)&addr, sizeof(addr));
+
+    for (long i = 0; i < c->count; i++) {
+        uint64_t t0 = ldc_now_ns();
+        send(sock, c->req->buf, c->req->len, 0);
+        ssize_t n = recv(sock, reply, sizeof(reply), 0);
+        if (n < 0) {
+            c->timeouts++;
+            c->rtt_ns[i] = UINT64_MAX;
+            continue;
+        }
+        // Multi-fragment replies: wait for the last one
+        while (n >= (ssize_t)sizeof(struct ldc_reply) && reply[0] == LDC_PROTO_MAGIC &&
+               (((struct ldc_reply *)reply)->flags & LDC_REPLY_MORE)) {
+            n = recv(sock, reply, sizeof(reply), 0);
+        }
+        c->rtt_ns[i] = ldc_now_ns() - t0;
+    }
+    close(sock);
+    return NULL;
+}
+
+static void run(const struct request *req, int port, int num_clients, long per_client) {
+    struct client clients[MAX_CLIENTS];
+    uint64_t *rtt = calloc((size_t)num_clients * per_client, sizeof(*rtt));
+    long timeouts = 0;
+    char name[64];
+
+    uint64_t t0 = ldc_now_ns();
+    for (int i = 0; i < num_clients; i++) {
+        clients[i] = (struct client){ .req = req, .port = port, .count = per_client,
+                                      .rtt_ns = rtt + (size_t)i * per_client };
+        pthread_create(&clients[i].thread, NULL, client_thread, &clients[i]);
+    }
+    for (int i = 0; i < num_clients; i++) {
+        pthread_join(clients[i].thread, NULL);
+        timeouts += clients[i].timeouts;
+    }
+    uint64_t wall = ldc_now_ns() - t0;
+
+    size_t n = (size_t)num_clients * per_client;
+    bench_sort(rtt, n);
+    n -= timeouts; // timeouts sort to the end as UINT64_MAX
+
+    snprintf(name, sizeof(name), "%s_%d_clients", req->name, num_clients);
+    bench_begin(BENCH, name);
+    bench_field_u64("server_threads", server_threads);
+    bench_field_u64("requests", n);
+    bench_field_f("requests_per_sec", n * 1e9 / wall);
+    bench_field_f("p50_us", bench_percentile(rtt, n, 0.50) / 1e3);
+    bench_field_f("p99_us", bench_percentile(rtt, n, 0.99) / 1e3);
+    bench_field_f("p999_us", bench_percentile(rtt, n, 0.999) / 1e3);
+    bench_field_f("max_us", n ? rtt[n - 1] / 1e3 : 0.0);
+    bench_field_u64("timeouts", timeouts);
+    bench_end();
+    free(rtt);
+}
+
+static void make_query(struct request *req, const char *name, uint8_t opcode, uint32_t count) {
+    struct ldc_query *q = (struct ldc_query *)req->buf;
+    memset(req->buf, 0, sizeof(req->buf));
+    req->name = name;
+    q->hdr.magic = LDC_PROTO_MAGIC;
+    q->hdr.version = LDC_PROTO_VERSION;
+    q->hdr.opcode = opcode;
+    q->channel_mask = htobe32(0x0F);
+    q->count = htobe32(count);
+    req->len = sizeof(*q);
+}
+
+// Process CPU time (user + system) in clock ticks from /proc/<pid>/stat
+static long proc_cpu_ticks(pid_t pid) {
+    char path[64], buf[1024];
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+    FILE *f = fopen(path, "r");
+    if (f == NULL) return -1;
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[n] = '\0';
+    char *p = strrchr(buf, ')'); // the command name may contain spaces
+    unsigned long utime = 0, stime = 0;
+    if (p == NULL || sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2) {
+        return -1;
+    }
+    return (long)(utime + stime);
+}
+
+// Wait until the service answers a request
+static int wait_ready(int port) {
+    struct request probe = { .name = "probe", .buf = {0}, .len = 1 };
+    uint64_t rtt;
+    struct client c = { .req = &probe, .port = port, .count = 1, .rtt_ns = &rtt };
+    for (int i = 0; i < 50; i++) {
+        c.timeouts = 0;
+        client_thread(&c);
+        if (c.timeouts == 0) return 0;
+        usleep(100000); // a refused request fails at once while the service is starting
+    }
+    return -1;
+}
+
+int main(int argc, char *argv[]) {
+    int opt = 0;
+    const char *service = "./ldc_service";
+    int port = 5499;
+    long requests = 20000;
+    char port_arg[16], threads_arg[16];
+
+    while ((opt = getopt(argc, argv, "hs:p:n:w:")) != -1) {
+        switch (opt) {
+            case 's':
+                service = optarg;
+                break;
+            case 'p':
+                port = atoi(optarg);
+                break;
+            case 'n':
+                requests = atol(optarg);
+                break;
+            case 'w':
+                server_threads = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-s path/to/ldc_service] [-p port] [-n requests per case] [-w server threads]\n", argv[0]);
+                return (opt == 'h') ? 0 : -1;
+        }
+    }
+
+    snprintf(port_arg, sizeof(port_arg), "%d", port);
+    service_args[0] = (char *)service;
+    service_args[6] = port_arg;
+    snprintf(threads_arg, sizeof(threads_arg), "%d", server_threads);
+    service_args[16] = threads_arg;
+    pid_t pid = fork();
+    if (pid == 0) {
+        freopen("/dev/null", "w", stdout); // keep the JSON output clean
+        execv(service, service_args);
+        perror("Failed to start ldc_service");
+        _exit(127);
+    }
+    if (pid < 0 || wait_ready(port) != 0) {
+        fprintf(stderr, "ldc_service did not answer on port %d\n", port);
+        if (pid > 0) kill(pid, SIGKILL);
+        return 1;
+    }
+
+    // Cost of acquisition alone: the service with no clients
+    long ticks0 = proc_cpu_ticks(pid);
+    uint64_t t0 = ldc_now_ns();
+    sleep(2);
+    long ticks = proc_cpu_ticks(pid) - ticks0;
+    bench_begin(BENCH, "service_idle");
+    bench_field_f("cpu_load", ticks / (double)sysconf(_SC_CLK_TCK) / ((ldc_now_ns() - t0) / 1e9));
+    bench_end();
+
+    struct request reqs[3];
+    reqs[0] = (struct request){ .name = "legacy_latest", .buf = {0}, .len = 1 };
+    make_query(&reqs[1], "query_latest", LDC_OP_LATEST, 0);
+    make_query(&reqs[2], "query_last_60", LDC_OP_LAST_N, 15); // 4 channels x 15 fill one datagram
+
+    int client_counts[] = {1, 4, 16};
+    for (size_t r = 0; r < sizeof(reqs) / sizeof(reqs[0]); r++) {
+        for (size_t c = 0; c < sizeof(client_counts) / sizeof(client_counts[0]); c++) {
+            run(&reqs[r], port, client_counts[c], requests / client_counts[c]);
+        }
+    }
+
+    kill(pid, SIGINT);
+    waitpid(pid, NULL, 0);
+    return 0;
+}
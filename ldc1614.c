@@ -1,7 +1,6 @@
 // Source file for ldc1614 driver.
 #include "ldc1614.h"
-#include <wiringPi.h>
-#include <wiringPiI2C.h>
+#include "ldc_bus.h"
 #include <stdio.h>
 #include <unistd.h>
 #include <stdint.h>
@@ -9,111 +8,176 @@
 #include <string.h>
 #include <errno.h>
 
-uint16_t byteswap(uint16_t value){
-    // reverse byte order for 16 bit value
-    uint16_t lsb = value >> 8; // Get LSB
-    uint64_t msb = value << 8; // Get MSB
-    return (msb | lsb); // Combine MSB and LSB
+uint16_t error_config =LDC_DRDY_2INT| LDC1614_AH_ERR2OUT | LDC1614_AL_ERR2OUT | LDC1614_UR_ERR2OUT | LDC1614_OR_ERR2OUT;
+
+// Highest channel set in the mask
+static int last_channel(uint8_t channel_mask) {
+    int last = 0;
+    for (int ch = 0; ch < LDC1614_NUM_CHANNELS; ch++) {
+        if (channel_mask & (1 << ch)) last = ch;
+    }
+    return last;
 }
 
-uint16_t error_config =LDC_DRDY_2INT| LDC1614_AH_ERR2OUT | LDC1614_AL_ERR2OUT | LDC1614_UR_ERR2OUT | LDC1614_OR_ERR2OUT;
+void ldc1614_sequence_regs(uint8_t channel_mask, uint16_t *config, uint16_t *mux_config) {
+    int last = last_channel(channel_mask);
+    int single = (channel_mask & (channel_mask - 1)) == 0; // exactly one channel requested
 
-int ldc1614_init(int i2c_fd, int channel) {
-    int result = 0;
-    // Set up the LDC1614 with default values (see p 51 of the datasheet)
-    result = ldc1614_write_reg(i2c_fd, LDC1614_RCOUNT0, 0xFFFF); // Max conversion interval
-    if (result == -1) {
-        fprintf(stderr, "Failed to write RCOUNT0: %s\n", strerror(errno));
-        return -1; // Error
+    // Input deglitch bandwidth 3.3MHz
+    *mux_config = LDC1614_MUX_RESERVED | LDC1614_MUX_DEGLITCH_3M3;
+    *config = LDC1614_CONFIG_DEFAULT;
+    if (single) {
+        *config |= LDC1614_CONFIG_ACTIVE_CHAN(last); // continuous conversion on one channel
+    } else {
+        *mux_config |= LDC1614_MUX_AUTOSCAN_EN | LDC1614_MUX_RR_SEQ(last); // autoscan CH0..last
     }
-    result = ldc1614_write_reg(i2c_fd, LDC1614_SETTLECOUNT0, 0x000A); // Settle time
-    if (result == -1) {
-        fprintf(stderr, "Failed to write SETTLECOUNT0: %s\n", strerror(errno));
+}
+
+int ldc1614_configure(struct ldc_bus *bus, uint8_t channel_mask, const struct ldc1614_channel_config *channels,
+                      uint16_t error_cfg) {
+    int last = last_channel(channel_mask);
+    int single = (channel_mask & (channel_mask - 1)) == 0;
+    uint16_t config, mux_config;
+
+    if (channel_mask == 0 || channel_mask >= (1 << LDC1614_NUM_CHANNELS)) {
+        fprintf(stderr, "Invalid channel mask 0x%X\n", channel_mask);
         return -1; // Error
     }
-    result = ldc1614_write_reg(i2c_fd, LDC1614_CLOCK_DIVIDERS0, 0x1001); // No clock division
-    if (result == -1) {
-        fprintf(stderr, "Failed to write CLOCK_DIVIDERS0: %s\n", strerror(errno));
+    // Configuration is only permitted while the device is asleep
+    if (ldc1614_sleep(bus) == -1) {
         return -1; // Error
     }
-    result = ldc1614_write_reg(i2c_fd, LDC1614_ERROR_CONFIG, error_config); 
-    if (result == -1) {
-        fprintf(stderr, "Failed to write ERROR_CONFIG: %s\n", strerror(errno));
-        return -1; // Error
+    // Channels in the autoscan sequence convert whether requested or not, so configure them all
+    for (int ch = 0; ch <= last; ch++) {
+        if (single && ch != last) continue;
+        if (ldc1614_write_reg(bus, LDC1614_RCOUNT(ch), channels[ch].rcount) == -1 ||
+            ldc1614_write_reg(bus, LDC1614_SETTLECOUNT(ch), channels[ch].settlecount) == -1 ||
+            ldc1614_write_reg(bus, LDC1614_CLOCK_DIVIDERS(ch), channels[ch].clock_dividers) == -1 ||
+            ldc1614_write_reg(bus, LDC1614_DRIVE_CURRENT(ch), channels[ch].drive_current) == -1) {
+            return -1; // Error
+        }
     }
-    // Enable Channel 0 in continuous mode, set Input deglitch bandwidth to 3.3MHz
-    result = ldc1614_write_reg(i2c_fd, LDC1614_MUX_CONFIG, 0x020C); 
-    if (result == -1) {
-        fprintf(stderr, "Failed to write MUX_CONFIG: %s\n", strerror(errno));
+    if (ldc1614_write_reg(bus, LDC1614_ERROR_CONFIG, error_cfg) == -1) {
         return -1; // Error
     }
-    //Manually set sensor drive current on channel 0
-	result = ldc1614_write_reg(i2c_fd, LDC1614_DRIVE_CURRENT0, 0xb000);
-    if (result == -1) {
-        fprintf(stderr, "Failed to write DRIVE_CURRENT0: %s\n", strerror(errno));
+    ldc1614_sequence_regs(channel_mask, &config, &mux_config);
+    if (ldc1614_write_reg(bus, LDC1614_MUX_CONFIG, mux_config) == -1) {
         return -1; // Error
     }
-    // Select active channel = ch 0, disable auto-amplitude correction and autocalibration, 
-    // enable full current drive during sensor activation, select
-	// external clock source, wake up device to start conversion. This register
-	// write must occur last because device configuration is not permitted while
-	// the LDC is in active mode.
-	result = ldc1614_write_reg(i2c_fd, LDC1614_CONFIG, 0x1601);
-    if (result == -1) {
-        fprintf(stderr, "Failed to write CONFIG: %s\n", strerror(errno));
+    // Disable auto-amplitude correction and autocalibration, enable full current drive during
+    // sensor activation, select external clock source, wake up device to start conversion. This
+    // register write must occur last because device configuration is not permitted while
+    // the LDC is in active mode.
+    return ldc1614_write_reg(bus, LDC1614_CONFIG, config);
+}
+
+int ldc1614_sleep(struct ldc_bus *bus) {
+    return ldc1614_write_reg(bus, LDC1614_CONFIG, LDC1614_CONFIG_DEFAULT | LDC1614_CONFIG_SLEEP_MODE_EN);
+}
+
+int ldc1614_init(struct ldc_bus *bus, int channel) {
+    // Set up the LDC1614 with default values (see p 51 of the datasheet)
+    static const struct ldc1614_channel_config defaults = {
+        LDC1614_DEFAULT_RCOUNT, LDC1614_DEFAULT_SETTLECOUNT,
+        LDC1614_DEFAULT_CLOCK_DIVIDERS, LDC1614_DEFAULT_DRIVE_CURRENT,
+    };
+    struct ldc1614_channel_config channels[LDC1614_NUM_CHANNELS];
+
+    if (channel < 0 || channel >= LDC1614_NUM_CHANNELS) {
+        fprintf(stderr, "Invalid channel %d\n", channel);
         return -1; // Error
     }
+    channels[channel] = defaults;
+    return ldc1614_configure(bus, 1 << channel, channels, error_config);
+}
 
-    return 0; // Success
+uint64_t ldc1614_sequence_period_ns(uint8_t channel_mask, const struct ldc1614_channel_config *channels,
+                                    uint32_t fref_hz) {
+    int single = (channel_mask & (channel_mask - 1)) == 0;
+    int first = single ? last_channel(channel_mask) : 0; // autoscan always starts at CH0
+    int last = last_channel(channel_mask);
+    uint64_t period = 0;
+
+    for (int ch = first; ch <= last; ch++) {
+        uint64_t div = LDC1614_FREF_DIVIDER(channels[ch].clock_dividers);
+        uint64_t settle = channels[ch].settlecount;
+        // Reference clock cycles, scaled to nanoseconds at the divided reference frequency
+        uint64_t cycles = (uint64_t)channels[ch].rcount * 16 + 4;
+        if (!single) cycles += ((settle <= 1) ? 32 : settle * 16) + 5;
+        period += cycles * (div ? div : 1) * 1000000000ULL / fref_hz;
+        if (!single) period += LDC1614_SWITCH_DELAY_NS;
+    }
+    return period;
 }
 
-int ldc1614_read_reg(int fd, uint8_t reg, uint16_t *value){
-    int16_t data = 0;
-    data = wiringPiI2CReadReg16(fd, reg);
-    if (data == -1) {
+int ldc1614_read_reg(struct ldc_bus *bus, uint8_t reg, uint16_t *value){
+    uint8_t buf[2];
+    struct ldc_bus_xfer xfer = { .reg = reg, .len = 2, .buf = buf };
+
+    if (bus->read(bus, &xfer, 1) == -1) {
         fprintf(stderr, "Failed to read register 0x%02X: %s\n", reg, strerror(errno));
         return -1; // Error
-    } 
-    *value = byteswap((uint16_t)data);
+    }
+    *value = (uint16_t)((buf[0] << 8) | buf[1]); // registers are big-endian
     return 0; // Success
 }
 
-int ldc1614_write_reg(int fd, uint8_t reg, uint16_t value) {
-    value = byteswap(value); // Ensure value is in correct byte order
-    int result = wiringPiI2CWriteReg16(fd, reg, value);
-    if (result == -1) {
+int ldc1614_write_reg(struct ldc_bus *bus, uint8_t reg, uint16_t value) {
+    if (bus->write(bus, reg, value) == -1) {
         fprintf(stderr, "Failed to write register 0x%02X: %s\n", reg, strerror(errno));
         return -1; // Error
     }
     return 0; // Success
 }
 
-int ldc1614_read_ch0(int fd, uint32_t * data){
-    uint16_t msb = 0;
-    int ret = 0;
-    // Read the MSB and LSB of DATA0
-    ret = ldc1614_read_reg(fd, LDC1614_DATA0_MSB, &msb);
-    if (ret == -1) {
-        fprintf(stderr, "Failed to read DATA0_MSB: %s\n", strerror(errno));
+/**
+ * @brief Read STATUS and the DATA registers of all channels in channel_mask
+ * in one combined bus transaction.
+ * @note The DATA registers are contiguous, so one read starting at DATA0_MSB
+ * with register auto-increment covers every channel up to the highest one
+ * requested. Both reads are joined by repeated starts, so MSB and LSB always
+ * come from the same conversion.
+ */
+int ldc1614_read_burst(struct ldc_bus *bus, uint8_t channel_mask, struct ldc1614_burst *out) {
+    uint8_t status_buf[2];
+    uint8_t data_buf[4 * LDC1614_NUM_CHANNELS];
+    int last = last_channel(channel_mask);
+
+    struct ldc_bus_xfer xfers[2] = {
+        { .reg = LDC1614_STATUS,    .len = 2,                          .buf = status_buf },
+        { .reg = LDC1614_DATA0_MSB, .len = (uint16_t)(4 * (last + 1)), .buf = data_buf }, // MSB + LSB words for CH0..last
+    };
+    if (bus->read(bus, xfers, 2) == -1) {
         return -1; // Error
     }
-    // printf("DATA0_MSB: 0x%04X\n", msb);
 
-    uint16_t lsb = 0;
-    ret = ldc1614_read_reg(fd, LDC1614_DATA0_LSB, &lsb);
-    if (ret == -1) {
-        fprintf(stderr, "Failed to read DATA0_LSB: %s\n", strerror(errno));
+    // Registers are transferred big-endian
+    out->status = (uint16_t)((status_buf[0] << 8) | status_buf[1]);
+    for (int ch = 0; ch <= last; ch++) {
+        uint16_t msb = (uint16_t)((data_buf[4*ch] << 8) | data_buf[4*ch + 1]);
+        uint16_t lsb = (uint16_t)((data_buf[4*ch + 2] << 8) | data_buf[4*ch + 3]);
+        out->value[ch] = LDC1614_DATA_VALUE(msb, lsb);
+        out->errors[ch] = LDC1614_DATA_ERRORS(msb);
+    }
+    return 0; // Success
+}
+
+int ldc1614_read_channel(struct ldc_bus *bus, int channel, uint32_t * data, uint8_t *errors){
+    struct ldc1614_burst burst;
+    // Read MSB and LSB of DATAx in one transaction so both halves belong to the same conversion
+    if (ldc1614_read_burst(bus, 1 << channel, &burst) == -1) {
+        fprintf(stderr, "Failed to read DATA%d: %s\n", channel, strerror(errno));
         return -1; // Error
     }
-    // printf("DATA0_LSB: 0x%04X\n", lsb);
-    
-    // Combine MSB and LSB into a single 32-bit value
-    int16_t errors = (msb >> 12) & 0x0F; // Extract error bits from MSB
-    if (errors != 0) {
-        fprintf(stderr, "Error bits detected: 0x%02X\n", errors);
+
+    *data = burst.value[channel]; // Store the sensor reading in the provided data container
+    if (errors != NULL) {
+        *errors = burst.errors[channel]; // Error bits from MSB, left to the caller to count or drop
     }
-    uint32_t sensor_value = ((msb & 0x0FFF) << 16) | lsb;
-    *data = sensor_value; // Store the sensor reading in the provided data container
-    
+
     return 0; // Return success
-}
\ No newline at end of file
+}
+
+int ldc1614_read_ch0(struct ldc_bus *bus, uint32_t * data){
+    return ldc1614_read_channel(bus, 0, data, NULL);
+}
@@ -17,6 +17,7 @@
 
 // Device I2C Address
 #define LDC1614_ADDR 0x2b //if ADDR pin pulled low, 0x2A, but it is pulled high so 0x2B
+#define LDC1614_ADDR_LOW 0x2a // a second device on the same bus, ADDR pin pulled low
 // Register Addresses
 #define LDC1614_DATA0_MSB        0x00  // Channel 0 MSB Conversion Result and Error Status
 #define LDC1614_DATA0_LSB        0x01  // Channel 0 LSB Conversion Result. Must be read after Register address 0x00.
@@ -54,6 +55,54 @@
 #define LDC1614_MANUFACTURER_ID  0x7E  // Manufacturer ID
 #define LDC1614_DEVICE_ID        0x7F  // Device ID
 
+#define LDC1614_MANUFACTURER_ID_VALUE  0x5449 // "TI"
+#define LDC1614_DEVICE_ID_VALUE        0x3055
+#define LDC1614_RESET_DEV_BIT          (1<<15) // write to RESET_DEV to reset every register
+
+// Per-channel register addresses (ch = 0..3)
+#define LDC1614_NUM_CHANNELS     4
+#define LDC1614_DATA_MSB(ch)        (LDC1614_DATA0_MSB + 2*(ch))
+#define LDC1614_DATA_LSB(ch)        (LDC1614_DATA0_LSB + 2*(ch))
+#define LDC1614_RCOUNT(ch)          (LDC1614_RCOUNT0 + (ch))
+#define LDC1614_SETTLECOUNT(ch)     (LDC1614_SETTLECOUNT0 + (ch))
+#define LDC1614_CLOCK_DIVIDERS(ch)  (LDC1614_CLOCK_DIVIDERS0 + (ch))
+#define LDC1614_DRIVE_CURRENT(ch)   (LDC1614_DRIVE_CURRENT0 + (ch))
+
+// CLOCK_DIVIDERSx fields
+#define LDC1614_FIN_DIVIDER(div)    (((div) >> 12) & 0x0F)  // sensor frequency divider
+#define LDC1614_FREF_DIVIDER(div)   ((div) & 0x03FF)        // reference clock divider
+#define LDC1614_IDRIVE(drive)       (((drive) >> 11) & 0x1F) // DRIVE_CURRENTx sensor current setting
+
+// MUX_CONFIG fields
+#define LDC1614_MUX_AUTOSCAN_EN  (1<<15)      // sequence channels instead of converting ACTIVE_CHAN only
+#define LDC1614_MUX_RR_SEQ(last) (((last) - 1) << 13) // autoscan CH0..last (last = 1..3)
+#define LDC1614_MUX_RESERVED     0x0208       // bits 12:3 must be written as 00 0100 0001
+#define LDC1614_MUX_DEGLITCH_1M0 0x1          // input deglitch bandwidth 1.0 MHz
+#define LDC1614_MUX_DEGLITCH_3M3 0x4          // input deglitch bandwidth 3.3 MHz
+#define LDC1614_MUX_DEGLITCH_10M 0x5          // input deglitch bandwidth 10 MHz
+#define LDC1614_MUX_DEGLITCH_33M 0x7          // input deglitch bandwidth 33 MHz
+
+// CONFIG fields
+#define LDC1614_CONFIG_ACTIVE_CHAN(ch) ((ch) << 14) // channel converted when autoscan is off
+#define LDC1614_CONFIG_SLEEP_MODE_EN   (1<<13)
+#define LDC1614_CONFIG_DEFAULT   0x1601 // RP override, auto-amplitude off, external clock, awake
+
+// Default conversion settings (see p 51 of the datasheet)
+#define LDC1614_DEFAULT_RCOUNT          0xFFFF // Max conversion interval
+#define LDC1614_DEFAULT_SETTLECOUNT     0x000A // Settle time
+#define LDC1614_DEFAULT_CLOCK_DIVIDERS  0x1001 // No clock division
+#define LDC1614_DEFAULT_DRIVE_CURRENT   0xB000
+#define LDC1614_FREF_HZ                 40000000 // external reference clock on CLKIN
+#define LDC1614_SWITCH_DELAY_NS         692      // autoscan channel switch delay, plus 5 reference clocks
+
+// Per-channel conversion settings
+struct ldc1614_channel_config {
+    uint16_t rcount;
+    uint16_t settlecount;
+    uint16_t clock_dividers;
+    uint16_t drive_current;
+};
+
 // error configs
 #define LDC_DRDY_2INT  1<<0    // Data ready interrupt
 #define LDC1614_AL_ERR2OUT  1<<11   // report amplitude low error
@@ -62,6 +111,8 @@
 #define LDC1614_OR_ERR2OUT  1<<14   // report over-range error
 #define LDC1614_UR_ERR2OUT  1<<15   // report under-range error
 
+extern uint16_t error_config; // ERROR_CONFIG value written by ldc1614_init()
+
 // error codes
 #define LDC1614_ERR_UR0  1<<15   // under-range error
 #define LDC1614_ERR_OR0  1<<14   // over-range error
@@ -71,11 +122,77 @@
 
 // device status
 #define LDC1614_DATA_READY (1<<6) // Data is available 
+#define LDC1614_UNREADCONV(ch) (1<<(3-(ch))) // unread conversion on channel ch (CH0 is bit 3)
+#define LDC1614_STATUS_ERR_CHAN(ch) ((ch) << 14) // channel the error flags below belong to
+#define LDC1614_STATUS_ERR_UR  (1<<13) // conversion under-range
+#define LDC1614_STATUS_ERR_OR  (1<<12) // conversion over-range
+#define LDC1614_STATUS_ERR_WD  (1<<11) // watchdog timeout, sensor not oscillating
+#define LDC1614_STATUS_ERR_AHE (1<<10) // sensor amplitude too high
+#define LDC1614_STATUS_ERR_ALE (1<<9)  // sensor amplitude too low
+
+// DATAx decoding: 4 error bits on top of the MSB, 28-bit conversion result below
+#define LDC1614_DATA_ERRORS(msb)     (((msb) >> 12) & 0x0F)
+#define LDC1614_DATA_VALUE(msb, lsb) ((((uint32_t)(msb) & 0x0FFF) << 16) | (uint32_t)(lsb))
+
+// Result of one burst read: STATUS plus the DATA registers of the requested channels
+struct ldc1614_burst {
+    uint16_t status;
+    uint32_t value[LDC1614_NUM_CHANNELS]; // 28-bit conversion results
+    uint8_t errors[LDC1614_NUM_CHANNELS]; // UR/OR/WD/AE bits from DATAx_MSB
+};
+
+struct ldc_bus; // register access backend, see ldc_bus.h
 
-uint16_t byteswap(uint16_t value);
-int ldc1614_init(int fd, int channel);
-int ldc1614_read_reg(int fd, uint8_t reg, uint16_t *value);
-int ldc1614_write_reg(int fd, uint8_t reg, uint16_t value);
-int ldc1614_read_ch0(int fd, uint32_t *value);
+// Single channel at default settings with the global error_config
+int ldc1614_init(struct ldc_bus *bus, int channel);
+
+/**
+ * @brief Configure the channels in channel_mask and start converting.
+ * @param channels per-channel settings indexed by channel
+ * @param error_cfg ERROR_CONFIG value
+ * @return 0 on success, -1 on failure
+ * @note One channel converts continuously; several autoscan CH0 up to the highest one,
+ * so every channel in that range is configured. The device is put to sleep first, so this
+ * also reconfigures a running device.
+ */
+int ldc1614_configure(struct ldc_bus *bus, uint8_t channel_mask, const struct ldc1614_channel_config *channels,
+                      uint16_t error_cfg);
+
+// Stop converting (CONFIG sleep mode); registers and unread results are kept
+int ldc1614_sleep(struct ldc_bus *bus);
+
+// CONFIG and MUX_CONFIG values ldc1614_configure() writes for channel_mask
+void ldc1614_sequence_regs(uint8_t channel_mask, uint16_t *config, uint16_t *mux_config);
+
+/**
+ * @brief Time between two results of every channel in channel_mask, i.e. the
+ * period of the sequence ldc1614_configure() programs.
+ * @param channels per-channel settings indexed by channel
+ * @param fref_hz reference clock on CLKIN, e.g. LDC1614_FREF_HZ
+ * @return period in nanoseconds
+ * @note A single channel converts back to back (tC = (RCOUNT*16+4)/fREF); autoscan
+ * adds each channel's switch delay and settle time (SETTLECOUNT*16/fREF).
+ */
+uint64_t ldc1614_sequence_period_ns(uint8_t channel_mask, const struct ldc1614_channel_config *channels,
+                                    uint32_t fref_hz);
+
+int ldc1614_read_reg(struct ldc_bus *bus, uint8_t reg, uint16_t *value);
+int ldc1614_write_reg(struct ldc_bus *bus, uint8_t reg, uint16_t value);
+/**
+ * @brief Read the DATA registers of one channel.
+ * @param errors UR/OR/WD/AE bits of the result (see ldc_errors.h), may be NULL
+ * @return 0 on success, -1 on failure
+ */
+int ldc1614_read_channel(struct ldc_bus *bus, int channel, uint32_t *value, uint8_t *errors);
+// Channel 0 result, without the error bits
+int ldc1614_read_ch0(struct ldc_bus *bus, uint32_t *value);
+
+/**
+ * @brief Read STATUS and the DATA registers of all channels in channel_mask
+ * in one bus transaction.
+ * @param out decoded status, values and error bits
+ * @return 0 on success, -1 on failure
+ */
+int ldc1614_read_burst(struct ldc_bus *bus, uint8_t channel_mask, struct ldc1614_burst *out);
 
 #endif /* INC_LDC1614_H_ */
@@ -0,0 +1,146 @@
+// Source file for the LDC1614 register bus backends.
+#include "ldc_bus.h"
+#include "ldc_sim.h"
+#include "ldc_trace.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#ifdef HAVE_WIRINGPI
+#include <wiringPiI2C.h>
+#endif
+
+#define MAX_XFERS 8 // register ranges per combined read
+
+// Combined read: a register-pointer write and a read per range, joined by repeated starts
+static int i2cdev_read(struct ldc_bus *bus, const struct ldc_bus_xfer *xfers, int n) {
+    struct i2c_msg msgs[2 * MAX_XFERS];
+    uint8_t regs[MAX_XFERS];
+
+    if (n > MAX_XFERS) {
+        errno = EINVAL;
+        return -1;
+    }
+    for (int i = 0; i < n; i++) {
+        regs[i] = xfers[i].reg;
+        msgs[2*i]     = (struct i2c_msg){ .addr = bus->addr, .flags = 0,        .len = 1,            .buf = &regs[i] };
+        msgs[2*i + 1] = (struct i2c_msg){ .addr = bus->addr, .flags = I2C_M_RD, .len = xfers[i].len, .buf = xfers[i].buf };
+    }
+    struct i2c_rdwr_ioctl_data xfer = { .msgs = msgs, .nmsgs = 2 * n };
+    return (ioctl(bus->fd, I2C_RDWR, &xfer) < 0) ? -1 : 0;
+}
+
+static int i2cdev_write(struct ldc_bus *bus, uint8_t reg, uint16_t value) {
+    uint8_t buf[3] = { reg, value >> 8, value & 0xFF }; // registers are big-endian
+    struct i2c_msg msg = { .addr = bus->addr, .flags = 0, .len = 3, .buf = buf };
+    struct i2c_rdwr_ioctl_data xfer = { .msgs = &msg, .nmsgs = 1 };
+    return (ioctl(bus->fd, I2C_RDWR, &xfer) < 0) ? -1 : 0;
+}
+
+static void fd_close(struct ldc_bus *bus) {
+    if (bus->fd >= 0) close(bus->fd);
+    bus->fd = -1;
+}
+
+int ldc_bus_open_i2cdev(struct ldc_bus *bus, const char *dev, uint8_t addr) {
+    memset(bus, 0, sizeof(*bus));
+    bus->fd = open(dev, O_RDWR | O_CLOEXEC);
+    if (bus->fd < 0) {
+        fprintf(stderr, "Failed to open %s: %s\n", dev, strerror(errno));
+        return -1;
+    }
+    bus->read = i2cdev_read;
+    bus->write = i2cdev_write;
+    bus->close = fd_close;
+    bus->name = "i2c-dev";
+    bus->addr = addr;
+    return 0;
+}
+
+#ifdef HAVE_WIRINGPI
+// reverse byte order for 16 bit value, SMBus words are little-endian
+static uint16_t byteswap(uint16_t value) {
+    return (uint16_t)((value << 8) | (value >> 8));
+}
+
+static int wiringpi_read(struct ldc_bus *bus, const struct ldc_bus_xfer *xfers, int n) {
+    if (n == 1 && xfers[0].len == 2) {
+        int data = wiringPiI2CReadReg16(bus->fd, xfers[0].reg);
+        if (data == -1) return -1;
+        uint16_t value = byteswap((uint16_t)data);
+        xfers[0].buf[0] = value >> 8;
+        xfers[0].buf[1] = value & 0xFF;
+        return 0;
+    }
+    // wiringPiI2C has no combined transfers, but its descriptor is a plain i2c-dev one
+    return i2cdev_read(bus, xfers, n);
+}
+
+static int wiringpi_write(struct ldc_bus *bus, uint8_t reg, uint16_t value) {
+    return (wiringPiI2CWriteReg16(bus->fd, reg, byteswap(value)) == -1) ? -1 : 0;
+}
+
+int ldc_bus_open_wiringpi(struct ldc_bus *bus, uint8_t addr) {
+    memset(bus, 0, sizeof(*bus));
+    bus->fd = wiringPiI2CSetup(addr);
+    if (bus->fd < 0) {
+        fprintf(stderr, "Failed to initialize wiringPi I2C: %s\n", strerror(errno));
+        return -1;
+    }
+    bus->read = wiringpi_read;
+    bus->write = wiringpi_write;
+    bus->close = fd_close;
+    bus->name = "wiringPi";
+    bus->addr = addr;
+    return 0;
+}
+#else
+int ldc_bus_open_wiringpi(struct ldc_bus *bus, uint8_t addr) {
+    (void)addr;
+    memset(bus, 0, sizeof(*bus));
+    bus->fd = -1;
+    fprintf(stderr, "Built without wiringPi, use an i2c-dev bus instead\n");
+    return -1;
+}
+#endif
+
+int ldc_bus_open(struct ldc_bus *bus, const char *spec, uint8_t addr) {
+    if (strcmp(spec, "sim") == 0 || strncmp(spec, "sim:", 4) == 0) {
+        struct ldc_sim_config config;
+        ldc_sim_default_config(&config);
+        if (spec[3] == ':' && ldc_sim_parse(&config, spec + 4) != 0) {
+            fprintf(stderr, "Invalid simulator options: %s\n", spec + 4);
+            return -1;
+        }
+        return ldc_bus_open_sim(bus, &config, addr);
+    }
+    if (strncmp(spec, "record:", 7) == 0 || strncmp(spec, "replay:", 7) == 0) {
+        char path[256];
+        const char *rest = strchr(spec + 7, ':');
+        size_t len = rest ? (size_t)(rest - (spec + 7)) : strlen(spec + 7);
+        if (len == 0 || len >= sizeof(path) || (spec[2] == 'c' && rest == NULL)) {
+            fprintf(stderr, "Invalid trace bus: %s (record:<file>:<bus> or replay:<file>[:fast])\n", spec);
+            return -1;
+        }
+        memcpy(path, spec + 7, len);
+        path[len] = '\0';
+        if (spec[2] == 'c') return ldc_bus_open_record(bus, path, rest + 1, addr);
+        return ldc_bus_open_replay(bus, path, rest ? rest + 1 : NULL, addr);
+    }
+    if (strcmp(spec, "wiringpi") == 0) {
+        return ldc_bus_open_wiringpi(bus, addr);
+    }
+    if (strncmp(spec, "i2c:", 4) == 0) {
+        spec += 4;
+    }
+    return ldc_bus_open_i2cdev(bus, spec, addr);
+}
+
+void ldc_bus_close(struct ldc_bus *bus) {
+    if (bus->close) bus->close(bus);
+}
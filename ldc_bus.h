@@ -0,0 +1,63 @@
+/*
+ * ldc_bus.h
+ *
+ * Register bus backends for the LDC1614 driver.
+ *
+ * The driver only ever reads and writes 16-bit big-endian registers, so a
+ * backend has two jobs: write one register, and read one or more register
+ * ranges in a single bus transaction (joined by repeated starts on a real
+ * bus, so STATUS and DATAx come from the same instant). Backends:
+ *
+ *   i2c-dev   any /dev/i2c-N, combined transfers through I2C_RDWR
+ *   wiringPi  wiringPiI2C register access (built with -DHAVE_WIRINGPI)
+ *   sim       register-accurate simulated LDC1614, see ldc_sim.h
+ *
+ * A bus is used by one thread at a time, like the file descriptor it wraps.
+ */
+
+#ifndef INC_LDC_BUS_H_
+#define INC_LDC_BUS_H_
+
+#include <stdint.h>
+
+#define LDC_BUS_DEFAULT "/dev/i2c-1"
+
+// One register range of a combined read
+struct ldc_bus_xfer {
+    uint8_t reg;   // first register, the device auto-increments
+    uint16_t len;  // bytes to read, 2 per register
+    uint8_t *buf;  // big-endian register contents
+};
+
+struct ldc_bus {
+    /**
+     * @brief Read every range in xfers in one bus transaction.
+     * @return 0 on success, -1 on failure
+     */
+    int (*read)(struct ldc_bus *bus, const struct ldc_bus_xfer *xfers, int n);
+    // Write one 16-bit register, 0 on success, -1 on failure
+    int (*write)(struct ldc_bus *bus, uint8_t reg, uint16_t value);
+    void (*close)(struct ldc_bus *bus);
+    const char *name;
+    int fd;        // i2c-dev descriptor, -1 if none
+    uint8_t addr;  // 7-bit device address
+    void *ctx;     // private state of the backend
+};
+
+/**
+ * @brief Open a bus from a device string.
+ * @param spec "/dev/i2c-N" (or "i2c:/dev/i2c-N"), "wiringpi", or "sim[:options]" (see ldc_sim_parse())
+ * @param addr 7-bit device address, e.g. LDC1614_ADDR
+ * @return 0 on success, -1 on failure
+ */
+int ldc_bus_open(struct ldc_bus *bus, const char *spec, uint8_t addr);
+
+// Open an i2c-dev adapter, no SMBus library needed
+int ldc_bus_open_i2cdev(struct ldc_bus *bus, const char *dev, uint8_t addr);
+
+// Open the device through wiringPiI2C, fails if built without wiringPi
+int ldc_bus_open_wiringpi(struct ldc_bus *bus, uint8_t addr);
+
+void ldc_bus_close(struct ldc_bus *bus);
+
+#endif /* INC_LDC_BUS_H_ */
@@ -0,0 +1,34 @@
+// Source file for the closed-loop controller.
+#include "ldc_control.h"
+#include <string.h>
+
+void ldc_pid_init(struct ldc_pid *pid, double kp, double ki, double kd, double dt, double out_min, double out_max) {
+    memset(pid, 0, sizeof(*pid));
+    pid->kp = kp;
+    pid->ki = ki;
+    pid->kd = kd;
+    pid->dt = dt;
+    pid->out_min = out_min;
+    pid->out_max = out_max;
+}
+
+static double clamp(double v, double lo, double hi) {
+    return (v < lo) ? lo : ((v > hi) ? hi : v);
+}
+
+double ldc_pid_update(struct ldc_pid *pid, double setpoint, double measurement) {
+    double err = setpoint - measurement;
+    double deriv = pid->primed ? -(measurement - pid->prev_meas) / pid->dt : 0.0;
+    pid->prev_meas = measurement;
+    pid->primed = 1;
+
+    double integral = clamp(pid->integral + pid->ki * err * pid->dt, pid->out_min, pid->out_max);
+    double out = pid->kp * err + integral + pid->kd * deriv;
+    // Anti-windup: while the output is at a limit, only integrate back towards the range
+    if ((out > pid->out_max && integral > pid->integral) || (out < pid->out_min && integral < pid->integral)) {
+        integral = pid->integral;
+        out = pid->kp * err + integral + pid->kd * deriv;
+    }
+    pid->integral = integral;
+    return clamp(out, pid->out_min, pid->out_max);
+}
@@ -0,0 +1,40 @@
+/*
+ * ldc_control.h
+ *
+ * PID controller for closing the loop from the LDC1614 to the KASM actuator
+ * (ldc_test -c); the loop is timed with the ldc_metrics histograms.
+ *
+ * The controller runs once per conversion on the raw 28-bit result and
+ * produces an actuator command. The derivative acts on the measurement, so
+ * a setpoint change does not kick the output, and the integral stops
+ * growing while the output is held at a limit (anti-windup). Updates only
+ * touch the struct passed in: nothing allocates or prints inside the loop.
+ */
+
+#ifndef INC_LDC_CONTROL_H_
+#define INC_LDC_CONTROL_H_
+
+
+struct ldc_pid {
+    double kp;          // command per count of error
+    double ki;          // command per count of error and second
+    double kd;          // command per count per second
+    double dt;          // control period in seconds
+    double out_min, out_max;
+    double integral;    // integral term in command units, kept within the output limits
+    double prev_meas;
+    int primed;         // prev_meas is valid
+};
+
+// Set the gains, period and output limits and clear the controller state
+void ldc_pid_init(struct ldc_pid *pid, double kp, double ki, double kd, double dt, double out_min, double out_max);
+
+/**
+ * @brief Run one controller step.
+ * @param setpoint wanted sensor value (raw counts)
+ * @param measurement sensor value of this conversion
+ * @return command within [out_min, out_max]
+ */
+double ldc_pid_update(struct ldc_pid *pid, double setpoint, double measurement);
+
+#endif /* INC_LDC_CONTROL_H_ */
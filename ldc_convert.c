@@ -0,0 +1,45 @@
+// Source file for the raw result to frequency and inductance conversion.
+#include "ldc_convert.h"
+#include <math.h>
+
+#define DATA_FULL_SCALE 268435456.0 // 2^28
+
+// Results are 28 bits, and a signed int to double conversion has a vector instruction on every target
+#define DATA_TO_DOUBLE(d) ((double)(int32_t)(d))
+
+int ldc_convert_init(struct ldc_convert *cv, const struct ldc1614_channel_config *channels,
+                     uint32_t fclk_hz, const double *tank_f) {
+    int ret = 0;
+
+    for (int ch = 0; ch < LDC1614_NUM_CHANNELS; ch++) {
+        unsigned fin_div = LDC1614_FIN_DIVIDER(channels[ch].clock_dividers);
+        unsigned fref_div = LDC1614_FREF_DIVIDER(channels[ch].clock_dividers);
+        double c = (tank_f != NULL) ? tank_f[ch] : 0.0;
+
+        if (fin_div == 0 || fref_div == 0) {
+            cv->hz_per_count[ch] = NAN;
+            cv->henry_count2[ch] = NAN;
+            ret = -1;
+            continue;
+        }
+        cv->hz_per_count[ch] = fin_div * ((double)fclk_hz / fref_div) / DATA_FULL_SCALE;
+        double w = 2.0 * M_PI * cv->hz_per_count[ch];
+        cv->henry_count2[ch] = (c > 0.0) ? 1.0 / (c * w * w) : NAN;
+    }
+    return ret;
+}
+
+void ldc_convert_frequency(const struct ldc_convert *cv, int ch, const uint32_t *data, double *hz, size_t n) {
+    const double k = cv->hz_per_count[ch];
+    for (size_t i = 0; i < n; i++) {
+        hz[i] = k * DATA_TO_DOUBLE(data[i]);
+    }
+}
+
+void ldc_convert_inductance(const struct ldc_convert *cv, int ch, const uint32_t *data, double *henry, size_t n) {
+    const double m = cv->henry_count2[ch];
+    for (size_t i = 0; i < n; i++) {
+        double d = DATA_TO_DOUBLE(data[i]);
+        henry[i] = m / (d * d);
+    }
+}
@@ -0,0 +1,46 @@
+/*
+ * ldc_convert.h
+ *
+ * Conversion of raw LDC1614 results to sensor frequency and inductance.
+ *
+ * With the OFFSET registers at zero, as ldc1614_configure() leaves them,
+ *
+ *     fSENSOR = CHx_FIN_DIVIDER * fREF * DATA / 2^28,  fREF = fCLK / CHx_FREF_DIVIDER
+ *     L       = 1 / (C * (2 * pi * fSENSOR)^2)
+ *
+ * where C is the capacitance of the channel's LC tank. Both reduce to one
+ * constant per channel (f = k * DATA, L = m / DATA^2), which ldc_convert_init()
+ * computes from the CLOCK_DIVIDERS settings, so converting a buffer is a single
+ * multiply or divide per sample over contiguous arrays that the compiler
+ * turns into vector code.
+ */
+
+#ifndef INC_LDC_CONVERT_H_
+#define INC_LDC_CONVERT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ldc1614.h"
+
+struct ldc_convert {
+    double hz_per_count[LDC1614_NUM_CHANNELS];  // fSENSOR per DATA count
+    double henry_count2[LDC1614_NUM_CHANNELS];  // L * DATA^2, NaN if the tank capacitance is unknown
+};
+
+/**
+ * @brief Precompute the conversion constants of every channel.
+ * @param channels per-channel settings indexed by channel, only clock_dividers is used
+ * @param fclk_hz reference clock on CLKIN, e.g. LDC1614_FREF_HZ
+ * @param tank_f per-channel tank capacitance in farads, 0 (or a NULL array) if unknown
+ * @return 0 on success, -1 if a divider field is 0 (reserved), which leaves that channel at NaN
+ */
+int ldc_convert_init(struct ldc_convert *cv, const struct ldc1614_channel_config *channels,
+                     uint32_t fclk_hz, const double *tank_f);
+
+// Sensor frequency in Hz of n results of channel ch
+void ldc_convert_frequency(const struct ldc_convert *cv, int ch, const uint32_t *data, double *hz, size_t n);
+
+// Sensor inductance in H of n results of channel ch, infinite for a 0 result
+void ldc_convert_inductance(const struct ldc_convert *cv, int ch, const uint32_t *data, double *henry, size_t n);
+
+#endif /* INC_LDC_CONVERT_H_ */
@@ -0,0 +1,49 @@
+// Source file for the conversion error counters.
+#include "ldc_errors.h"
+
+static const char *error_names[LDC_NUM_ERRORS] = {
+    "amplitude", "watchdog", "over-range", "under-range",
+};
+
+const char *ldc_errors_name(int b) {
+    return (b >= 0 && b < LDC_NUM_ERRORS) ? error_names[b] : "unknown";
+}
+
+int ldc_errors_report(const struct ldc_error_counts *c, struct ldc_error_report *report, FILE *f, uint64_t now_ns) {
+    uint64_t counts[LDC_ERROR_CHANNELS][LDC_NUM_ERRORS];
+    int any = 0;
+
+    if (now_ns - report->last_ns < report->interval_ns) return 0;
+    for (int ch = 0; ch < LDC_ERROR_CHANNELS; ch++) {
+        for (int b = 0; b < LDC_NUM_ERRORS; b++) {
+            counts[ch][b] = atomic_load_explicit(&c->bits[ch][b], memory_order_relaxed);
+            any |= (counts[ch][b] != report->reported[ch][b]);
+        }
+    }
+    if (!any) return 0;
+
+    fprintf(f, "Conversion errors in the last %.1f s:", (now_ns - report->last_ns) / 1e9);
+    for (int ch = 0; ch < LDC_ERROR_CHANNELS; ch++) {
+        for (int b = LDC_NUM_ERRORS - 1; b >= 0; b--) {
+            uint64_t n = counts[ch][b] - report->reported[ch][b];
+            if (n != 0) fprintf(f, " CH%d %llu %s", ch, (unsigned long long)n, error_names[b]);
+            report->reported[ch][b] = counts[ch][b];
+        }
+    }
+    fprintf(f, "\n");
+    report->last_ns = now_ns;
+    return 1;
+}
+
+void ldc_errors_dump(const struct ldc_error_counts *c, FILE *f) {
+    for (int ch = 0; ch < LDC_ERROR_CHANNELS; ch++) {
+        uint64_t samples = atomic_load_explicit(&c->samples[ch], memory_order_relaxed);
+        if (samples == 0) continue;
+        fprintf(f, "CH%d: %llu samples with errors (", ch, (unsigned long long)samples);
+        for (int b = LDC_NUM_ERRORS - 1; b >= 0; b--) {
+            fprintf(f, "%s %llu%s", error_names[b],
+                    (unsigned long long)atomic_load_explicit(&c->bits[ch][b], memory_order_relaxed),
+                    (b > 0) ? ", " : ")\n");
+        }
+    }
+}
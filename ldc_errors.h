@@ -0,0 +1,65 @@
+/*
+ * ldc_errors.h
+ *
+ * Per-channel tallies of the conversion error bits (under-range,
+ * over-range, watchdog and amplitude) and a rate-limited summary of them.
+ *
+ * The bits stay attached to every sample (struct ldc1614_burst.errors, the
+ * log's flags, the protocol's record flags); these counters are what gets
+ * reported instead of a message per sample. Counting is one compare for an
+ * error-free sample and relaxed atomic adds otherwise, so the acquisition
+ * thread counts while any other thread reports.
+ */
+
+#ifndef INC_LDC_ERRORS_H_
+#define INC_LDC_ERRORS_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "ldc1614.h"
+
+// Bit numbers within LDC1614_DATA_ERRORS()
+#define LDC_ERR_AE      0 // amplitude high or low
+#define LDC_ERR_WD      1 // watchdog, sensor not oscillating
+#define LDC_ERR_OR      2 // over-range
+#define LDC_ERR_UR      3 // under-range
+#define LDC_NUM_ERRORS  4
+#define LDC_ERROR_CHANNELS 32 // room for several devices: ldc_service counts device d's CHn at d * 8 + n
+
+struct ldc_error_counts {
+    _Atomic uint64_t samples[LDC_ERROR_CHANNELS];                // samples with any error bit set
+    _Atomic uint64_t bits[LDC_ERROR_CHANNELS][LDC_NUM_ERRORS];   // samples with each bit, by LDC_ERR_*
+};
+
+// State of the rate-limited summary
+struct ldc_error_report {
+    uint64_t interval_ns;    // minimum time between two summaries
+    uint64_t last_ns;        // when the last summary was printed, set to the start time before the first
+    uint64_t reported[LDC_ERROR_CHANNELS][LDC_NUM_ERRORS]; // counts covered by earlier summaries
+};
+
+// Tally the DATAx error bits of one sample of channel ch (< LDC_ERROR_CHANNELS)
+static inline void ldc_errors_count(struct ldc_error_counts *c, int ch, uint8_t errors) {
+    if (errors == 0) return;
+    atomic_fetch_add_explicit(&c->samples[ch], 1, memory_order_relaxed);
+    for (int b = 0; b < LDC_NUM_ERRORS; b++) {
+        if (errors & (1 << b)) atomic_fetch_add_explicit(&c->bits[ch][b], 1, memory_order_relaxed);
+    }
+}
+
+// Short name of error bit b (LDC_ERR_*), e.g. "over-range"
+const char *ldc_errors_name(int b);
+
+/**
+ * @brief Print the errors counted since the previous summary, at most once per
+ * report->interval_ns and only if there were any.
+ * @param now_ns current CLOCK_MONOTONIC time
+ * @return 1 if a summary was printed, 0 otherwise
+ */
+int ldc_errors_report(const struct ldc_error_counts *c, struct ldc_error_report *report, FILE *f, uint64_t now_ns);
+
+// Print the totals of every channel with errors, e.g. at the end of a run
+void ldc_errors_dump(const struct ldc_error_counts *c, FILE *f);
+
+#endif /* INC_LDC_ERRORS_H_ */
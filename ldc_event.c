@@ -0,0 +1,107 @@
+// Source file for the conversion-ready event sources.
+#include "ldc_event.h"
+#include "ldc_time.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+
+#define GPIO_EVENT_BATCH 16
+
+static int gpio_wait(struct ldc_event_source *src, int timeout_ms, uint64_t *t_ns) {
+    struct pollfd pfd = { .fd = src->fd, .events = POLLIN };
+    struct gpio_v2_line_event events[GPIO_EVENT_BATCH];
+
+    int ret = poll(&pfd, 1, timeout_ms);
+    if (ret <= 0) {
+        return (ret == 0 || errno == EINTR) ? 0 : -1;
+    }
+
+    ssize_t n = read(src->fd, events, sizeof(events));
+    if (n < (ssize_t)sizeof(events[0])) {
+        return (n < 0 && errno == EINTR) ? 0 : -1;
+    }
+    // Edges that queued up while we were busy collapse into one read of the newest data
+    int count = n / sizeof(events[0]);
+    src->overruns += count - 1;
+    *t_ns = events[count - 1].timestamp_ns; // CLOCK_MONOTONIC unless realtime stamps are requested
+    return 1;
+}
+
+static int timer_wait(struct ldc_event_source *src, int timeout_ms, uint64_t *t_ns) {
+    (void)timeout_ms;
+    // Absolute deadlines so the period does not drift
+    src->next_ns += src->period_ns;
+    uint64_t now = ldc_now_ns();
+    if (now > src->next_ns) {
+        // Deadlines that passed while the caller was busy collapse into one wakeup, like queued edges
+        uint64_t behind = (now - src->next_ns) / src->period_ns;
+        src->overruns += behind;
+        src->next_ns += behind * src->period_ns;
+    }
+    struct timespec next_time = ldc_ns_to_timespec(src->next_ns);
+    int ret = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_time, NULL);
+    if (ret != 0) {
+        return (ret == EINTR) ? 0 : -1;
+    }
+    *t_ns = 0; // no event time, the caller stamps the sample after reading it
+    return 1;
+}
+
+static void fd_close(struct ldc_event_source *src) {
+    if (src->fd >= 0) close(src->fd);
+    src->fd = -1;
+}
+
+int ldc_event_open_gpio(struct ldc_event_source *src, const char *chip, unsigned int line) {
+    memset(src, 0, sizeof(*src));
+    src->fd = -1;
+
+    int chip_fd = open(chip, O_RDONLY | O_CLOEXEC);
+    if (chip_fd < 0) {
+        fprintf(stderr, "Failed to open %s: %s\n", chip, strerror(errno));
+        return -1;
+    }
+
+    // INTB is open drain and driven low while a conversion result is unread
+    struct gpio_v2_line_request req;
+    memset(&req, 0, sizeof(req));
+    req.offsets[0] = line;
+    req.num_lines = 1;
+    req.event_buffer_size = GPIO_EVENT_BATCH;
+    req.config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_FALLING |
+                       GPIO_V2_LINE_FLAG_BIAS_PULL_UP;
+    strncpy(req.consumer, "ldc1614-intb", sizeof(req.consumer) - 1);
+
+    int ret = ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &req);
+    close(chip_fd);
+    if (ret < 0) {
+        fprintf(stderr, "Failed to request GPIO line %u on %s: %s\n", line, chip, strerror(errno));
+        return -1;
+    }
+
+    src->wait = gpio_wait;
+    src->close = fd_close;
+    src->name = "INTB";
+    src->fd = req.fd;
+    return 0;
+}
+
+int ldc_event_open_timer(struct ldc_event_source *src, uint64_t period_ns) {
+    memset(src, 0, sizeof(*src));
+    src->wait = timer_wait;
+    src->name = "timer";
+    src->fd = -1;
+    src->period_ns = period_ns;
+    src->next_ns = ldc_now_ns();
+    return 0;
+}
+
+void ldc_event_close(struct ldc_event_source *src) {
+    if (src->close) src->close(src);
+}
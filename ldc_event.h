@@ -0,0 +1,50 @@
+/*
+ * ldc_event.h
+ *
+ * Conversion-ready event sources for the acquisition loop.
+ *
+ * The GPIO source blocks on the LDC1614 INTB data-ready edge through the
+ * Linux GPIO character device and reports the kernel's edge timestamp.
+ * The timer source wakes on a fixed period for boards without INTB wired.
+ * Other sources (e.g. a fake driven by a test) only need to fill in wait().
+ */
+
+#ifndef INC_LDC_EVENT_H_
+#define INC_LDC_EVENT_H_
+
+#include <stdint.h>
+
+#define LDC_GPIO_CHIP   "/dev/gpiochip0"
+#define LDC_INTB_LINE   17   // BCM GPIO 17 (wiringPi pin 0)
+
+struct ldc_event_source {
+    /**
+     * @brief Block until the next conversion is ready.
+     * @param timeout_ms give up after this long so the caller can check for shutdown
+     * @param t_ns event time (CLOCK_MONOTONIC), 0 if the source has none
+     * @return 1 on event, 0 on timeout, -1 on error
+     */
+    int (*wait)(struct ldc_event_source *src, int timeout_ms, uint64_t *t_ns);
+    void (*close)(struct ldc_event_source *src);
+    const char *name;
+    int fd;              // pollable descriptor, -1 if none
+    uint64_t period_ns;  // timer source period
+    uint64_t next_ns;    // timer source next deadline
+    uint32_t overruns;   // events that arrived while a previous one was still pending, or timer periods skipped
+    void *ctx;           // private state of custom sources
+};
+
+/**
+ * @brief Request an INTB line as a falling-edge event source.
+ * @param chip GPIO character device, e.g. LDC_GPIO_CHIP
+ * @param line line offset on that chip
+ * @return 0 on success, -1 on failure
+ */
+int ldc_event_open_gpio(struct ldc_event_source *src, const char *chip, unsigned int line);
+
+// Fixed-period fallback source
+int ldc_event_open_timer(struct ldc_event_source *src, uint64_t period_ns);
+
+void ldc_event_close(struct ldc_event_source *src);
+
+#endif /* INC_LDC_EVENT_H_ */
@@ -0,0 +1,227 @@
+// Source file for the fixed-point filter pipeline.
+#include "ldc_filter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define LANES         LDC_FILTER_LANES
+#define IIR1_FRAC     16   // single-pole state fraction bits
+#define BIQUAD_COEF   24   // biquad coefficient fraction bits
+#define BIQUAD_FRAC   4    // biquad output history fraction bits
+#define VALUE_MAX     0x0FFFFFFF // outputs stay in the 28-bit range of the raw results
+
+static int32_t clamp_value(int64_t v) {
+    return (int32_t)(v < 0 ? 0 : (v > VALUE_MAX ? VALUE_MAX : v));
+}
+
+static uint8_t run_ma(struct ldc_filter_stage *s, uint8_t mask, int32_t *x) {
+    for (int l = 0; l < LANES; l++) {
+        if (!(mask & (1 << l))) continue;
+        int p = s->pos[l];
+        s->sum[l] += x[l] - s->hist[p][l];
+        s->hist[p][l] = x[l];
+        s->pos[l] = (p + 1 == s->n) ? 0 : p + 1;
+        if (s->fill[l] < s->n) s->fill[l]++;
+        // Until the window is full this is the average of what has arrived
+        x[l] = (int32_t)((s->sum[l] + s->fill[l] / 2) / s->fill[l]);
+    }
+    return mask;
+}
+
+static uint8_t run_median(struct ldc_filter_stage *s, uint8_t mask, int32_t *x) {
+    int32_t w[LDC_FILTER_MAX_MEDIAN];
+    for (int l = 0; l < LANES; l++) {
+        if (!(mask & (1 << l))) continue;
+        s->hist[s->pos[l]][l] = x[l];
+        s->pos[l] = (s->pos[l] + 1 == s->n) ? 0 : s->pos[l] + 1;
+        if (s->fill[l] < s->n) s->fill[l]++;
+        // Insertion sort of at most 9 values
+        int n = s->fill[l];
+        for (int i = 0; i < n; i++) {
+            int32_t v = s->hist[i][l];
+            int j = i;
+            while (j > 0 && w[j - 1] > v) {
+                w[j] = w[j - 1];
+                j--;
+            }
+            w[j] = v;
+        }
+        x[l] = w[n / 2];
+    }
+    return mask;
+}
+
+// The arithmetic stages compute every lane and keep the result only where mask is set,
+// so the loops have no branches and compile to vector code across the channels.
+static uint8_t run_iir1(struct ldc_filter_stage *s, uint8_t mask, int32_t *x) {
+    for (int l = 0; l < LANES; l++) {
+        int on = (mask >> l) & 1;
+        int64_t in = (int64_t)x[l] << IIR1_FRAC;
+        int64_t y = s->primed[l] ? s->y[l] + (((in - s->y[l]) * s->alpha) >> 16) : in;
+        s->y[l] = on ? y : s->y[l];
+        s->primed[l] |= on;
+        x[l] = (int32_t)((s->y[l] + (1 << (IIR1_FRAC - 1))) >> IIR1_FRAC);
+    }
+    return mask;
+}
+
+static uint8_t run_biquad(struct ldc_filter_stage *s, uint8_t mask, int32_t *x) {
+    for (int l = 0; l < LANES; l++) {
+        int on = (mask >> l) & 1;
+        int64_t in = x[l];
+        // Start from steady state at the first input instead of ringing up from zero
+        int64_t x1 = s->primed[l] ? s->x1[l] : in, x2 = s->primed[l] ? s->x2[l] : in;
+        int64_t y1 = s->primed[l] ? s->y1[l] : in << BIQUAD_FRAC;
+        int64_t y2 = s->primed[l] ? s->y2[l] : in << BIQUAD_FRAC;
+        // Direct form I; inputs scaled up to the output history's fraction bits
+        int64_t acc = ((s->b[0] * in + s->b[1] * x1 + s->b[2] * x2) << BIQUAD_FRAC) - s->a[0] * y1 - s->a[1] * y2;
+        int64_t y = acc >> BIQUAD_COEF; // Q BIQUAD_FRAC
+        s->x2[l] = on ? x1 : s->x2[l];
+        s->x1[l] = on ? in : s->x1[l];
+        s->y2[l] = on ? y1 : s->y2[l];
+        s->y1[l] = on ? y : s->y1[l];
+        s->primed[l] |= on;
+        x[l] = clamp_value((s->y1[l] + (1 << (BIQUAD_FRAC - 1))) >> BIQUAD_FRAC);
+    }
+    return mask;
+}
+
+static uint8_t run_cic(struct ldc_filter_stage *s, uint8_t mask, int32_t *x) {
+    uint8_t out = 0;
+    for (int l = 0; l < LANES; l++) {
+        if (!(mask & (1 << l))) continue;
+        // Integrators at the input rate; unsigned wraparound cancels in the combs
+        uint64_t v = (uint64_t)x[l];
+        for (int k = 0; k < s->n; k++) {
+            s->integ[k][l] += v;
+            v = s->integ[k][l];
+        }
+        if (++s->pos[l] < s->r) continue;
+        s->pos[l] = 0;
+        // Combs at the output rate
+        for (int k = 0; k < s->n; k++) {
+            uint64_t prev = s->comb[k][l];
+            s->comb[k][l] = v;
+            v -= prev;
+        }
+        // The first order - 1 outputs still contain the zeros the filter started from
+        if (s->fill[l] < s->n - 1) {
+            s->fill[l]++;
+            continue;
+        }
+        x[l] = (int32_t)(s->shift >= 0 ? (v + (s->gain >> 1)) >> s->shift : (v + s->gain / 2) / s->gain);
+        out |= 1 << l;
+    }
+    return out;
+}
+
+uint8_t ldc_filter_run(struct ldc_filter *f, uint8_t mask, int32_t x[LDC_FILTER_LANES]) {
+    for (int i = 0; i < f->num_stages && mask != 0; i++) {
+        struct ldc_filter_stage *s = &f->stages[i];
+        switch (s->type) {
+            case LDC_FILTER_MA:     mask = run_ma(s, mask, x); break;
+            case LDC_FILTER_CIC:    mask = run_cic(s, mask, x); break;
+            case LDC_FILTER_IIR1:   mask = run_iir1(s, mask, x); break;
+            case LDC_FILTER_BIQUAD: mask = run_biquad(s, mask, x); break;
+            case LDC_FILTER_MEDIAN: mask = run_median(s, mask, x); break;
+        }
+    }
+    return mask;
+}
+
+void ldc_filter_reset(struct ldc_filter *f) {
+    for (int i = 0; i < f->num_stages; i++) {
+        struct ldc_filter_stage *s = &f->stages[i];
+        memset(s->hist, 0, sizeof(s->hist));
+        memset(s->sum, 0, sizeof(s->sum));
+        memset(s->pos, 0, sizeof(s->pos));
+        memset(s->fill, 0, sizeof(s->fill));
+        memset(s->integ, 0, sizeof(s->integ));
+        memset(s->comb, 0, sizeof(s->comb));
+        memset(s->y, 0, sizeof(s->y));
+        memset(s->x1, 0, sizeof(s->x1));
+        memset(s->x2, 0, sizeof(s->x2));
+        memset(s->y1, 0, sizeof(s->y1));
+        memset(s->y2, 0, sizeof(s->y2));
+        memset(s->primed, 0, sizeof(s->primed));
+    }
+}
+
+// RBJ low pass, quantized so the DC gain is exactly one
+static void design_biquad(struct ldc_filter_stage *s, double fc, double q) {
+    double w0 = 2.0 * M_PI * fc, alpha = sin(w0) / (2.0 * q), a0 = 1.0 + alpha;
+    double one = (double)(1 << BIQUAD_COEF);
+
+    s->b[0] = llround((1.0 - cos(w0)) / 2.0 / a0 * one);
+    s->b[2] = s->b[0];
+    s->a[0] = llround(-2.0 * cos(w0) / a0 * one);
+    s->a[1] = llround((1.0 - alpha) / a0 * one);
+    // b0 + b1 + b2 must equal 1 + a1 + a2, or a raw offset of ~2^27 turns into a visible DC error
+    s->b[1] = (int64_t)(1 << BIQUAD_COEF) + s->a[0] + s->a[1] - s->b[0] - s->b[2];
+}
+
+static int parse_stage(struct ldc_filter_stage *s, const char *spec) {
+    char type[16];
+    double fc = 0.0, q = M_SQRT1_2;
+    int n = 0, r = 0;
+
+    memset(s, 0, sizeof(*s));
+    if (sscanf(spec, "%15[a-z0-9]", type) != 1) return -1;
+    const char *args = spec + strlen(type);
+
+    if (strcmp(type, "ma") == 0) {
+        if (sscanf(args, ":%d", &n) != 1 || n < 1 || n > LDC_FILTER_MAX_TAPS) return -1;
+        s->type = LDC_FILTER_MA;
+        s->n = n;
+    } else if (strcmp(type, "median") == 0) {
+        if (sscanf(args, ":%d", &n) != 1 || n < 1 || n > LDC_FILTER_MAX_MEDIAN || n % 2 == 0) return -1;
+        s->type = LDC_FILTER_MEDIAN;
+        s->n = n;
+    } else if (strcmp(type, "cic") == 0) {
+        if (sscanf(args, ":%d:%d", &n, &r) != 2 || n < 1 || n > LDC_FILTER_MAX_ORDER ||
+            r < 1 || r > LDC_FILTER_MAX_DECIM) {
+            return -1;
+        }
+        s->type = LDC_FILTER_CIC;
+        s->n = n;
+        s->r = r;
+        s->gain = 1;
+        for (int k = 0; k < n; k++) s->gain *= r;
+        s->shift = ((r & (r - 1)) == 0) ? __builtin_ctzll(s->gain) : -1;
+    } else if (strcmp(type, "iir1") == 0) {
+        if (sscanf(args, ":%lf", &fc) != 1 || fc <= 0.0 || fc >= 0.5) return -1;
+        s->type = LDC_FILTER_IIR1;
+        s->alpha = (int32_t)lround((1.0 - exp(-2.0 * M_PI * fc)) * 65536.0);
+        if (s->alpha < 1) s->alpha = 1;
+    } else if (strcmp(type, "biquad") == 0) {
+        int got = sscanf(args, ":%lf:%lf", &fc, &q);
+        if (got < 1 || fc <= 0.0 || fc >= 0.5 || q <= 0.0) return -1;
+        s->type = LDC_FILTER_BIQUAD;
+        design_biquad(s, fc, q);
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+int ldc_filter_parse(struct ldc_filter *f, const char *spec) {
+    char buf[256];
+    char *save = NULL;
+
+    memset(f, 0, sizeof(*f));
+    f->decimation = 1;
+    if (strlen(spec) >= sizeof(buf)) return -1;
+    strcpy(buf, spec);
+    for (char *tok = strtok_r(buf, ",", &save); tok != NULL; tok = strtok_r(NULL, ",", &save)) {
+        if (f->num_stages == LDC_FILTER_MAX_STAGES) return -1;
+        struct ldc_filter_stage *s = &f->stages[f->num_stages];
+        if (parse_stage(s, tok) != 0) {
+            fprintf(stderr, "Invalid filter stage: %s\n", tok);
+            return -1;
+        }
+        if (s->type == LDC_FILTER_CIC) f->decimation *= s->r;
+        f->num_stages++;
+    }
+    return (f->num_stages > 0) ? 0 : -1;
+}
@@ -0,0 +1,87 @@
+/*
+ * ldc_filter.h
+ *
+ * Fixed-point filter pipeline for the acquisition path.
+ *
+ * A pipeline is a chain of up to LDC_FILTER_MAX_STAGES stages, described by
+ * a comma separated spec such as "median:5,cic:3:16,biquad:0.05":
+ *
+ *     ma:N          moving average over N samples (N <= 64)
+ *     cic:M:R       CIC decimator of order M (1-4), output every R inputs (R <= 256)
+ *     iir1:FC       single-pole low pass, cutoff FC as a fraction of the input rate
+ *     biquad:FC[:Q] second-order low pass (Q defaults to 0.7071, Butterworth)
+ *     median:N      median of the last N samples (odd N <= 9), removes spikes
+ *
+ * Every stage keeps separate state per channel, laid out as one array per
+ * state variable indexed by channel, so the same arithmetic runs across all
+ * channels of an autoscan sequence in one loop. Samples are the 28-bit raw
+ * conversion results; stages work in integers only (Q16 for the single-pole
+ * state, Q24 biquad coefficients) so results are bit-exact on any host.
+ */
+
+#ifndef INC_LDC_FILTER_H_
+#define INC_LDC_FILTER_H_
+
+#include <stdint.h>
+
+#define LDC_FILTER_LANES      4   // channels filtered side by side
+#define LDC_FILTER_MAX_STAGES 8
+#define LDC_FILTER_MAX_TAPS   64  // longest moving average
+#define LDC_FILTER_MAX_MEDIAN 9
+#define LDC_FILTER_MAX_ORDER  4   // CIC order
+#define LDC_FILTER_MAX_DECIM  256 // CIC rate change
+
+enum ldc_filter_type {
+    LDC_FILTER_MA,
+    LDC_FILTER_CIC,
+    LDC_FILTER_IIR1,
+    LDC_FILTER_BIQUAD,
+    LDC_FILTER_MEDIAN,
+};
+
+struct ldc_filter_stage {
+    enum ldc_filter_type type;
+    int n;             // MA/median length, CIC order
+    int r;             // CIC decimation
+    int32_t alpha;     // IIR1 coefficient, Q16
+    int64_t b[3], a[2]; // biquad coefficients, Q24
+    int shift;         // CIC gain R^M as a power of two, -1 if it is not one
+    uint64_t gain;     // CIC gain R^M
+
+    // Per-channel state, [lane] last
+    int32_t hist[LDC_FILTER_MAX_TAPS][LDC_FILTER_LANES]; // MA and median windows
+    int64_t sum[LDC_FILTER_LANES];                       // MA running sum
+    int pos[LDC_FILTER_LANES];                           // window position, CIC input count
+    int fill[LDC_FILTER_LANES];                          // samples seen, up to the window length
+    uint64_t integ[LDC_FILTER_MAX_ORDER][LDC_FILTER_LANES]; // CIC integrators, wrap by design
+    uint64_t comb[LDC_FILTER_MAX_ORDER][LDC_FILTER_LANES];  // CIC comb delays
+    int64_t y[LDC_FILTER_LANES];                            // IIR1 output, Q16
+    int64_t x1[LDC_FILTER_LANES], x2[LDC_FILTER_LANES];     // biquad input history
+    int64_t y1[LDC_FILTER_LANES], y2[LDC_FILTER_LANES];     // biquad output history
+    int primed[LDC_FILTER_LANES];                           // IIR state seeded with the first input
+};
+
+struct ldc_filter {
+    int num_stages;
+    int decimation;    // product of the CIC rate changes
+    struct ldc_filter_stage stages[LDC_FILTER_MAX_STAGES];
+};
+
+/**
+ * @brief Build a pipeline from a spec string (see above).
+ * @return 0 on success, -1 on a malformed or out of range stage
+ */
+int ldc_filter_parse(struct ldc_filter *f, const char *spec);
+
+// Clear every stage's state, e.g. after the sensor settings changed
+void ldc_filter_reset(struct ldc_filter *f);
+
+/**
+ * @brief Run one sample per channel through the pipeline.
+ * @param mask channels with a new input (bit n = lane n)
+ * @param x inputs on entry, outputs on return, indexed by lane
+ * @return channels with an output in x; decimating stages hold back the rest
+ */
+uint8_t ldc_filter_run(struct ldc_filter *f, uint8_t mask, int32_t x[LDC_FILTER_LANES]);
+
+#endif /* INC_LDC_FILTER_H_ */
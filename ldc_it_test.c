@@ -7,13 +7,11 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <time.h>
-#include <wiringPi.h>
-#include <wiringPiI2C.h>
 #include "ldc1614.h"
-
-#define INTB 0// interrupt pin number (BCM GPIO 17 is wiringpi 0)
-
-int data_ready = 0;
+#include "ldc_bus.h"
+#include "ldc_sim.h"
+#include "ldc_event.h"
+#include "ldc_time.h"
 
 /**
  * @brief Calculate the elapsed time between two timespec structures.
@@ -34,38 +32,31 @@ struct timespec get_elapsed_time(struct timespec start, struct timespec end) {
     return elapsed;
 }
 
-/**
- * @brief Interrupt Service Routine (ISR) for handling data ready signal from LDC1614.
- * This function is called when the INTB pin goes low, indicating that data is ready to be read.
- */
-void LDC_ISR(void) {
-    data_ready = 1; // Set the data ready flag to indicate that data is available
-}
-
 int main(int argc, char *argv[]) {
 
     // private variables 
     int opt = 0; // option for command line argument parsing
-    int devID = 0x3055; // Device ID for LDC1614
-    int i2c_fd = 0; // File descriptor for LDC1614 I2C bus
+    int devID = LDC1614_DEVICE_ID_VALUE; // Device ID for LDC1614
+    struct ldc_bus bus; // Register access to the LDC1614
+    char bus_spec[64] = LDC_BUS_DEFAULT; // i2c-dev adapter, "wiringpi" or "sim[:options]"
     int channel = 0; // Default channel to use
     uint32_t value = 0; // Variable to hold measurement value
-    uint16_t status = 0; // Variable to hold status register value
     int ret = 0; // Return value for function calls
     char logfile[50] = "./testing/ldc1614_log.csv"; // default logfile name
     int log_fd = -1; // File descriptor for log file
     int num_samples = 10; // default number of samples to read
-    int num_steps = 1; // Number of steps for command value increment
     struct timespec start_time; // t0
     struct timespec current_time; // t 
     struct timespec elapsed_time; // Timestamp for datalogging (t - t0)
+    struct ldc_event_source intb; // INTB data-ready edges
+    uint64_t t_event = 0; // kernel timestamp of the edge
 
 
     // Initialize the timer and logger 
     clock_gettime(CLOCK_MONOTONIC, &start_time); // Start time measurement
 
      // Parse command line arguments for logfile, and number of samples
-    while ((opt = getopt(argc, argv, "hn:l:v:s:")) != -1) {
+    while ((opt = getopt(argc, argv, "hn:l:v:s:d:")) != -1) {
         switch(opt) {
             case 'l':
                 strncpy(logfile, optarg, sizeof(logfile) - 1); // Set logfile name
@@ -79,24 +70,31 @@ int main(int argc, char *argv[]) {
                     return -1; // Exit if invalid number of samples
                 }
                 break;
+            case 'd':
+                strncpy(bus_spec, optarg, sizeof(bus_spec) - 1); // Set LDC1614 bus
+                bus_spec[sizeof(bus_spec) - 1] = '\0';
+                break;
             default:
-                fprintf(stderr, "Usage: %s [-l logfile] [-n num_samples] [-v command] [-s number of steps]\n", argv[0]);
+                fprintf(stderr, "Usage: %s [-l logfile] [-n num_samples] [-v command] [-s number of steps] [-d bus]\n", argv[0]);
                 return -1; // Exit on invalid option
         }
     }
 
-    // initialize wiringPi library
-    wiringPiSetupGpio();
-    pinMode (INTB, INPUT);
-    pullUpDnControl(INTB,PUD_UP); // 
-    // Set up interrupt on the INTB pin
-    wiringPiISR(INTB, INT_EDGE_BOTH, &LDC_ISR);
+    // Open the bus the LDC1614 is on
+    if (ldc_bus_open(&bus, bus_spec, LDC1614_ADDR) != 0) {
+        printf("Failed to open LDC1614 bus %s\n", bus_spec);
+        return -1;
+    }
 
-    // Initialize wiringPi library and get the file descriptor for I2C communication
-    i2c_fd = wiringPiI2CSetup(LDC1614_ADDR);
+    // Request INTB (BCM GPIO 17) as a falling-edge event line with pull-up, a simulated device has its own
+    if ((ldc_bus_is_sim(&bus) ? ldc_event_open_sim(&intb, &bus)
+                              : ldc_event_open_gpio(&intb, LDC_GPIO_CHIP, LDC_INTB_LINE)) != 0) {
+        printf("Failed to set up INTB interrupt line\n");
+        return -1;
+    }
 
     // Initialize the LDC1614 for the specified channel 
-    if (ldc1614_init(i2c_fd, channel) != 0) {
+    if (ldc1614_init(&bus, channel) != 0) {
         printf("Failed to initialize LDC1614 on channel %d: %s\n", channel, strerror(errno));
         return -1;
     } else {
@@ -105,7 +103,7 @@ int main(int argc, char *argv[]) {
 
     uint16_t ID = 0;
     // Read the device ID to confirm communication
-    ret = ldc1614_read_reg(i2c_fd, LDC1614_DEVICE_ID, &ID);
+    ret = ldc1614_read_reg(&bus, LDC1614_DEVICE_ID, &ID);
     if (ret == -1) {
         printf("Failed to read device ID: %s\n", strerror(errno));
         return -1;
@@ -130,28 +128,39 @@ int main(int argc, char *argv[]) {
         return -1; // Exit if writing header fails
     }
     for(int i=0; i < num_samples;) {
-        
-        if(data_ready == 1){
+        // Sleep in the kernel until INTB falls instead of spinning on a flag
+        int ev = intb.wait(&intb, 1000, &t_event);
+        if (ev < 0) {
+            fprintf(stderr, "Failed to wait for INTB: %s\n", strerror(errno));
+            break;
+        }
+        if (ev == 0) {
+            // No edge for a second: reading STATUS below re-arms INTB
+            printf("Timed out waiting for INTB\n");
+        } else {
             i++; // Increment sample count
-            data_ready = 0; // Reset data ready flag
-            // Read the value from channel 0
-            if(ret = ldc1614_read_ch0(i2c_fd, &value)==-1){
-                printf("Failed to read value: %s\n", strerror(errno));
-                // return -1;
-            } else {
-                clock_gettime(CLOCK_MONOTONIC, &current_time); // Get current time for timestamp
-                elapsed_time = get_elapsed_time(start_time, current_time); // Calculate elapsed time
-                char data_line[80]; 
-                int line_length = 0; 
-                line_length =  sprintf( data_line, "%d, %ld.%09ld, %d\n", channel,elapsed_time.tv_sec,elapsed_time.tv_nsec, value); // format data into a string
-                if (write(log_fd, data_line, line_length) == -1) {
-                    fprintf(stderr, "Failed to write data to log file: %s\n", strerror(errno));
-                    close(log_fd);
-                    return -1; // Exit with error if data write fails
-                }
+        }
+        // Read the value from channel 0
+        if((ret = ldc1614_read_ch0(&bus, &value))==-1){
+            printf("Failed to read value: %s\n", strerror(errno));
+            // return -1;
+        } else if (ev > 0) {
+            current_time = ldc_ns_to_timespec(t_event); // Edge time for timestamp
+            elapsed_time = get_elapsed_time(start_time, current_time); // Calculate elapsed time
+            char data_line[80]; 
+            int line_length = 0; 
+            line_length =  sprintf( data_line, "%d, %ld.%09ld, %d\n", channel,elapsed_time.tv_sec,elapsed_time.tv_nsec, value); // format data into a string
+            if (write(log_fd, data_line, line_length) == -1) {
+                fprintf(stderr, "Failed to write data to log file: %s\n", strerror(errno));
+                close(log_fd);
+                return -1; // Exit with error if data write fails
             }
         }
 
     }
 
-}
\ No newline at end of file
+    ldc_event_close(&intb);
+    ldc_bus_close(&bus);
+    close(log_fd);
+    return 0;
+}
@@ -0,0 +1,278 @@
+// Source file for the asynchronous sample logger.
+#include "ldc_log.h"
+#include "ldc_time.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+
+#define QUEUE_MASK (LDC_LOG_QUEUE_LEN - 1)
+#define MAX_LINE   64 // longest CSV line the formatter can produce
+
+int ldc_fmt_u64(char *p, uint64_t v) {
+    char tmp[20];
+    int n = 0;
+    do {
+        tmp[n++] = '0' + (v % 10);
+        v /= 10;
+    } while (v != 0);
+    for (int i = 0; i < n; i++) {
+        p[i] = tmp[n - 1 - i];
+    }
+    return n;
+}
+
+int ldc_fmt_i64(char *p, int64_t v) {
+    if (v < 0) {
+        *p = '-';
+        return 1 + ldc_fmt_u64(p + 1, -(uint64_t)v);
+    }
+    return ldc_fmt_u64(p, v);
+}
+
+int ldc_fmt_time(char *p, uint64_t t_ns) {
+    int n = ldc_fmt_u64(p, t_ns / NS_PER_SEC);
+    uint32_t frac = t_ns % NS_PER_SEC;
+    p[n++] = '.';
+    for (int i = 8; i >= 0; i--) {
+        p[n + i] = '0' + (frac % 10);
+        frac /= 10;
+    }
+    return n + 9;
+}
+
+// "channel,seconds.nanoseconds,value,command\n"
+static int format_csv(char *p, const struct ldc_log_rec *rec) {
+    int n = ldc_fmt_u64(p, rec->channel);
+    p[n++] = ',';
+    n += ldc_fmt_time(p + n, rec->t_ns);
+    p[n++] = ',';
+    n += ldc_fmt_u64(p + n, rec->value);
+    p[n++] = ',';
+    n += ldc_fmt_i64(p + n, rec->cmd);
+    p[n++] = '\n';
+    return n;
+}
+
+// Close the partial binary block at buf + *used, zero-filling its unused records
+static void close_block(struct ldc_log *log, size_t *used) {
+    struct ldc_binlog_rec *recs = (struct ldc_binlog_rec *)(log->buf + *used + sizeof(struct ldc_binlog_block));
+    memset(recs + log->block_count, 0, (LDC_BINLOG_BLOCK_RECORDS - log->block_count) * sizeof(*recs));
+    *used += LDC_BINLOG_BLOCK_SIZE;
+    log->block_count = 0;
+}
+
+static void append_binary(struct ldc_log *log, size_t *used, const struct ldc_log_rec *rec) {
+    struct ldc_binlog_block *blk = (struct ldc_binlog_block *)(log->buf + *used);
+
+    // Deltas are 32-bit nanoseconds, so a gap over ~4.29 s starts a new block
+    if (log->block_count > 0 && rec->t_ns - blk->t0_ns > UINT32_MAX) {
+        close_block(log, used);
+        blk = (struct ldc_binlog_block *)(log->buf + *used);
+    }
+    if (log->block_count == 0) {
+        blk->t0_ns = rec->t_ns;
+        blk->reserved = 0;
+    }
+    struct ldc_binlog_rec *r = (struct ldc_binlog_rec *)(blk + 1) + log->block_count;
+    r->dt_ns = (rec->t_ns > blk->t0_ns) ? (uint32_t)(rec->t_ns - blk->t0_ns) : 0;
+    r->data = ((uint32_t)rec->flags << 28) | (rec->value & 0x0FFFFFFF);
+    r->cmd = rec->cmd;
+    r->channel = rec->channel;
+    r->reserved = 0;
+    blk->count = ++log->block_count;
+    if (log->block_count == LDC_BINLOG_BLOCK_RECORDS) {
+        *used += LDC_BINLOG_BLOCK_SIZE;
+        log->block_count = 0;
+    }
+}
+
+static int write_all(struct ldc_log *log, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(log->fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += n;
+        len -= n;
+        log->stats.bytes += n;
+        log->stats.writes++;
+    }
+    return 0;
+}
+
+// Write the complete data in buf[0, *used) and carry a partial binary block over to the start
+static int flush_buf(struct ldc_log *log, size_t *used) {
+    if (*used == 0) return 0;
+    if (write_all(log, log->buf, *used) != 0) return -1;
+    if (log->format == LDC_LOG_BINARY && log->block_count > 0) {
+        memmove(log->buf, log->buf + *used, LDC_BINLOG_BLOCK_SIZE);
+    }
+    *used = 0;
+    return 0;
+}
+
+// Format and write everything queued so far, returns -1 on a write error
+// A partial binary block stays at the start of buf until it fills up or the log is closed.
+static int drain(struct ldc_log *log) {
+    uint64_t tail = atomic_load_explicit(&log->tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&log->head, memory_order_acquire);
+    uint64_t backlog = head - tail;
+    size_t used = 0;
+
+    if (backlog > log->stats.max_backlog) log->stats.max_backlog = backlog;
+    if (backlog > LDC_LOG_QUEUE_LEN / 2) log->stats.behind++;
+
+    while (tail != head) {
+        const struct ldc_log_rec *rec = &log->queue[tail & QUEUE_MASK];
+        int full;
+        if (log->format == LDC_LOG_BINARY) {
+            append_binary(log, &used, rec);
+            // Keep room for the partial block plus one more in case a time gap closes it early
+            full = (used + 2 * LDC_BINLOG_BLOCK_SIZE > LDC_LOG_BUF_SIZE);
+        } else {
+            used += format_csv(log->buf + used, rec);
+            full = (used > LDC_LOG_BUF_SIZE - MAX_LINE);
+        }
+        tail++;
+        log->stats.records++;
+        if (full) {
+            // Release the slots before the (possibly slow) write so the producer can reuse them
+            atomic_store_explicit(&log->tail, tail, memory_order_release);
+            if (flush_buf(log, &used) != 0) return -1;
+        }
+    }
+    atomic_store_explicit(&log->tail, tail, memory_order_release);
+    return flush_buf(log, &used);
+}
+
+// Write out the partial binary block, if any
+static int flush_block(struct ldc_log *log) {
+    size_t used = 0;
+    if (log->format != LDC_LOG_BINARY || log->block_count == 0) return 0;
+    close_block(log, &used);
+    return write_all(log, log->buf, used);
+}
+
+static void *writer_thread(void *arg) {
+    struct ldc_log *log = arg;
+    struct timespec next_time;
+    int failed = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &next_time);
+    while (!atomic_load(&log->stop)) {
+        if (!failed && drain(log) != 0) {
+            fprintf(stderr, "Failed to write log file: %s\n", strerror(errno));
+            failed = 1;
+        }
+        next_time.tv_nsec += LDC_LOG_PERIOD_NS;
+        if (next_time.tv_nsec >= 1000000000L) {
+            next_time.tv_nsec -= 1000000000L;
+            next_time.tv_sec += 1;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_time, NULL);
+    }
+    // Whatever was pushed before close, including a partial binary block
+    if (!failed && (drain(log) != 0 || flush_block(log) != 0)) failed = 1;
+    return failed ? (void *)-1 : NULL;
+}
+
+enum ldc_log_format ldc_log_format_for(const char *path) {
+    size_t len = strlen(path);
+    return (len >= 4 && strcmp(path + len - 4, ".csv") == 0) ? LDC_LOG_CSV : LDC_LOG_BINARY;
+}
+
+static int write_header(struct ldc_log *log, const struct ldc_log_config *config) {
+    if (log->format == LDC_LOG_CSV) {
+        static const char header[] = "Channel,Timestamp,Value,Command\n";
+        return write_all(log, header, sizeof(header) - 1);
+    }
+
+    struct ldc_binlog_header hdr;
+    struct timespec real;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, LDC_BINLOG_MAGIC, sizeof(hdr.magic));
+    hdr.version = LDC_BINLOG_VERSION;
+    hdr.header_size = sizeof(hdr);
+    hdr.record_size = sizeof(struct ldc_binlog_rec);
+    hdr.block_records = LDC_BINLOG_BLOCK_RECORDS;
+    hdr.block_size = LDC_BINLOG_BLOCK_SIZE;
+    if (config != NULL) {
+        // Map the run's monotonic t = 0 onto wall-clock time
+        clock_gettime(CLOCK_REALTIME, &real);
+        uint64_t since_start = ldc_now_ns() - config->start_ns;
+        hdr.start_mono_ns = config->start_ns;
+        hdr.start_real_ns = ldc_timespec_to_ns(&real) - since_start;
+        hdr.channel_mask = config->channel_mask;
+        hdr.fref_hz = config->fref_hz;
+        hdr.config = config->config;
+        hdr.mux_config = config->mux_config;
+        hdr.error_config = config->error_config;
+        memcpy(hdr.channels, config->channels, sizeof(hdr.channels));
+    }
+    return write_all(log, (const char *)&hdr, sizeof(hdr));
+}
+
+struct ldc_log *ldc_log_open(const char *path, enum ldc_log_format format, const struct ldc_log_config *config) {
+    struct ldc_log *log = calloc(1, sizeof(*log));
+    if (log == NULL) return NULL;
+    log->format = format;
+
+    // Open the log file for writing only, create it if non-existent, and overwrite it if it exists
+    log->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (log->fd == -1) {
+        fprintf(stderr, "Failed to open log file %s: %s\n", path, strerror(errno));
+        free(log);
+        return NULL;
+    }
+    if (write_header(log, config) != 0) {
+        fprintf(stderr, "Failed to write header to log file: %s\n", strerror(errno));
+        close(log->fd);
+        free(log);
+        return NULL;
+    }
+
+    // Touch the queue and buffer now so the hot path never takes a page fault on them
+    memset(log->queue, 0, sizeof(log->queue));
+    memset(log->buf, 0, sizeof(log->buf));
+
+    if (pthread_create(&log->thread, NULL, writer_thread, log) != 0) {
+        fprintf(stderr, "Failed to start log writer thread\n");
+        close(log->fd);
+        free(log);
+        return NULL;
+    }
+    return log;
+}
+
+int ldc_log_push(struct ldc_log *log, const struct ldc_log_rec *rec) {
+    uint64_t head = atomic_load_explicit(&log->head, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&log->tail, memory_order_acquire);
+
+    if (head - tail >= LDC_LOG_QUEUE_LEN) {
+        atomic_fetch_add_explicit(&log->dropped, 1, memory_order_relaxed);
+        return -1; // writer fell behind, never wait for it
+    }
+    log->queue[head & QUEUE_MASK] = *rec;
+    atomic_store_explicit(&log->head, head + 1, memory_order_release);
+    return 0;
+}
+
+int ldc_log_close(struct ldc_log *log, struct ldc_log_stats *stats) {
+    void *ret = NULL;
+
+    atomic_store(&log->stop, 1);
+    pthread_join(log->thread, &ret);
+    log->stats.dropped = atomic_load(&log->dropped);
+    if (stats != NULL) *stats = log->stats;
+
+    int result = (ret == NULL) ? 0 : -1;
+    if (close(log->fd) != 0) result = -1;
+    free(log);
+    return result;
+}
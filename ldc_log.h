@@ -0,0 +1,154 @@
+/*
+ * ldc_log.h
+ *
+ * Asynchronous sample logger.
+ *
+ * The acquisition loop pushes fixed-size records into a preallocated
+ * single-producer/single-consumer queue; a dedicated writer thread formats
+ * them and writes the file in large batches. Pushing never blocks and never
+ * enters the kernel; if the writer falls so far behind that the queue is
+ * full, the record is dropped and counted.
+ *
+ * Logs are written either as CSV or in the compact binary format below:
+ *
+ *   ldc_binlog_header  (header_size bytes, records the device configuration)
+ *   block 0            (block_size bytes: ldc_binlog_block + block_records ldc_binlog_rec)
+ *   block 1 ...
+ *
+ * All blocks have the same size, so block i starts at
+ * header_size + i * block_size and a reader can mmap the file and binary
+ * search the block start times to seek. Record times are deltas from their
+ * block's t0_ns. Fields are little-endian.
+ */
+
+#ifndef INC_LDC_LOG_H_
+#define INC_LDC_LOG_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "ldc1614.h"
+
+#define LDC_LOG_QUEUE_LEN  8192          // records, must be a power of two
+#define LDC_LOG_BUF_SIZE   (256 * 1024)  // bytes formatted before each write()
+#define LDC_LOG_PERIOD_NS  20000000      // writer wakes every 20 ms
+
+#define LDC_BINLOG_MAGIC          "LDCLOG\0"  // 8 bytes including the terminator
+#define LDC_BINLOG_VERSION        1
+#define LDC_BINLOG_BLOCK_RECORDS  256
+
+enum ldc_log_format {
+    LDC_LOG_CSV,     // "Channel,Timestamp,Value,Command" text
+    LDC_LOG_BINARY,  // ldc_binlog_* records
+};
+
+// Device configuration recorded in the binary header
+struct ldc_log_config {
+    uint64_t start_ns;       // CLOCK_MONOTONIC at t = 0
+    uint32_t channel_mask;   // channels being logged
+    uint32_t fref_hz;        // reference clock
+    uint16_t config;         // CONFIG register
+    uint16_t mux_config;     // MUX_CONFIG register
+    uint16_t error_config;   // ERROR_CONFIG register
+    struct ldc1614_channel_config channels[LDC1614_NUM_CHANNELS];
+};
+
+struct ldc_binlog_header {
+    char magic[8];           // LDC_BINLOG_MAGIC
+    uint16_t version;
+    uint16_t header_size;    // offset of block 0
+    uint16_t record_size;    // sizeof(struct ldc_binlog_rec)
+    uint16_t block_records;  // records per block
+    uint32_t block_size;     // bytes per block including its header
+    uint32_t channel_mask;
+    uint64_t start_mono_ns;  // CLOCK_MONOTONIC at t = 0
+    uint64_t start_real_ns;  // CLOCK_REALTIME at t = 0
+    uint32_t fref_hz;
+    uint16_t config;
+    uint16_t mux_config;
+    uint16_t error_config;
+    uint16_t reserved[3];
+    struct ldc1614_channel_config channels[LDC1614_NUM_CHANNELS];
+} __attribute__((packed));
+
+struct ldc_binlog_block {
+    uint64_t t0_ns;          // time of the block's first record since t = 0
+    uint32_t count;          // valid records, the rest of the block is zero
+    uint32_t reserved;
+} __attribute__((packed));
+
+struct ldc_binlog_rec {
+    uint32_t dt_ns;          // time since the block's t0_ns
+    uint32_t data;           // DATAx layout: error bits 31:28, 28-bit value below
+    int16_t cmd;
+    uint8_t channel;
+    uint8_t reserved;
+} __attribute__((packed));
+
+#define LDC_BINLOG_BLOCK_SIZE (sizeof(struct ldc_binlog_block) + \
+                               LDC_BINLOG_BLOCK_RECORDS * sizeof(struct ldc_binlog_rec))
+
+// One logged sample
+struct ldc_log_rec {
+    uint64_t t_ns;    // time since the start of the run (ldc_log_config.start_ns)
+    uint32_t value;   // 28-bit raw conversion result
+    int16_t cmd;      // actuator command in effect
+    uint8_t channel;
+    uint8_t flags;    // LDC1614 error bits (UR/OR/WD/AE)
+};
+
+struct ldc_log_stats {
+    uint64_t records;     // records written
+    uint64_t bytes;       // bytes written
+    uint64_t writes;      // write() calls
+    uint64_t dropped;     // records lost because the queue was full
+    uint64_t behind;      // writer passes that found the queue more than half full
+    uint64_t max_backlog; // largest backlog seen by the writer
+};
+
+struct ldc_log {
+    int fd;
+    enum ldc_log_format format;
+    uint32_t block_count;     // records in the partial binary block at the start of buf
+    pthread_t thread;
+    _Atomic int stop;
+    _Atomic uint64_t head;    // next slot the producer fills
+    _Atomic uint64_t tail;    // next slot the writer drains
+    _Atomic uint64_t dropped;
+    struct ldc_log_stats stats; // owned by the writer thread until close
+    struct ldc_log_rec queue[LDC_LOG_QUEUE_LEN];
+    char buf[LDC_LOG_BUF_SIZE];
+};
+
+/**
+ * @brief Create the log file, write the header and start the writer thread.
+ * @param path file to create (truncated if it exists)
+ * @param format CSV or binary
+ * @param config device configuration for the binary header, may be NULL for CSV
+ * @return logger on success, NULL on failure
+ */
+struct ldc_log *ldc_log_open(const char *path, enum ldc_log_format format, const struct ldc_log_config *config);
+
+// CSV for paths ending in ".csv", binary otherwise
+enum ldc_log_format ldc_log_format_for(const char *path);
+
+/**
+ * @brief Queue one record (producer thread only, never blocks).
+ * @return 0 on success, -1 if the queue was full and the record was dropped
+ */
+int ldc_log_push(struct ldc_log *log, const struct ldc_log_rec *rec);
+
+/**
+ * @brief Drain the queue, stop the writer and close the file.
+ * @param stats filled with the final counters if not NULL
+ * @return 0 on success, -1 if any write failed
+ */
+int ldc_log_close(struct ldc_log *log, struct ldc_log_stats *stats);
+
+// Fast formatting helpers, return the number of characters written
+int ldc_fmt_u64(char *p, uint64_t v);
+int ldc_fmt_i64(char *p, int64_t v);
+int ldc_fmt_time(char *p, uint64_t t_ns); // seconds with 9 decimals
+
+#endif /* INC_LDC_LOG_H_ */
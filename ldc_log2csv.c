@@ -0,0 +1,166 @@
+// Convert a binary LDC1614 log to the "Channel,Timestamp,Value,Command" CSV format.
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "ldc_log.h"
+#include "ldc_time.h"
+
+#define OUT_BUF_SIZE (256 * 1024)
+
+/**
+ * @brief Find the first block that can hold records at or after t_ns.
+ * @note Block start times are increasing, so the blocks can be binary searched
+ * without reading any records.
+ */
+static size_t find_block(const uint8_t *blocks, size_t num_blocks, uint32_t block_size, uint64_t t_ns) {
+    size_t lo = 0, hi = num_blocks;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const struct ldc_binlog_block *blk = (const struct ldc_binlog_block *)(blocks + mid * block_size);
+        if (blk->t0_ns <= t_ns) lo = mid + 1;
+        else hi = mid;
+    }
+    return (lo > 0) ? lo - 1 : 0; // the block starting just before t_ns may contain it
+}
+
+int main(int argc, char *argv[]) {
+    int opt = 0;
+    double start_s = 0.0; // first timestamp to export
+    double end_s = -1.0;  // last timestamp to export, negative for no limit
+    const char *outfile = NULL;
+    int info = 0;
+
+    while ((opt = getopt(argc, argv, "hs:e:o:i")) != -1) {
+        switch (opt) {
+            case 's':
+                start_s = atof(optarg);
+                break;
+            case 'e':
+                end_s = atof(optarg);
+                break;
+            case 'o':
+                outfile = optarg;
+                break;
+            case 'i':
+                info = 1;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-s start_s] [-e end_s] [-o out.csv] [-i] logfile\n", argv[0]);
+                fprintf(stderr, "  -i : print the recorded device configuration instead of the samples\n");
+                return (opt == 'h') ? 0 : -1;
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "Usage: %s [-s start_s] [-e end_s] [-o out.csv] [-i] logfile\n", argv[0]);
+        return -1;
+    }
+
+    int fd = open(argv[optind], O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open %s: %s\n", argv[optind], strerror(errno));
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct ldc_binlog_header)) {
+        fprintf(stderr, "%s is not a binary LDC1614 log\n", argv[optind]);
+        close(fd);
+        return -1;
+    }
+    const uint8_t *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Failed to map %s: %s\n", argv[optind], strerror(errno));
+        return -1;
+    }
+
+    const struct ldc_binlog_header *hdr = (const struct ldc_binlog_header *)map;
+    if (memcmp(hdr->magic, LDC_BINLOG_MAGIC, sizeof(hdr->magic)) != 0 || hdr->version != LDC_BINLOG_VERSION ||
+        hdr->record_size != sizeof(struct ldc_binlog_rec)) {
+        fprintf(stderr, "%s is not a version %d binary LDC1614 log\n", argv[optind], LDC_BINLOG_VERSION);
+        munmap((void *)map, st.st_size);
+        return -1;
+    }
+    // Every record a block claims to hold has to lie within the block, and block 0 within the file
+    if (hdr->header_size < sizeof(*hdr) || hdr->header_size > (size_t)st.st_size ||
+        hdr->block_size < sizeof(struct ldc_binlog_block) ||
+        sizeof(struct ldc_binlog_block) + (uint64_t)hdr->block_records * hdr->record_size > hdr->block_size) {
+        fprintf(stderr, "%s has an invalid header\n", argv[optind]);
+        munmap((void *)map, st.st_size);
+        return -1;
+    }
+    size_t num_blocks = (st.st_size - hdr->header_size) / hdr->block_size;
+    const uint8_t *blocks = map + hdr->header_size;
+
+    if (info) {
+        printf("Channels: 0x%X, fREF %u Hz, CONFIG 0x%04X, MUX_CONFIG 0x%04X, ERROR_CONFIG 0x%04X\n",
+               hdr->channel_mask, hdr->fref_hz, hdr->config, hdr->mux_config, hdr->error_config);
+        for (int ch = 0; ch < LDC1614_NUM_CHANNELS; ch++) {
+            printf("CH%d: RCOUNT 0x%04X SETTLECOUNT 0x%04X CLOCK_DIVIDERS 0x%04X DRIVE_CURRENT 0x%04X\n", ch,
+                   hdr->channels[ch].rcount, hdr->channels[ch].settlecount,
+                   hdr->channels[ch].clock_dividers, hdr->channels[ch].drive_current);
+        }
+        printf("Start: %llu.%09llu (realtime), %zu blocks\n",
+               (unsigned long long)(hdr->start_real_ns / NS_PER_SEC),
+               (unsigned long long)(hdr->start_real_ns % NS_PER_SEC), num_blocks);
+        munmap((void *)map, st.st_size);
+        return 0;
+    }
+
+    FILE *out = stdout;
+    if (outfile != NULL && (out = fopen(outfile, "w")) == NULL) {
+        fprintf(stderr, "Failed to open %s: %s\n", outfile, strerror(errno));
+        munmap((void *)map, st.st_size);
+        return -1;
+    }
+
+    uint64_t start_ns = (uint64_t)(start_s * 1e9);
+    uint64_t end_ns = (end_s < 0) ? UINT64_MAX : (uint64_t)(end_s * 1e9);
+    char *buf = malloc(OUT_BUF_SIZE);
+    size_t used = 0;
+    if (buf == NULL) {
+        fprintf(stderr, "Failed to allocate the output buffer\n");
+        if (out != stdout) fclose(out);
+        munmap((void *)map, st.st_size);
+        return -1;
+    }
+    static const char header[] = "Channel,Timestamp,Value,Command\n";
+    fwrite(header, 1, sizeof(header) - 1, out);
+
+    for (size_t b = find_block(blocks, num_blocks, hdr->block_size, start_ns); b < num_blocks; b++) {
+        const struct ldc_binlog_block *blk = (const struct ldc_binlog_block *)(blocks + b * hdr->block_size);
+        const struct ldc_binlog_rec *recs = (const struct ldc_binlog_rec *)(blk + 1);
+        if (blk->t0_ns > end_ns) break;
+
+        for (uint32_t i = 0; i < blk->count && i < hdr->block_records; i++) {
+            uint64_t t_ns = blk->t0_ns + recs[i].dt_ns;
+            if (t_ns < start_ns) continue;
+            if (t_ns > end_ns) break;
+
+            char *p = buf + used;
+            int n = ldc_fmt_u64(p, recs[i].channel);
+            p[n++] = ',';
+            n += ldc_fmt_time(p + n, t_ns);
+            p[n++] = ',';
+            n += ldc_fmt_u64(p + n, recs[i].data & 0x0FFFFFFF);
+            p[n++] = ',';
+            n += ldc_fmt_i64(p + n, recs[i].cmd);
+            p[n++] = '\n';
+            used += n;
+            if (used > OUT_BUF_SIZE - 64) {
+                fwrite(buf, 1, used, out);
+                used = 0;
+            }
+        }
+    }
+    fwrite(buf, 1, used, out);
+    free(buf);
+    if (out != stdout) fclose(out);
+    munmap((void *)map, st.st_size);
+    return 0;
+}
@@ -0,0 +1,101 @@
+// Source file for the acquisition timing metrics.
+#include "ldc_metrics.h"
+#include "ldc_time.h"
+#include <string.h>
+
+struct ldc_metrics ldc_metrics;
+
+static const char *hist_names[LDC_NUM_HISTS] = {
+    "wake_lateness", "bus_xfer", "sample_age", "request",
+};
+
+void ldc_metrics_init(void) {
+    memset(&ldc_metrics, 0, sizeof(ldc_metrics));
+    ldc_metrics.start_ns = ldc_now_ns();
+}
+
+// Bucket 0 holds 0, bucket b holds [2^(b-1), 2^b)
+static int bucket_of(uint64_t ns) {
+    int b = (ns == 0) ? 0 : 64 - __builtin_clzll(ns);
+    return (b < LDC_HIST_BUCKETS) ? b : LDC_HIST_BUCKETS - 1;
+}
+
+void ldc_metrics_record(int id, uint64_t ns) {
+    struct ldc_histogram *h = &ldc_metrics.hist[id];
+    atomic_fetch_add_explicit(&h->buckets[bucket_of(ns)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->sum_ns, ns, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->count, 1, memory_order_relaxed);
+
+    uint64_t max = atomic_load_explicit(&h->max_ns, memory_order_relaxed);
+    while (ns > max &&
+           !atomic_compare_exchange_weak_explicit(&h->max_ns, &max, ns, memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+void ldc_metrics_snapshot(int id, struct ldc_hist *out) {
+    struct ldc_histogram *h = &ldc_metrics.hist[id];
+    memset(out, 0, sizeof(*out));
+    out->id = id;
+    out->sum_ns = atomic_load_explicit(&h->sum_ns, memory_order_relaxed);
+    out->max_ns = atomic_load_explicit(&h->max_ns, memory_order_relaxed);
+    // Count the buckets rather than reading count, so percentiles add up within the snapshot
+    for (int b = 0; b < LDC_HIST_BUCKETS; b++) {
+        out->buckets[b] = atomic_load_explicit(&h->buckets[b], memory_order_relaxed);
+        out->count += out->buckets[b];
+    }
+}
+
+void ldc_hist_add(struct ldc_hist *h, uint64_t ns) {
+    h->buckets[bucket_of(ns)]++;
+    h->sum_ns += ns;
+    h->count++;
+    if (ns > h->max_ns) h->max_ns = ns;
+}
+
+uint64_t ldc_hist_percentile(const struct ldc_hist *h, double p) {
+    if (h->count == 0) return 0;
+    uint64_t rank = (uint64_t)(p * (h->count - 1)) + 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < LDC_HIST_BUCKETS - 1; b++) {
+        seen += h->buckets[b];
+        if (seen >= rank) {
+            uint64_t upper = (b == 0) ? 0 : (1ULL << b) - 1;
+            return (upper < h->max_ns) ? upper : h->max_ns;
+        }
+    }
+    return h->max_ns;
+}
+
+const char *ldc_hist_name(int id) {
+    return (id >= 0 && id < LDC_NUM_HISTS) ? hist_names[id] : "unknown";
+}
+
+void ldc_hist_print(const struct ldc_hist *h, const char *label, FILE *f) {
+    // Percentiles are bucket upper edges, so they overstate by up to 2x
+    fprintf(f, "%s n=%llu mean=%.1fus p50<=%.1fus p99<=%.1fus p99.9<=%.1fus max=%.1fus\n",
+            label, (unsigned long long)h->count, h->count ? h->sum_ns / 1e3 / h->count : 0.0,
+            ldc_hist_percentile(h, 0.50) / 1e3, ldc_hist_percentile(h, 0.99) / 1e3,
+            ldc_hist_percentile(h, 0.999) / 1e3, h->max_ns / 1e3);
+}
+
+void ldc_metrics_dump(FILE *f) {
+    struct ldc_hist h;
+
+    fprintf(f, "Metrics after %.1f s: %llu wakeups, %llu missed, %llu bus errors, %llu timeouts, %llu stale reads, "
+            "%llu failed profile switches\n",
+            (ldc_now_ns() - ldc_metrics.start_ns) / 1e9,
+            (unsigned long long)atomic_load(&ldc_metrics.wakeups),
+            (unsigned long long)atomic_load(&ldc_metrics.missed),
+            (unsigned long long)atomic_load(&ldc_metrics.bus_errors),
+            (unsigned long long)atomic_load(&ldc_metrics.timeouts),
+            (unsigned long long)atomic_load(&ldc_metrics.stale_reads),
+            (unsigned long long)atomic_load(&ldc_metrics.profile_failures));
+    for (int id = 0; id < LDC_NUM_HISTS; id++) {
+        ldc_metrics_snapshot(id, &h);
+        char label[32];
+        snprintf(label, sizeof(label), "  %-14s", ldc_hist_name(id));
+        ldc_hist_print(&h, label, f);
+    }
+    ldc_errors_dump(&ldc_metrics.errors, f);
+    fflush(f);
+}
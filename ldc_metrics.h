@@ -0,0 +1,93 @@
+/*
+ * ldc_metrics.h
+ *
+ * Always-on timing instrumentation of the acquisition path.
+ *
+ * Three log2 histograms separate the sources of jitter in the data: how
+ * late the polling thread woke after data was ready (kernel scheduling),
+ * how long each burst read took (the bus) and how old a sample was when it
+ * was served (everything up to the client). Recording is a handful of
+ * relaxed atomic adds, so any thread may record without locks and readers
+ * see counts that are at most a few samples apart.
+ */
+
+#ifndef INC_LDC_METRICS_H_
+#define INC_LDC_METRICS_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "ldc_proto.h"
+#include "ldc_errors.h"
+
+struct ldc_histogram {
+    _Atomic uint64_t count;
+    _Atomic uint64_t sum_ns;
+    _Atomic uint64_t max_ns;
+    _Atomic uint64_t buckets[LDC_HIST_BUCKETS];
+};
+
+struct ldc_metrics {
+    uint64_t start_ns;
+    struct ldc_histogram hist[LDC_NUM_HISTS];  // indexed by LDC_HIST_*
+    _Atomic uint64_t wakeups;
+    _Atomic uint64_t missed;
+    _Atomic uint64_t bus_errors;
+    _Atomic uint64_t timeouts;
+    _Atomic uint64_t stale_reads;
+    _Atomic uint64_t profile_failures;        // profile switches rolled back to the previous profile
+    struct ldc_error_counts errors;            // conversion error bits of the published samples
+};
+
+// Service-wide metrics, written by the polling and serving threads
+extern struct ldc_metrics ldc_metrics;
+
+// Zero every counter and start the uptime clock
+void ldc_metrics_init(void);
+
+/**
+ * @brief Add one duration to a histogram.
+ * @param id LDC_HIST_*
+ * @param ns duration in nanoseconds
+ */
+void ldc_metrics_record(int id, uint64_t ns);
+
+// Age of a sample as it is served; samples stamped ahead of now (the simulator's virtual clock) count as 0
+static inline void ldc_metrics_record_age(uint64_t now, uint64_t t_ns) {
+    ldc_metrics_record(LDC_HIST_SAMPLE_AGE, (now > t_ns) ? now - t_ns : 0);
+}
+
+static inline void ldc_metrics_count(_Atomic uint64_t *counter, uint64_t n) {
+    atomic_fetch_add_explicit(counter, n, memory_order_relaxed);
+}
+
+/**
+ * @brief Copy a histogram into its wire layout (host byte order).
+ * @param id LDC_HIST_*
+ */
+void ldc_metrics_snapshot(int id, struct ldc_hist *out);
+
+/**
+ * @brief Estimate a percentile from a histogram snapshot.
+ * @param p percentile as a fraction, e.g. 0.99
+ * @return upper edge of the bucket holding the percentile (the maximum for the last bucket), 0 if empty
+ */
+uint64_t ldc_hist_percentile(const struct ldc_hist *h, double p);
+
+/**
+ * @brief Add one duration to a histogram in its snapshot layout, for timing kept by a single
+ * thread (e.g. the ldc_test loops) without the shared atomics.
+ * @param ns duration in nanoseconds
+ */
+void ldc_hist_add(struct ldc_hist *h, uint64_t ns);
+
+// Print count, mean, bucketed p50/p99/p99.9 and max of h on one line after label
+void ldc_hist_print(const struct ldc_hist *h, const char *label, FILE *f);
+
+// Name of histogram id, e.g. "wake_lateness"
+const char *ldc_hist_name(int id);
+
+// Print the counters, a percentile summary of each histogram and the conversion error totals
+void ldc_metrics_dump(FILE *f);
+
+#endif /* INC_LDC_METRICS_H_ */
@@ -0,0 +1,149 @@
+// Source file for the sensor profiles.
+#include "ldc_profile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+// Reference-clock counts per conversion at 40 MHz: 26.2 ms, 3.3 ms, 410 us and 103 us
+static const struct {
+    const char *name;
+    uint16_t rcount;
+} builtin[] = {
+    { "high_res", 0xFFFF },
+    { "balanced", 0x2000 },
+    { "fast",     0x0400 },
+    { "max_rate", 0x0100 },
+};
+
+static void profile_defaults(struct ldc_profile *p, const char *name) {
+    memset(p, 0, sizeof(*p));
+    strncpy(p->name, name, sizeof(p->name) - 1);
+    for (int ch = 0; ch < LDC1614_NUM_CHANNELS; ch++) {
+        p->channels[ch] = (struct ldc1614_channel_config){
+            LDC1614_DEFAULT_RCOUNT, LDC1614_DEFAULT_SETTLECOUNT,
+            LDC1614_DEFAULT_CLOCK_DIVIDERS, LDC1614_DEFAULT_DRIVE_CURRENT,
+        };
+    }
+}
+
+void ldc_profile_builtin(struct ldc_profile_set *set) {
+    struct ldc_profile p;
+    set->count = 0;
+    for (size_t i = 0; i < sizeof(builtin) / sizeof(builtin[0]); i++) {
+        profile_defaults(&p, builtin[i].name);
+        for (int ch = 0; ch < LDC1614_NUM_CHANNELS; ch++) {
+            p.channels[ch].rcount = builtin[i].rcount;
+        }
+        ldc_profile_add(set, &p);
+    }
+}
+
+const struct ldc_profile *ldc_profile_find(const struct ldc_profile_set *set, const char *name) {
+    for (int i = 0; i < set->count; i++) {
+        if (strncmp(set->profiles[i].name, name, LDC_PROFILE_NAME_LEN) == 0) return &set->profiles[i];
+    }
+    return NULL;
+}
+
+struct ldc_profile *ldc_profile_add(struct ldc_profile_set *set, const struct ldc_profile *profile) {
+    struct ldc_profile *slot = (struct ldc_profile *)ldc_profile_find(set, profile->name);
+    if (slot == NULL) {
+        if (set->count == LDC_MAX_PROFILES) return NULL;
+        slot = &set->profiles[set->count++];
+    }
+    *slot = *profile;
+    return slot;
+}
+
+int ldc_profile_prepare(struct ldc_profile_set *set, uint32_t fclk_hz, const double *tank_f) {
+    int ret = 0;
+    for (int i = 0; i < set->count; i++) {
+        if (ldc_convert_init(&set->profiles[i].convert, set->profiles[i].channels, fclk_hz, tank_f) != 0) {
+            fprintf(stderr, "Profile %s has a reserved clock divider, its frequencies are NaN\n",
+                    set->profiles[i].name);
+            ret = -1;
+        }
+    }
+    return ret;
+}
+
+static char *trim(char *s) {
+    while (isspace((unsigned char)*s)) s++;
+    char *end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1])) end--;
+    *end = '\0';
+    return s;
+}
+
+// Apply "key[.ch] = value" to p, returns -1 on an unknown key or bad value
+static int set_key(struct ldc_profile *p, char *key, const char *value) {
+    int first = 0, last = LDC1614_NUM_CHANNELS - 1;
+    char *end = NULL;
+    char *dot = strchr(key, '.');
+
+    if (dot != NULL) {
+        *dot = '\0';
+        long ch = strtol(dot + 1, &end, 10);
+        if (end == dot + 1 || *end != '\0' || ch < 0 || ch >= LDC1614_NUM_CHANNELS) return -1;
+        first = last = ch;
+    }
+    long v = strtol(value, &end, 0);
+    if (end == value || *end != '\0' || v < 0 || v > 0xFFFF) return -1;
+
+    for (int ch = first; ch <= last; ch++) {
+        struct ldc1614_channel_config *c = &p->channels[ch];
+        if (strcmp(key, "rcount") == 0) c->rcount = v;
+        else if (strcmp(key, "settlecount") == 0) c->settlecount = v;
+        else if (strcmp(key, "clock_dividers") == 0) c->clock_dividers = v;
+        else if (strcmp(key, "drive_current") == 0) c->drive_current = v;
+        else return -1;
+    }
+    return 0;
+}
+
+int ldc_profile_load(struct ldc_profile_set *set, const char *path) {
+    char line[256];
+    int lineno = 0, ret = 0;
+    struct ldc_profile p;
+    int in_section = 0;
+
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        perror("Failed to open profile file");
+        return -1;
+    }
+    while (ret == 0 && fgets(line, sizeof(line), f) != NULL) {
+        lineno++;
+        char *comment = strpbrk(line, "#;");
+        if (comment != NULL) *comment = '\0';
+        char *s = trim(line);
+        if (*s == '\0') continue;
+
+        if (*s == '[') {
+            char *close = strchr(s, ']');
+            if (close == NULL || close == s + 1 || close[1] != '\0' || close - s - 1 >= LDC_PROFILE_NAME_LEN) {
+                ret = -1;
+                break;
+            }
+            *close = '\0';
+            if (in_section && ldc_profile_add(set, &p) == NULL) ret = -1;
+            profile_defaults(&p, trim(s + 1));
+            in_section = 1;
+            continue;
+        }
+        char *eq = strchr(s, '=');
+        if (!in_section || eq == NULL) {
+            ret = -1;
+            break;
+        }
+        *eq = '\0';
+        ret = set_key(&p, trim(s), trim(eq + 1));
+    }
+    if (ret == 0 && in_section && ldc_profile_add(set, &p) == NULL) ret = -1;
+    if (ret != 0) {
+        fprintf(stderr, "%s:%d: invalid profile line (or more than %d profiles)\n", path, lineno, LDC_MAX_PROFILES);
+    }
+    fclose(f);
+    return ret;
+}
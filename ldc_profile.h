@@ -0,0 +1,69 @@
+/*
+ * ldc_profile.h
+ *
+ * Named sensor profiles: per-channel conversion settings trading resolution
+ * for sample rate, selectable at startup and switchable while running.
+ *
+ * Built-in profiles cover the range from high resolution to maximum rate;
+ * more can be loaded from an INI-style file:
+ *
+ *     # comment
+ *     [fast]
+ *     rcount = 0x0400          ; every channel
+ *     settlecount = 0x000A
+ *     clock_dividers = 0x1001
+ *     drive_current = 0xB000
+ *     rcount.2 = 0x0800        ; channel 2 only
+ *
+ * A section starts from the LDC1614_DEFAULT_* values and replaces any
+ * profile of the same name.
+ */
+
+#ifndef INC_LDC_PROFILE_H_
+#define INC_LDC_PROFILE_H_
+
+#include <stdint.h>
+#include "ldc1614.h"
+#include "ldc_convert.h"
+
+#define LDC_PROFILE_NAME_LEN 32
+#define LDC_MAX_PROFILES     16
+
+struct ldc_profile {
+    char name[LDC_PROFILE_NAME_LEN];
+    struct ldc1614_channel_config channels[LDC1614_NUM_CHANNELS];
+    struct ldc_convert convert; // engineering units for these settings, see ldc_profile_prepare()
+};
+
+struct ldc_profile_set {
+    int count;
+    struct ldc_profile profiles[LDC_MAX_PROFILES];
+};
+
+// Fill set with the built-in profiles: high_res, balanced, fast and max_rate
+void ldc_profile_builtin(struct ldc_profile_set *set);
+
+/**
+ * @brief Add a profile, replacing one of the same name.
+ * @return the stored profile, NULL if the set is full
+ */
+struct ldc_profile *ldc_profile_add(struct ldc_profile_set *set, const struct ldc_profile *profile);
+
+/**
+ * @brief Load the profiles of an INI-style file into set.
+ * @return 0 on success, -1 if the file cannot be read or has an invalid line
+ */
+int ldc_profile_load(struct ldc_profile_set *set, const char *path);
+
+/**
+ * @brief Precompute the unit conversion of every profile in set.
+ * @param fclk_hz reference clock on CLKIN
+ * @param tank_f per-channel tank capacitance in farads, 0 if unknown
+ * @return 0 on success, -1 if a profile has a reserved (0) clock divider
+ */
+int ldc_profile_prepare(struct ldc_profile_set *set, uint32_t fclk_hz, const double *tank_f);
+
+// Profile called name, NULL if there is none
+const struct ldc_profile *ldc_profile_find(const struct ldc_profile_set *set, const char *name);
+
+#endif /* INC_LDC_PROFILE_H_ */
@@ -0,0 +1,256 @@
+/*
+ * ldc_proto.h
+ *
+ * Binary UDP protocol spoken by ldc_service.
+ *
+ * Requests whose first byte is LDC_PROTO_MAGIC carry an ldc_msg_hdr; any
+ * other first byte is a legacy single-byte request (see README). All
+ * multi-byte fields are big-endian on the wire.
+ */
+
+#ifndef INC_LDC_PROTO_H_
+#define INC_LDC_PROTO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define LDC_PROTO_MAGIC     0x4C  // 'L'
+#define LDC_PROTO_VERSION   1
+#define LDC_MAX_DATAGRAM    1472  // largest UDP payload that fits a 1500 byte Ethernet MTU
+
+// --- Opcodes ---
+#define LDC_OP_LATEST       0x01  // newest sample of each channel in the mask
+#define LDC_OP_LAST_N       0x02  // last count samples of each channel
+#define LDC_OP_RANGE_SEQ    0x03  // samples with start <= seq <= end
+#define LDC_OP_RANGE_TIME   0x04  // samples with start <= t_ns <= end
+#define LDC_OP_STATS        0x05  // service statistics
+#define LDC_OP_METRICS      0x06  // acquisition timing histograms and counters
+#define LDC_OP_PROFILE      0x07  // switch the sensor profile, or report the active one
+#define LDC_OP_TIME         0x08  // clock offset exchange: when the service received and answered the request
+#define LDC_OP_SUBSCRIBE    0x10  // client -> service: start or renew a stream, answered with the granted parameters
+#define LDC_OP_HEARTBEAT    0x11  // client -> service: renew the lease and acknowledge batches
+#define LDC_OP_UNSUBSCRIBE  0x12  // client -> service: stop the stream
+#define LDC_OP_BATCH        0x13  // service -> client: batch of streamed samples
+
+// --- Status codes (replies) ---
+#define LDC_STATUS_OK       0
+#define LDC_STATUS_BAD_REQ  1     // malformed request or unknown opcode
+#define LDC_STATUS_BUSY     2     // no free subscriber slot
+#define LDC_STATUS_BAD_VER  3     // unsupported protocol version
+
+// --- Reply flags ---
+#define LDC_REPLY_MORE      0x01  // further fragments of this reply follow
+#define LDC_REPLY_TRUNCATED 0x02  // reply hit LDC_MAX_FRAGMENTS, ask again from the last seq + 1
+#define LDC_REPLY_UNITS     0x04  // records are struct ldc_unit_record
+#define LDC_MAX_FRAGMENTS   32    // datagrams sent for one query at most
+
+struct ldc_msg_hdr {
+    uint8_t magic;    // LDC_PROTO_MAGIC
+    uint8_t version;  // LDC_PROTO_VERSION
+    uint8_t opcode;
+    uint8_t status;   // 0 in requests, LDC_STATUS_* in replies
+    uint32_t req_id;  // chosen by the client, echoed in the reply
+} __attribute__((packed));
+
+#define LDC_FLAG_ERR_AE         0x01  // sensor amplitude out of range
+#define LDC_FLAG_ERR_WD         0x02  // watchdog: sensor not oscillating, value is meaningless
+#define LDC_FLAG_ERR_OR         0x04  // over-range
+#define LDC_FLAG_ERR_UR         0x08  // under-range
+#define LDC_FLAG_ERRORS         0x0F  // any conversion error, a client can drop such samples
+#define LDC_FLAG_NEW_CONVERSION 0x10  // read while the device flagged it unread: a conversion, not a repeat
+#define LDC_FLAG_PROFILE_START  0x20  // first sample of this channel after a profile switch
+
+// One sample on the wire
+struct ldc_record {
+    uint8_t channel;
+    uint8_t flags;    // LDC1614 error bits (UR/OR/WD/AE) in bits 3:0, LDC_FLAG_* above
+    uint16_t reserved;
+    uint32_t value;   // 28-bit raw conversion result
+    uint64_t seq;     // per-channel sequence number, gaps mean lost samples
+    uint64_t t_ns;    // service CLOCK_MONOTONIC acquisition time
+} __attribute__((packed));
+
+// LDC_OP_SUBSCRIBE and query units: records as acquired, or with engineering units appended
+#define LDC_UNITS_RAW 0  // struct ldc_record
+#define LDC_UNITS_SI  1  // struct ldc_unit_record
+
+// struct ldc_record followed by the sensor frequency and inductance the service computed from value.
+// Both are IEEE-754 doubles sent as big-endian 64-bit words; inductance is NaN when the service
+// was not given the channel's tank capacitance.
+struct ldc_unit_record {
+    uint8_t channel;
+    uint8_t flags;
+    uint16_t reserved;
+    uint32_t value;
+    uint64_t seq;
+    uint64_t t_ns;
+    uint64_t frequency_hz;
+    uint64_t inductance_h;
+} __attribute__((packed));
+
+#define LDC_FILTERED_OFFSET 4 // with a filter pipeline, channel n + 4 carries the filtered samples of channel n
+
+// A service acquiring several LDC1614s serves device d's channel n as d * LDC_DEVICE_CHANNELS + n
+// (filtered: + LDC_FILTERED_OFFSET), so device 0 keeps channels 0-7 and a 32-bit mask covers 4 devices
+#define LDC_DEVICE_CHANNELS 8
+#define LDC_MAX_DEVICES     4
+
+// Decimation of a subscription
+#define LDC_DECIMATE_PICK     0  // every Nth sample as acquired
+#define LDC_DECIMATE_AVERAGE  1  // triangular average of the 2N-1 samples ending at every Nth, stamped at
+                                 // the window centre: zeros at every frequency that would alias onto DC.
+                                 // Points whose window is not all in the ring are skipped
+
+// LDC_OP_SUBSCRIBE request body, also returned with the granted values
+struct ldc_subscribe {
+    struct ldc_msg_hdr hdr;
+    uint32_t channel_mask;   // bit n streams channel n
+    uint16_t batch_size;     // records per batch, clamped to what fits a datagram
+    uint16_t decimation;     // stream every Nth sample of each channel (1 = full rate)
+    uint16_t max_latency_ms; // flush a partial batch after this long
+    uint16_t window;         // max unacknowledged batches in flight, 0 = no acknowledgements needed
+    uint32_t lease_ms;       // subscription expires unless renewed within this time
+    uint8_t decimate_mode;   // LDC_DECIMATE_*, may be left out: shorter requests pick
+    uint8_t units;           // LDC_UNITS_*, record type of the batches
+    uint8_t reserved[2];
+} __attribute__((packed));
+
+#define LDC_SUBSCRIBE_MIN_LEN offsetof(struct ldc_subscribe, decimate_mode)
+
+// LDC_OP_HEARTBEAT request body
+struct ldc_heartbeat {
+    struct ldc_msg_hdr hdr;
+    uint32_t acked_batch;    // highest batch_seq received
+} __attribute__((packed));
+
+// LDC_OP_BATCH header, followed by count ldc_record entries
+struct ldc_batch {
+    struct ldc_msg_hdr hdr;
+    uint32_t batch_seq;      // increments by one per batch sent to this subscriber
+    uint32_t dropped;        // samples this subscriber lost to ring overrun so far
+    uint16_t count;
+    uint8_t units;           // LDC_UNITS_* of the records that follow
+    uint8_t reserved;
+} __attribute__((packed));
+
+#define LDC_MAX_RECORDS ((LDC_MAX_DATAGRAM - sizeof(struct ldc_batch)) / sizeof(struct ldc_record))
+#define LDC_MAX_UNIT_RECORDS ((LDC_MAX_DATAGRAM - sizeof(struct ldc_batch)) / sizeof(struct ldc_unit_record))
+
+// Body of the sample queries (LATEST, LAST_N, RANGE_SEQ, RANGE_TIME), unused fields are ignored
+struct ldc_query {
+    struct ldc_msg_hdr hdr;
+    uint32_t channel_mask;   // bit n selects channel n
+    uint32_t count;          // LAST_N: samples per channel
+    uint64_t start;          // RANGE_SEQ: first seq, RANGE_TIME: first t_ns
+    uint64_t end;            // RANGE_SEQ: last seq, RANGE_TIME: last t_ns
+    uint8_t units;           // LDC_UNITS_*, may be left out for raw records
+    uint8_t reserved[3];
+} __attribute__((packed));
+
+#define LDC_QUERY_MIN_LEN offsetof(struct ldc_query, units)
+
+// Header of every query reply datagram, followed by count ldc_record entries
+struct ldc_reply {
+    struct ldc_msg_hdr hdr;
+    uint16_t count;
+    uint8_t fragment;        // 0-based index of this datagram within the reply
+    uint8_t flags;           // LDC_REPLY_*
+    uint32_t reserved;
+} __attribute__((packed));
+
+#define LDC_REPLY_RECORDS ((LDC_MAX_DATAGRAM - sizeof(struct ldc_reply)) / sizeof(struct ldc_record))
+#define LDC_REPLY_UNIT_RECORDS ((LDC_MAX_DATAGRAM - sizeof(struct ldc_reply)) / sizeof(struct ldc_unit_record))
+
+// LDC_OP_STATS reply, followed by num_channels ldc_channel_stats entries
+struct ldc_stats {
+    struct ldc_msg_hdr hdr;
+    uint64_t uptime_ns;
+    uint64_t now_ns;         // service CLOCK_MONOTONIC when the reply was built
+    uint32_t queries;        // binary protocol requests handled
+    uint32_t legacy_requests;
+    uint16_t subscribers;
+    uint16_t num_channels;
+    uint32_t channel_mask;   // channels being acquired
+} __attribute__((packed));
+
+struct ldc_channel_stats {
+    uint8_t channel;
+    uint8_t flags;           // error bits of the newest sample
+    uint16_t reserved;
+    uint32_t value;          // newest sample
+    uint64_t head_seq;       // samples acquired so far
+    uint64_t tail_seq;       // oldest sample still held
+    uint64_t last_t_ns;      // acquisition time of the newest sample
+} __attribute__((packed));
+
+// LDC_OP_PROFILE request and reply. The request names the profile to switch to (an empty
+// name only reports); the reply carries the profile in effect once the switch is applied. A switch
+// that fails is rolled back: a later report still names the previous profile.
+struct ldc_profile_msg {
+    struct ldc_msg_hdr hdr;
+    char name[32];           // NUL padded
+    uint32_t generation;     // reply: profile switches so far, including this one
+    uint32_t reserved;
+    uint64_t period_ns;      // reply: time between two samples of each channel, of the slowest device
+    uint16_t rcount[4];      // reply: per-channel RCOUNT
+} __attribute__((packed));
+
+// LDC_OP_TIME request and reply. The client puts its own clock reading in client_tx_ns, which
+// comes back unchanged next to the service times. With t4 the client's clock when the reply
+// arrived, the service clock is ahead of the client's by
+//   offset = ((service_rx_ns - client_tx_ns) + (service_tx_ns - t4)) / 2
+// within half of the network delay (t4 - client_tx_ns) - (service_tx_ns - service_rx_ns).
+// The exchange with the smallest delay gives the tightest offset.
+struct ldc_time_msg {
+    struct ldc_msg_hdr hdr;
+    uint64_t client_tx_ns;   // client clock when sent, echoed
+    uint64_t service_rx_ns;  // reply: service CLOCK_MONOTONIC kernel receive time of the request
+    uint64_t service_tx_ns;  // reply: service CLOCK_MONOTONIC when the reply was built
+    uint64_t realtime_ns;    // reply: service CLOCK_REALTIME at service_tx_ns, to line up several hosts
+} __attribute__((packed));
+
+// Timing histograms of LDC_OP_METRICS, see ldc_metrics.h
+#define LDC_HIST_WAKE_LATENESS  0  // data-ready event (or timer deadline) to the polling thread running
+#define LDC_HIST_BUS_XFER       1  // one STATUS + DATA burst read
+#define LDC_HIST_SAMPLE_AGE     2  // acquisition time to the sample leaving in a reply or batch
+#define LDC_HIST_REQUEST        3  // kernel receive time of a request to its reply being sent
+#define LDC_NUM_HISTS           4
+#define LDC_HIST_BUCKETS        32 // bucket 0 holds 0 ns, bucket b holds [2^(b-1), 2^b) ns, the last is open ended
+
+// LDC_OP_METRICS reply, followed by num_hists ldc_hist entries and num_channels ldc_channel_errors entries.
+// Error entries that do not fit go in further datagrams with the same counters and no histograms.
+struct ldc_metrics_reply {
+    struct ldc_msg_hdr hdr;
+    uint64_t uptime_ns;      // since the counters were reset at startup
+    uint64_t wakeups;        // data-ready events handled by the polling thread
+    uint64_t missed;         // conversions or timer periods that passed without a read
+    uint64_t bus_errors;     // failed burst reads
+    uint64_t timeouts;       // waits that ended without a data-ready event
+    uint64_t stale_reads;    // burst reads that found no new conversion on some channel
+    uint16_t num_hists;
+    uint16_t num_buckets;    // LDC_HIST_BUCKETS
+    uint16_t num_channels;   // ldc_channel_errors entries after the histograms
+    uint16_t profile_failures; // profile switches rolled back, saturating at 65535
+    uint8_t fragment;        // 0-based index of this datagram within the reply
+    uint8_t flags;           // LDC_REPLY_MORE while further datagrams follow
+} __attribute__((packed));
+
+struct ldc_hist {
+    uint8_t id;              // LDC_HIST_*
+    uint8_t reserved[7];
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t max_ns;
+    uint64_t buckets[LDC_HIST_BUCKETS];
+} __attribute__((packed));
+
+// Conversion error counts of one channel, following the histograms of a metrics reply: CH0-3 of
+// device 0, then the acquired channels of the other devices
+struct ldc_channel_errors {
+    uint8_t channel;
+    uint8_t reserved[7];
+    uint64_t samples;        // samples with any error bit
+    uint64_t bits[4];        // samples with each error bit, indexed by bit number (AE, WD, OR, UR)
+} __attribute__((packed));
+
+#endif /* INC_LDC_PROTO_H_ */
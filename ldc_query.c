@@ -0,0 +1,316 @@
+// Source file for the binary query protocol.
+#include "ldc_query.h"
+#include "ldc_stream.h"
+#include "ldc_time.h"
+#include "ldc_metrics.h"
+#include "ldc_server.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <endian.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#define MAX_QUERY_CHANNELS 32 // width of the channel mask
+
+// Reply being assembled; full datagrams are sent as soon as another record needs the room
+struct reply_ctx {
+    uint8_t buf[LDC_MAX_DATAGRAM];
+    struct ldc_msg_hdr req_hdr;
+    const struct sockaddr_in *to;
+    uint64_t now;            // when the request arrived, for the sample age metric
+    uint8_t units;           // LDC_UNITS_* of the records
+    uint16_t count;
+    uint8_t fragment;
+    int truncated;
+};
+
+static int query_sock = -1;
+static struct ldc_ring *query_rings = NULL;
+static int query_num_rings = 0;
+static uint32_t query_channel_mask = 0;
+static uint64_t start_ns = 0;
+static _Atomic uint32_t queries = 0; // counted by every server thread
+static _Atomic uint32_t legacy_requests = 0;
+
+void ldc_query_init(int sock, struct ldc_ring *rings, int num_rings, uint32_t channel_mask) {
+    query_sock = sock;
+    query_rings = rings;
+    query_num_rings = (num_rings > MAX_QUERY_CHANNELS) ? MAX_QUERY_CHANNELS : num_rings;
+    query_channel_mask = channel_mask;
+    start_ns = ldc_now_ns();
+}
+
+void ldc_query_reply_status(const struct ldc_msg_hdr *req, uint8_t status, const struct sockaddr_in *to) {
+    struct ldc_msg_hdr hdr = *req;
+    hdr.version = LDC_PROTO_VERSION;
+    hdr.status = status;
+    ldc_server_send(query_sock, &hdr, sizeof(hdr), to);
+}
+
+void ldc_query_count_legacy(void) {
+    legacy_requests++;
+}
+
+static void send_fragment(struct reply_ctx *ctx, uint8_t flags) {
+    struct ldc_reply *reply = (struct ldc_reply *)ctx->buf;
+    reply->hdr = ctx->req_hdr;
+    reply->hdr.version = LDC_PROTO_VERSION;
+    reply->hdr.status = LDC_STATUS_OK;
+    reply->count = htons(ctx->count);
+    reply->fragment = ctx->fragment;
+    reply->flags = flags;
+    reply->reserved = 0;
+    size_t rec_size = sizeof(struct ldc_record);
+    if (ctx->units == LDC_UNITS_SI) {
+        reply->flags |= LDC_REPLY_UNITS;
+        ldc_stream_fill_units(ctx->buf + sizeof(*reply), ctx->count);
+        rec_size = sizeof(struct ldc_unit_record);
+    }
+    ldc_server_send(query_sock, ctx->buf, sizeof(*reply) + ctx->count * rec_size, ctx->to);
+    ctx->count = 0;
+    ctx->fragment++;
+}
+
+// Append one record, returns -1 once the reply is out of fragments
+static int emit(struct reply_ctx *ctx, int ch, const struct ldc_sample *s) {
+    int unit_records = (ctx->units == LDC_UNITS_SI);
+    if (ctx->count == (unit_records ? LDC_REPLY_UNIT_RECORDS : LDC_REPLY_RECORDS)) {
+        if (ctx->fragment + 1 >= LDC_MAX_FRAGMENTS) {
+            ctx->truncated = 1;
+            return -1;
+        }
+        send_fragment(ctx, LDC_REPLY_MORE);
+    }
+    // A unit record starts with the fields of the plain one, send_fragment() adds the units
+    size_t rec_size = unit_records ? sizeof(struct ldc_unit_record) : sizeof(struct ldc_record);
+    struct ldc_record *rec = (struct ldc_record *)(ctx->buf + sizeof(struct ldc_reply) + ctx->count * rec_size);
+    rec->channel = ch;
+    rec->flags = s->flags;
+    rec->reserved = 0;
+    rec->value = htonl(s->value);
+    rec->seq = htobe64(s->seq);
+    rec->t_ns = htobe64(s->t_ns);
+    ldc_metrics_record_age(ctx->now, s->t_ns);
+    ctx->count++;
+    return 0;
+}
+
+// Emit samples first..last of one channel, returns -1 once the reply is full
+static int emit_range(struct reply_ctx *ctx, int ch, uint64_t first, uint64_t last) {
+    struct ldc_ring *ring = &query_rings[ch];
+    struct ldc_sample sample;
+    uint64_t head = ldc_ring_head(ring);
+
+    if (last > head) last = head;
+    for (uint64_t seq = first; seq <= last; seq++) {
+        uint64_t tail = ldc_ring_tail(ring);
+        if (seq < tail) seq = tail; // overwritten since the query started
+        if (seq > last) break;
+        if (ldc_ring_get(ring, seq, &sample) != 0) continue;
+        if (emit(ctx, ch, &sample) != 0) return -1;
+    }
+    return 0;
+}
+
+// First sequence number whose timestamp is >= t_ns (head + 1 if none)
+static uint64_t seq_at_time(struct ldc_ring *ring, uint64_t t_ns) {
+    uint64_t lo = ldc_ring_tail(ring);
+    uint64_t hi = ldc_ring_head(ring) + 1;
+    struct ldc_sample sample;
+
+    // Timestamps are monotonic in sequence order, so binary search the held window
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (ldc_ring_get(ring, mid, &sample) != 0 || sample.t_ns < t_ns) {
+            lo = mid + 1; // an overwritten slot is older than anything still held
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static void handle_samples(const struct ldc_query *q, const struct sockaddr_in *from) {
+    struct reply_ctx ctx;
+    uint32_t mask = ntohl(q->channel_mask);
+    uint32_t count = ntohl(q->count);
+    uint64_t start = be64toh(q->start);
+    uint64_t end = be64toh(q->end);
+    struct ldc_sample sample;
+
+    ctx.req_hdr = q->hdr;
+    ctx.to = from;
+    ctx.now = ldc_now_ns();
+    ctx.units = (q->units == LDC_UNITS_SI) ? LDC_UNITS_SI : LDC_UNITS_RAW;
+    ctx.count = 0;
+    ctx.fragment = 0;
+    ctx.truncated = 0;
+
+    for (int ch = 0; ch < query_num_rings; ch++) {
+        if (!(mask & (1u << ch))) continue;
+        struct ldc_ring *ring = &query_rings[ch];
+        uint64_t head = ldc_ring_head(ring);
+        int full = 0;
+
+        switch (q->hdr.opcode) {
+            case LDC_OP_LATEST:
+                if (ldc_ring_latest(ring, &sample) == 0) full = emit(&ctx, ch, &sample);
+                break;
+            case LDC_OP_LAST_N: {
+                uint64_t n = (count > head) ? head : count;
+                full = emit_range(&ctx, ch, head - n + 1, head);
+                break;
+            }
+            case LDC_OP_RANGE_SEQ:
+                full = emit_range(&ctx, ch, start ? start : 1, end);
+                break;
+            case LDC_OP_RANGE_TIME: {
+                uint64_t first = seq_at_time(ring, start);
+                uint64_t last = (end == UINT64_MAX) ? head : seq_at_time(ring, end + 1) - 1;
+                full = emit_range(&ctx, ch, first, last);
+                break;
+            }
+        }
+        if (full) break;
+    }
+    send_fragment(&ctx, ctx.truncated ? LDC_REPLY_TRUNCATED : 0);
+}
+
+static void handle_stats(const struct ldc_msg_hdr *req, const struct sockaddr_in *from) {
+    uint8_t buf[LDC_MAX_DATAGRAM];
+    struct ldc_stats *stats = (struct ldc_stats *)buf;
+    struct ldc_channel_stats *cs = (struct ldc_channel_stats *)(buf + sizeof(*stats));
+    uint64_t now = ldc_now_ns();
+    struct ldc_sample sample;
+    uint16_t n = 0;
+
+    for (int ch = 0; ch < query_num_rings; ch++) {
+        struct ldc_ring *ring = &query_rings[ch];
+        if (ldc_ring_latest(ring, &sample) != 0) {
+            memset(&sample, 0, sizeof(sample));
+        }
+        cs[n].channel = ch;
+        cs[n].flags = sample.flags;
+        cs[n].reserved = 0;
+        cs[n].value = htonl(sample.value);
+        cs[n].head_seq = htobe64(sample.seq);
+        cs[n].tail_seq = htobe64(sample.seq ? ldc_ring_tail(ring) : 0);
+        cs[n].last_t_ns = htobe64(sample.t_ns);
+        n++;
+    }
+
+    stats->hdr = *req;
+    stats->hdr.version = LDC_PROTO_VERSION;
+    stats->hdr.status = LDC_STATUS_OK;
+    stats->uptime_ns = htobe64(now - start_ns);
+    stats->now_ns = htobe64(now);
+    stats->queries = htonl(queries);
+    stats->legacy_requests = htonl(legacy_requests);
+    stats->subscribers = htons(ldc_stream_count());
+    stats->num_channels = htons(n);
+    stats->channel_mask = htonl(query_channel_mask);
+    ldc_server_send(query_sock, buf, sizeof(*stats) + n * sizeof(*cs), from);
+}
+
+// Whether a channel has error counts in a metrics reply: CH0-3, then the raw channels of further devices
+static int reports_errors(int ch) {
+    if (ch < LDC1614_NUM_CHANNELS) return 1;
+    return (ch % LDC_DEVICE_CHANNELS) < LDC_FILTERED_OFFSET && (query_channel_mask & (1u << ch));
+}
+
+static void handle_metrics(const struct ldc_msg_hdr *req, const struct sockaddr_in *from) {
+    uint8_t buf[LDC_MAX_DATAGRAM];
+    struct ldc_metrics_reply *reply = (struct ldc_metrics_reply *)buf;
+    struct ldc_hist *hist = (struct ldc_hist *)(buf + sizeof(*reply));
+    struct ldc_channel_errors *errs = (struct ldc_channel_errors *)(hist + LDC_NUM_HISTS);
+    int remaining = 0;
+
+    for (int ch = 0; ch < LDC_ERROR_CHANNELS; ch++) {
+        remaining += reports_errors(ch);
+    }
+
+    for (int id = 0; id < LDC_NUM_HISTS; id++) {
+        ldc_metrics_snapshot(id, &hist[id]);
+        hist[id].count = htobe64(hist[id].count);
+        hist[id].sum_ns = htobe64(hist[id].sum_ns);
+        hist[id].max_ns = htobe64(hist[id].max_ns);
+        for (int b = 0; b < LDC_HIST_BUCKETS; b++) {
+            hist[id].buckets[b] = htobe64(hist[id].buckets[b]);
+        }
+    }
+
+    reply->hdr = *req;
+    reply->hdr.version = LDC_PROTO_VERSION;
+    reply->hdr.status = LDC_STATUS_OK;
+    reply->uptime_ns = htobe64(ldc_now_ns() - ldc_metrics.start_ns);
+    reply->wakeups = htobe64(atomic_load(&ldc_metrics.wakeups));
+    reply->missed = htobe64(atomic_load(&ldc_metrics.missed));
+    reply->bus_errors = htobe64(atomic_load(&ldc_metrics.bus_errors));
+    reply->timeouts = htobe64(atomic_load(&ldc_metrics.timeouts));
+    reply->stale_reads = htobe64(atomic_load(&ldc_metrics.stale_reads));
+    reply->num_buckets = htons(LDC_HIST_BUCKETS);
+    uint64_t profile_failures = atomic_load(&ldc_metrics.profile_failures);
+    reply->profile_failures = htons(profile_failures > UINT16_MAX ? UINT16_MAX : profile_failures);
+    reply->fragment = 0;
+
+    // The first datagram carries the histograms, later ones only the error counts that did not fit
+    int hists = LDC_NUM_HISTS;
+    int ch = 0;
+    do {
+        int max_errs = (int)((sizeof(buf) - sizeof(*reply) - hists * sizeof(*hist)) / sizeof(*errs));
+        int n = 0;
+        for (; ch < LDC_ERROR_CHANNELS && n < max_errs; ch++) {
+            if (!reports_errors(ch)) continue;
+            memset(&errs[n], 0, sizeof(errs[n]));
+            errs[n].channel = ch;
+            errs[n].samples = htobe64(atomic_load(&ldc_metrics.errors.samples[ch]));
+            for (int b = 0; b < LDC_NUM_ERRORS; b++) {
+                errs[n].bits[b] = htobe64(atomic_load(&ldc_metrics.errors.bits[ch][b]));
+            }
+            n++;
+        }
+        remaining -= n;
+        reply->num_hists = htons(hists);
+        reply->num_channels = htons(n);
+        reply->flags = (remaining > 0) ? LDC_REPLY_MORE : 0;
+        ldc_server_send(query_sock, buf, sizeof(*reply) + hists * sizeof(*hist) + n * sizeof(*errs), from);
+        reply->fragment++;
+        hists = 0;
+        errs = (struct ldc_channel_errors *)hist;
+    } while (remaining > 0);
+}
+
+int ldc_query_handle(const uint8_t *req, int n, const struct sockaddr_in *from) {
+    const struct ldc_msg_hdr *hdr = (const struct ldc_msg_hdr *)req;
+    if (n < (int)sizeof(*hdr)) return -1;
+
+    switch (hdr->opcode) {
+        case LDC_OP_LATEST:
+        case LDC_OP_LAST_N:
+        case LDC_OP_RANGE_SEQ:
+        case LDC_OP_RANGE_TIME:
+            queries++;
+            if (n < (int)LDC_QUERY_MIN_LEN) {
+                ldc_query_reply_status(hdr, LDC_STATUS_BAD_REQ, from);
+            } else {
+                // Fields a shorter (older) request leaves out read as zero
+                struct ldc_query full;
+                memset(&full, 0, sizeof(full));
+                memcpy(&full, req, (n < (int)sizeof(full)) ? (size_t)n : sizeof(full));
+                handle_samples(&full, from);
+            }
+            return 0;
+        case LDC_OP_STATS:
+            queries++;
+            handle_stats(hdr, from);
+            return 0;
+        case LDC_OP_METRICS:
+            queries++;
+            handle_metrics(hdr, from);
+            return 0;
+        default:
+            return -1;
+    }
+}
@@ -0,0 +1,39 @@
+/*
+ * ldc_query.h
+ *
+ * Request/response queries of the binary protocol (latest sample, last N,
+ * sequence and time ranges, statistics, timing metrics). Replies are packed into
+ * MTU-sized datagrams; a reply that does not fit one datagram is split into
+ * numbered fragments.
+ */
+
+#ifndef INC_LDC_QUERY_H_
+#define INC_LDC_QUERY_H_
+
+#include <stdint.h>
+#include <netinet/in.h>
+#include "ldc_proto.h"
+#include "ldc_ring.h"
+
+/**
+ * @brief Set up the query handler.
+ * @param sock UDP socket replies are sent from outside the server threads
+ * @param rings per-channel sample rings, indexed by channel number
+ * @param num_rings number of rings
+ * @param channel_mask channels being acquired, reported by LDC_OP_STATS
+ */
+void ldc_query_init(int sock, struct ldc_ring *rings, int num_rings, uint32_t channel_mask);
+
+/**
+ * @brief Handle a query request.
+ * @return 0 if the request was a query, -1 if the opcode is not ours
+ */
+int ldc_query_handle(const uint8_t *req, int n, const struct sockaddr_in *from);
+
+// Reply with a bare header carrying status (LDC_STATUS_*)
+void ldc_query_reply_status(const struct ldc_msg_hdr *req, uint8_t status, const struct sockaddr_in *to);
+
+// Count a legacy single-byte request for LDC_OP_STATS
+void ldc_query_count_legacy(void);
+
+#endif /* INC_LDC_QUERY_H_ */
@@ -0,0 +1,91 @@
+// Source file for the lock-free sample ring.
+#include "ldc_ring.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#define RING_MASK (LDC_RING_CAPACITY - 1)
+
+void ldc_ring_init(struct ldc_ring *ring) {
+    atomic_init(&ring->head, 0);
+    for (size_t i = 0; i < LDC_RING_CAPACITY; i++) {
+        atomic_init(&ring->slots[i].seq, 0);
+        atomic_init(&ring->slots[i].t_ns, 0);
+        atomic_init(&ring->slots[i].value, 0);
+        atomic_init(&ring->slots[i].flags, 0);
+    }
+}
+
+uint64_t ldc_ring_publish(struct ldc_ring *ring, uint64_t t_ns, uint32_t value, uint32_t flags) {
+    uint64_t seq = atomic_load_explicit(&ring->head, memory_order_relaxed) + 1;
+    struct ldc_ring_slot *slot = &ring->slots[seq & RING_MASK];
+
+    // Invalidate the slot before touching its payload so readers cannot mix old and new fields
+    atomic_store_explicit(&slot->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&slot->t_ns, t_ns, memory_order_relaxed);
+    atomic_store_explicit(&slot->value, value, memory_order_relaxed);
+    atomic_store_explicit(&slot->flags, flags, memory_order_relaxed);
+    atomic_store_explicit(&slot->seq, seq, memory_order_release);
+
+    atomic_store_explicit(&ring->head, seq, memory_order_release);
+    return seq;
+}
+
+uint64_t ldc_ring_head(const struct ldc_ring *ring) {
+    return atomic_load_explicit(&ring->head, memory_order_acquire);
+}
+
+uint64_t ldc_ring_tail(const struct ldc_ring *ring) {
+    uint64_t head = ldc_ring_head(ring);
+    // The slot after head is the one the producer overwrites next
+    return (head >= LDC_RING_CAPACITY) ? head - LDC_RING_CAPACITY + 2 : 1;
+}
+
+int ldc_ring_get(const struct ldc_ring *ring, uint64_t seq, struct ldc_sample *out) {
+    const struct ldc_ring_slot *slot = &ring->slots[seq & RING_MASK];
+
+    if (seq == 0 || atomic_load_explicit(&slot->seq, memory_order_acquire) != seq) {
+        return -1; // not published yet, or already overwritten
+    }
+    out->seq = seq;
+    out->t_ns = atomic_load_explicit(&slot->t_ns, memory_order_relaxed);
+    out->value = atomic_load_explicit(&slot->value, memory_order_relaxed);
+    out->flags = atomic_load_explicit(&slot->flags, memory_order_relaxed);
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&slot->seq, memory_order_relaxed) != seq) {
+        return -1; // overwritten while copying
+    }
+    return 0;
+}
+
+int ldc_ring_latest(const struct ldc_ring *ring, struct ldc_sample *out) {
+    // The producer can lap a slow reader between loading head and copying
+    for (;;) {
+        uint64_t head = ldc_ring_head(ring);
+        if (head == 0) return -1;
+        if (ldc_ring_get(ring, head, out) == 0) return 0;
+    }
+}
+
+size_t ldc_ring_read_since(const struct ldc_ring *ring, uint64_t *next_seq,
+                           struct ldc_sample *out, size_t max) {
+    uint64_t head = ldc_ring_head(ring);
+    uint64_t seq = *next_seq;
+    size_t n = 0;
+
+    if (seq == 0) seq = 1;
+    while (n < max && seq <= head) {
+        if (seq < ldc_ring_tail(ring)) {
+            seq = ldc_ring_tail(ring); // fell behind the producer, skip to the oldest sample held
+            continue;
+        }
+        if (ldc_ring_get(ring, seq, &out[n]) != 0) {
+            continue; // overwritten while reading, the tail check moves us forward
+        }
+        n++;
+        seq++;
+    }
+    *next_seq = seq;
+    return n;
+}
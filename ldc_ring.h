@@ -0,0 +1,75 @@
+/*
+ * ldc_ring.h
+ *
+ * Fixed-capacity single-producer / multi-reader sample ring.
+ *
+ * The acquisition thread publishes samples without ever waiting on readers.
+ * Every slot carries the sequence number of the sample it holds; readers
+ * validate it before and after copying (a per-slot seqlock), so a slot that
+ * is overwritten mid-read is detected instead of returned torn. The ring
+ * holds no pointers and can be placed in shared memory.
+ */
+
+#ifndef INC_LDC_RING_H_
+#define INC_LDC_RING_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#define LDC_RING_CAPACITY 4096 // samples per ring, must be a power of two
+
+// One acquired sample as handed to readers
+struct ldc_sample {
+    uint64_t seq;    // monotonic sequence number, first sample is 1
+    uint64_t t_ns;   // CLOCK_MONOTONIC acquisition time
+    uint32_t value;  // 28-bit raw conversion result
+    uint32_t flags;  // LDC1614 error bits (UR/OR/WD/AE) in bits 3:0, LDC_FLAG_* from ldc_proto.h
+};
+
+struct ldc_ring_slot {
+    _Atomic uint64_t seq; // sequence number of the sample held, 0 while being rewritten
+    _Atomic uint64_t t_ns;
+    _Atomic uint32_t value;
+    _Atomic uint32_t flags;
+};
+
+struct ldc_ring {
+    _Atomic uint64_t head; // sequence number of the newest sample, 0 when empty
+    struct ldc_ring_slot slots[LDC_RING_CAPACITY];
+};
+
+void ldc_ring_init(struct ldc_ring *ring);
+
+/**
+ * @brief Publish a sample (producer thread only, never blocks).
+ * @return sequence number assigned to the sample
+ */
+uint64_t ldc_ring_publish(struct ldc_ring *ring, uint64_t t_ns, uint32_t value, uint32_t flags);
+
+// Sequence number of the newest sample, 0 if nothing was published yet
+uint64_t ldc_ring_head(const struct ldc_ring *ring);
+
+// Oldest sequence number that may still be held by the ring
+uint64_t ldc_ring_tail(const struct ldc_ring *ring);
+
+/**
+ * @brief Copy the sample with sequence number seq.
+ * @return 0 on success, -1 if it has not been published or was overwritten
+ */
+int ldc_ring_get(const struct ldc_ring *ring, uint64_t seq, struct ldc_sample *out);
+
+// Copy the newest sample, returns -1 if the ring is empty
+int ldc_ring_latest(const struct ldc_ring *ring, struct ldc_sample *out);
+
+/**
+ * @brief Copy up to max samples starting at sequence number *next_seq.
+ * @param next_seq in: first sequence number wanted, out: next one to ask for
+ * @return number of samples copied
+ * @note A reader that fell more than LDC_RING_CAPACITY samples behind resumes
+ * at the oldest sample still held; the jump shows up in the sequence numbers.
+ */
+size_t ldc_ring_read_since(const struct ldc_ring *ring, uint64_t *next_seq,
+                           struct ldc_sample *out, size_t max);
+
+#endif /* INC_LDC_RING_H_ */
@@ -0,0 +1,206 @@
+// Source file for the real-time execution mode.
+#define _GNU_SOURCE
+#include "ldc_rt.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define ISOLATED_CPUS "/sys/devices/system/cpu/isolated"
+
+static int memory_locked = 0;
+
+int ldc_rt_parse(const char *arg, struct ldc_rt_config *cfg) {
+    int cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int prio = LDC_RT_DEFAULT_PRIORITY, acquire = cpus - 1, serve = LDC_RT_NO_CPU;
+
+    if (arg != NULL && *arg != '\0' && sscanf(arg, "%d,%d,%d", &prio, &acquire, &serve) < 1) {
+        return -1;
+    }
+    if (prio < sched_get_priority_min(SCHED_FIFO) || prio > sched_get_priority_max(SCHED_FIFO) ||
+        acquire < 0 || acquire >= cpus || serve < LDC_RT_NO_CPU || serve >= cpus) {
+        return -1;
+    }
+    cfg->priority = prio;
+    cfg->acquire_cpu = acquire;
+    cfg->serve_cpu = serve;
+    cfg->num_acquire = 1;
+    return 0;
+}
+
+int ldc_rt_acquire_cpu(const struct ldc_rt_config *cfg, int index) {
+    int cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    return ((cfg->acquire_cpu - index) % cpus + cpus) % cpus;
+}
+
+int ldc_rt_lock_memory(void) {
+    // MCL_FUTURE also locks (and populates) the stacks of threads started later
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        perror("mlockall failed, memory stays pageable");
+        return -1;
+    }
+    memory_locked = 1;
+    return 0;
+}
+
+int ldc_rt_pin_serving(const struct ldc_rt_config *cfg) {
+    cpu_set_t set;
+
+    if (cfg->serve_cpu != LDC_RT_NO_CPU) {
+        CPU_ZERO(&set);
+        CPU_SET(cfg->serve_cpu, &set);
+    } else {
+        if (sched_getaffinity(0, sizeof(set), &set) != 0) return -1;
+        for (int i = 0; i < cfg->num_acquire; i++) {
+            CPU_CLR(ldc_rt_acquire_cpu(cfg, i), &set);
+        }
+        if (CPU_COUNT(&set) == 0) return 0; // single CPU, nothing to separate
+    }
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        perror("Failed to pin serving threads");
+        return -1;
+    }
+    return 0;
+}
+
+static int start_thread(pthread_t *thread, const struct ldc_rt_config *cfg, int cpu, int realtime,
+                        void *(*fn)(void *), void *arg) {
+    pthread_attr_t attr;
+    cpu_set_t set;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, LDC_RT_STACK_SIZE);
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+    if (realtime) {
+        struct sched_param param = { .sched_priority = cfg->priority };
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        pthread_attr_setschedparam(&attr, &param);
+    }
+    int ret = pthread_create(thread, &attr, fn, arg);
+    pthread_attr_destroy(&attr);
+    return ret;
+}
+
+int ldc_rt_thread_create(pthread_t *thread, const struct ldc_rt_config *cfg, int index,
+                         void *(*fn)(void *), void *arg) {
+    int cpu = ldc_rt_acquire_cpu(cfg, index);
+    int ret = start_thread(thread, cfg, cpu, 1, fn, arg);
+    if (ret == EPERM) {
+        fprintf(stderr, "SCHED_FIFO not permitted (needs CAP_SYS_NICE or an rtprio limit), "
+                        "acquisition runs under SCHED_OTHER\n");
+        ret = start_thread(thread, cfg, cpu, 0, fn, arg);
+    }
+    if (ret != 0) {
+        fprintf(stderr, "Failed to start acquisition thread on CPU %d: %s\n", cpu, strerror(ret));
+        return -1;
+    }
+    return 0;
+}
+
+void ldc_rt_prefault_stack(void) {
+    volatile unsigned char buf[LDC_RT_STACK_SIZE / 2];
+    long page = sysconf(_SC_PAGESIZE);
+    for (size_t i = 0; i < sizeof(buf); i += page) {
+        buf[i] = 0;
+    }
+}
+
+// Parse a kernel CPU list ("1,3-5") into set
+static void parse_cpulist(const char *list, cpu_set_t *set) {
+    char *end = NULL;
+    CPU_ZERO(set);
+    while (*list) {
+        long first = strtol(list, &end, 10);
+        if (end == list) break;
+        long last = first;
+        if (*end == '-') last = strtol(end + 1, &end, 10);
+        for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+            CPU_SET(cpu, set);
+        }
+        list = (*end == ',') ? end + 1 : end;
+        if (*list == '\n') break;
+    }
+}
+
+// Format set as a kernel CPU list
+static void format_cpulist(const cpu_set_t *set, char *buf, size_t len) {
+    size_t used = 0;
+    buf[0] = '\0';
+    for (int cpu = 0; cpu < CPU_SETSIZE && used < len; cpu++) {
+        if (!CPU_ISSET(cpu, set)) continue;
+        int last = cpu;
+        while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, set)) last++;
+        used += snprintf(buf + used, len - used, (last == cpu) ? "%s%d" : "%s%d-%d",
+                         used ? "," : "", cpu, last);
+        cpu = last;
+    }
+}
+
+static int cpu_isolated(int cpu) {
+    char list[256];
+    cpu_set_t set;
+    FILE *f = fopen(ISOLATED_CPUS, "r");
+    if (f == NULL) return 0;
+    int ok = fgets(list, sizeof(list), f) != NULL;
+    fclose(f);
+    if (!ok) return 0;
+    parse_cpulist(list, &set);
+    return CPU_ISSET(cpu, &set);
+}
+
+// Locked memory of this process in kB, -1 if unknown
+static long locked_kb(void) {
+    char line[128];
+    long kb = -1;
+    FILE *f = fopen("/proc/self/status", "r");
+    if (f == NULL) return -1;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        if (sscanf(line, "VmLck: %ld kB", &kb) == 1) break;
+    }
+    fclose(f);
+    return kb;
+}
+
+void ldc_rt_report(FILE *f, const pthread_t *acquire, int n, const struct ldc_rt_config *cfg) {
+    struct sched_param param;
+    cpu_set_t set;
+    char cpus[128];
+
+    fprintf(f, "Real-time mode:\n");
+    for (int i = 0; i < n; i++) {
+        int policy = SCHED_OTHER;
+        int cpu = ldc_rt_acquire_cpu(cfg, i);
+        pthread_getschedparam(acquire[i], &policy, &param);
+        fprintf(f, "  acquisition: ");
+        if (policy == SCHED_FIFO) {
+            fprintf(f, "SCHED_FIFO priority %d", param.sched_priority);
+        } else {
+            fprintf(f, "SCHED_OTHER (SCHED_FIFO %d not granted)", cfg->priority);
+        }
+        if (pthread_getaffinity_np(acquire[i], sizeof(set), &set) == 0) {
+            format_cpulist(&set, cpus, sizeof(cpus));
+            fprintf(f, " on CPU %s", cpus);
+        }
+        if (cpu_isolated(cpu)) {
+            fprintf(f, " (isolated)\n");
+        } else {
+            fprintf(f, " (not isolated, boot with isolcpus=%d)\n", cpu);
+        }
+    }
+
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        format_cpulist(&set, cpus, sizeof(cpus));
+        fprintf(f, "  serving: CPU %s\n", cpus);
+    }
+    if (memory_locked) {
+        fprintf(f, "  memory: locked, %ld kB resident\n", locked_kb());
+    } else {
+        fprintf(f, "  memory: not locked\n");
+    }
+    fflush(f);
+}
@@ -0,0 +1,66 @@
+/*
+ * ldc_rt.h
+ *
+ * Opt-in real-time execution for the acquisition threads.
+ *
+ * Each acquisition thread (one per bus) runs under SCHED_FIFO pinned to its
+ * own CPU (ideally kept free with isolcpus=), the serving threads are pinned
+ * to the others, and all memory is locked and prefaulted so no page fault lands
+ * between a data-ready edge and the read. Each step degrades to the normal
+ * behaviour when it is not permitted; ldc_rt_report() says what was granted.
+ */
+
+#ifndef INC_LDC_RT_H_
+#define INC_LDC_RT_H_
+
+#include <stdio.h>
+#include <pthread.h>
+
+#define LDC_RT_DEFAULT_PRIORITY  80
+#define LDC_RT_STACK_SIZE        (256 * 1024) // locked stacks are resident, so keep them small
+#define LDC_RT_NO_CPU            -1
+
+struct ldc_rt_config {
+    int priority;     // SCHED_FIFO priority of the acquisition thread
+    int acquire_cpu;  // CPU the first acquisition thread is pinned to, further ones count down from it
+    int serve_cpu;    // CPU of the serving threads, LDC_RT_NO_CPU = every CPU but the acquisition CPUs
+    int num_acquire;  // acquisition threads, 1 unless the caller sets more before starting them
+};
+
+/**
+ * @brief Parse "priority[,acquire_cpu[,serve_cpu]]".
+ * @note The acquisition CPU defaults to the last online CPU, where isolcpus= is usually set.
+ * @return 0 on success, -1 on a malformed or out of range value
+ */
+int ldc_rt_parse(const char *arg, struct ldc_rt_config *cfg);
+
+// CPU of acquisition thread index: acquire_cpu, acquire_cpu - 1, ..., wrapping past CPU 0
+int ldc_rt_acquire_cpu(const struct ldc_rt_config *cfg, int index);
+
+/**
+ * @brief Lock current and future memory (mlockall). Call before starting threads.
+ * @return 0 on success, -1 if not permitted
+ */
+int ldc_rt_lock_memory(void);
+
+/**
+ * @brief Pin the calling thread, and the threads it starts later, to the serving CPUs.
+ * @return 0 on success, -1 on failure
+ */
+int ldc_rt_pin_serving(const struct ldc_rt_config *cfg);
+
+/**
+ * @brief Start an acquisition thread under SCHED_FIFO, pinned to ldc_rt_acquire_cpu(cfg, index).
+ * @note Falls back to default attributes if the real-time policy is not permitted.
+ * @return 0 on success, -1 if the thread could not be started at all
+ */
+int ldc_rt_thread_create(pthread_t *thread, const struct ldc_rt_config *cfg, int index,
+                         void *(*fn)(void *), void *arg);
+
+// Touch the calling thread's stack so later calls never fault it in
+void ldc_rt_prefault_stack(void);
+
+// Print the scheduling policy and affinity of the n acquisition threads and the memory locking actually in effect
+void ldc_rt_report(FILE *f, const pthread_t *acquire, int n, const struct ldc_rt_config *cfg);
+
+#endif /* INC_LDC_RT_H_ */
@@ -0,0 +1,241 @@
+// Source file for the epoll UDP server.
+#define _GNU_SOURCE // recvmmsg, sendmmsg
+#include "ldc_server.h"
+#include "ldc_proto.h"
+#include "ldc_time.h"
+#include "ldc_metrics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+// Replies produced while handling one receive batch
+struct send_batch {
+    int sock;
+    int count;
+    struct mmsghdr msgs[LDC_SERVER_BATCH];
+    struct iovec iov[LDC_SERVER_BATCH];
+    struct sockaddr_in to[LDC_SERVER_BATCH];
+    uint8_t bufs[LDC_SERVER_BATCH][LDC_MAX_DATAGRAM];
+};
+
+struct server_thread {
+    struct ldc_server *srv;
+    int sock;
+    struct mmsghdr msgs[LDC_SERVER_BATCH];
+    struct iovec iov[LDC_SERVER_BATCH];
+    struct sockaddr_in from[LDC_SERVER_BATCH];
+    uint64_t t_rx[LDC_SERVER_BATCH];
+    uint8_t ctrl[LDC_SERVER_BATCH][CMSG_SPACE(sizeof(struct timespec))];
+    uint8_t bufs[LDC_SERVER_BATCH][LDC_SERVER_MAX_REQUEST];
+    struct send_batch out;
+};
+
+static _Thread_local struct send_batch *current_batch = NULL;
+
+static void flush_batch(struct send_batch *b) {
+    int sent = 0;
+    while (sent < b->count) {
+        int n = sendmmsg(b->sock, b->msgs + sent, b->count - sent, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            sent++; // drop the datagram that failed (e.g. ICMP unreachable from an earlier reply)
+            continue;
+        }
+        sent += n;
+    }
+    b->count = 0;
+}
+
+void ldc_server_send(int sock, const void *buf, size_t len, const struct sockaddr_in *to) {
+    struct send_batch *b = current_batch;
+    if (b == NULL) {
+        sendto(sock, buf, len, 0, (const struct sockaddr *)to, sizeof(*to));
+        return;
+    }
+    if (b->count == LDC_SERVER_BATCH) flush_batch(b);
+    int i = b->count++;
+    memcpy(b->bufs[i], buf, len);
+    b->iov[i].iov_len = len;
+    b->to[i] = *to;
+}
+
+// CLOCK_MONOTONIC receive time of one datagram from its SCM_TIMESTAMPNS, else the time recvmmsg returned
+static uint64_t receive_time(struct msghdr *msg, uint64_t mono, uint64_t real) {
+    for (struct cmsghdr *c = CMSG_FIRSTHDR(msg); c != NULL; c = CMSG_NXTHDR(msg, c)) {
+        if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPNS) {
+            struct timespec ts;
+            memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+            uint64_t age = real - ldc_timespec_to_ns(&ts);
+            return (age < mono) ? mono - age : mono; // a realtime step backwards gives no negative age
+        }
+    }
+    return mono;
+}
+
+// Owns t, allocated by ldc_server_start(), and frees it on the way out
+static void *server_worker(void *arg) {
+    struct server_thread *t = arg;
+    struct epoll_event ev = { .events = EPOLLIN }, events[2];
+    int ep = epoll_create1(0);
+
+    if (ep < 0) {
+        perror("epoll_create1 failed");
+        free(t);
+        return NULL;
+    }
+    ev.data.fd = t->sock;
+    epoll_ctl(ep, EPOLL_CTL_ADD, t->sock, &ev);
+    ev.data.fd = t->srv->stop_fd;
+    epoll_ctl(ep, EPOLL_CTL_ADD, t->srv->stop_fd, &ev);
+
+    for (int i = 0; i < LDC_SERVER_BATCH; i++) {
+        t->iov[i] = (struct iovec){ t->bufs[i], sizeof(t->bufs[i]) };
+        t->msgs[i].msg_hdr.msg_iov = &t->iov[i];
+        t->msgs[i].msg_hdr.msg_iovlen = 1;
+        t->msgs[i].msg_hdr.msg_name = &t->from[i];
+        t->msgs[i].msg_hdr.msg_control = t->ctrl[i];
+        t->out.iov[i].iov_base = t->out.bufs[i];
+        t->out.msgs[i].msg_hdr.msg_iov = &t->out.iov[i];
+        t->out.msgs[i].msg_hdr.msg_iovlen = 1;
+        t->out.msgs[i].msg_hdr.msg_name = &t->out.to[i];
+        t->out.msgs[i].msg_hdr.msg_namelen = sizeof(t->out.to[i]);
+    }
+    t->out.sock = t->sock;
+    current_batch = &t->out;
+
+    for (;;) {
+        int n = epoll_wait(ep, events, 2, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait failed");
+            break;
+        }
+        int stop = 0;
+        for (int e = 0; e < n; e++) {
+            if (events[e].data.fd == t->srv->stop_fd) stop = 1;
+        }
+        if (stop) break;
+
+        // Drain the socket: a full batch means more may be waiting
+        int got;
+        do {
+            for (int i = 0; i < LDC_SERVER_BATCH; i++) {
+                // the kernel overwrites both lengths
+                t->msgs[i].msg_hdr.msg_namelen = sizeof(t->from[i]);
+                t->msgs[i].msg_hdr.msg_controllen = sizeof(t->ctrl[i]);
+            }
+            got = recvmmsg(t->sock, t->msgs, LDC_SERVER_BATCH, MSG_DONTWAIT, NULL);
+            if (got < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) perror("UDP receive error");
+                break;
+            }
+            uint64_t mono = ldc_now_ns(), real = ldc_realtime_ns();
+            for (int i = 0; i < got; i++) {
+                t->t_rx[i] = receive_time(&t->msgs[i].msg_hdr, mono, real);
+                t->srv->handler(t->sock, t->bufs[i], (int)t->msgs[i].msg_len, &t->from[i], t->t_rx[i]);
+            }
+            flush_batch(&t->out);
+            uint64_t t_sent = ldc_now_ns();
+            for (int i = 0; i < got; i++) {
+                ldc_metrics_record(LDC_HIST_REQUEST, t_sent - t->t_rx[i]);
+            }
+        } while (got == LDC_SERVER_BATCH);
+    }
+    current_batch = NULL;
+    close(ep);
+    free(t);
+    return NULL;
+}
+
+int ldc_server_open(struct ldc_server *srv, int port, int num_threads) {
+    struct sockaddr_in addr;
+    int one = 1;
+
+    srv->num_threads = 0;
+    srv->started = 0;
+    srv->stop_fd = -1;
+    if (num_threads < 1 || num_threads > LDC_SERVER_MAX_THREADS) {
+        fprintf(stderr, "Server threads must be 1 to %d\n", LDC_SERVER_MAX_THREADS);
+        return -1;
+    }
+    srv->stop_fd = eventfd(0, EFD_CLOEXEC);
+    if (srv->stop_fd < 0) {
+        perror("Failed to create eventfd");
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(port);
+    for (int i = 0; i < num_threads; i++) {
+        int sock = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (sock < 0) {
+            perror("Failed to create UDP socket");
+            ldc_server_close(srv);
+            return -1;
+        }
+        srv->socks[srv->num_threads++] = sock;
+        if (num_threads > 1 && setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0) {
+            perror("SO_REUSEPORT failed");
+            ldc_server_close(srv);
+            return -1;
+        }
+        if (bind(sock, (const struct sockaddr *)&addr, sizeof(addr)) < 0) {
+            perror("UDP Bind failed");
+            ldc_server_close(srv);
+            return -1;
+        }
+        // Without kernel timestamps requests are stamped when recvmmsg returns
+        setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPNS, &one, sizeof(one));
+    }
+    return 0;
+}
+
+int ldc_server_start(struct ldc_server *srv, ldc_server_handler handler) {
+    srv->handler = handler;
+    for (int i = 0; i < srv->num_threads; i++) {
+        struct server_thread *t = calloc(1, sizeof(*t));
+        if (t == NULL) {
+            perror("Failed to allocate server thread");
+            return -1;
+        }
+        t->srv = srv;
+        t->sock = srv->socks[i];
+        int ret = pthread_create(&srv->threads[i], NULL, server_worker, t);
+        if (ret != 0) {
+            fprintf(stderr, "Failed to create server thread: %s\n", strerror(ret));
+            free(t);
+            return -1;
+        }
+        srv->started++;
+    }
+    return 0;
+}
+
+void ldc_server_stop(struct ldc_server *srv) {
+    uint64_t one = 1;
+    if (srv->stop_fd >= 0) {
+        ssize_t ret = write(srv->stop_fd, &one, sizeof(one));
+        (void)ret; // the counter only overflows after 2^64 - 1 stops
+    }
+}
+
+void ldc_server_close(struct ldc_server *srv) {
+    ldc_server_stop(srv);
+    for (int i = 0; i < srv->started; i++) {
+        pthread_join(srv->threads[i], NULL);
+    }
+    srv->started = 0;
+    for (int i = 0; i < srv->num_threads; i++) {
+        close(srv->socks[i]);
+    }
+    srv->num_threads = 0;
+    if (srv->stop_fd >= 0) close(srv->stop_fd);
+    srv->stop_fd = -1;
+}
@@ -0,0 +1,75 @@
+/*
+ * ldc_server.h
+ *
+ * Event-driven UDP front end of ldc_service.
+ *
+ * Each server thread owns one socket bound to the service port (with
+ * SO_REUSEPORT when there are several, so the kernel spreads clients over
+ * them) and waits on it with epoll. A wakeup drains the socket with
+ * recvmmsg, hands every datagram to the request handler and sends all the
+ * replies the handler produced with one sendmmsg. Shutdown is an eventfd
+ * that every thread also waits on, so nothing polls with a timeout.
+ *
+ * Requests carry the kernel's receive timestamp (SO_TIMESTAMPNS), moved
+ * onto CLOCK_MONOTONIC, so queueing in the socket and the time to the
+ * reply leaving are measured from when the datagram actually arrived.
+ */
+
+#ifndef INC_LDC_SERVER_H_
+#define INC_LDC_SERVER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <netinet/in.h>
+
+#define LDC_SERVER_BATCH        32 // datagrams per recvmmsg and per sendmmsg
+#define LDC_SERVER_MAX_THREADS  8
+#define LDC_SERVER_MAX_REQUEST  1024 // longer requests are truncated
+
+/**
+ * @brief Answer one request. Runs on the server thread that received it, possibly
+ * concurrently with other threads; replies go out through ldc_server_send().
+ * @param sock socket the request arrived on
+ * @param req request bytes
+ * @param n request length
+ * @param from sender
+ * @param t_rx CLOCK_MONOTONIC receive time, the kernel's when it provided one
+ */
+typedef void (*ldc_server_handler)(int sock, const uint8_t *req, int n, const struct sockaddr_in *from,
+                                   uint64_t t_rx);
+
+struct ldc_server {
+    int num_threads;
+    int socks[LDC_SERVER_MAX_THREADS];
+    int stop_fd;                // eventfd, readable once ldc_server_stop() was called
+    ldc_server_handler handler;
+    pthread_t threads[LDC_SERVER_MAX_THREADS];
+    int started;                // threads running
+};
+
+/**
+ * @brief Create the sockets and the stop eventfd, bound to port on every address.
+ * @param num_threads server threads, 1 to LDC_SERVER_MAX_THREADS
+ * @return 0 on success, -1 on failure (reported with perror)
+ */
+int ldc_server_open(struct ldc_server *srv, int port, int num_threads);
+
+// Start the server threads, 0 on success, -1 on failure
+int ldc_server_start(struct ldc_server *srv, ldc_server_handler handler);
+
+// Wake every server thread to exit. Async-signal-safe: a single write() to the eventfd.
+void ldc_server_stop(struct ldc_server *srv);
+
+// Stop and join the threads, close the sockets and the eventfd
+void ldc_server_close(struct ldc_server *srv);
+
+/**
+ * @brief Send one datagram. On a server thread the reply is queued and sent with the
+ * others of the same receive batch, from the socket the request came in on; on any
+ * other thread it goes out at once with sendto() on sock.
+ * @param len at most LDC_MAX_DATAGRAM
+ */
+void ldc_server_send(int sock, const void *buf, size_t len, const struct sockaddr_in *to);
+
+#endif /* INC_LDC_SERVER_H_ */
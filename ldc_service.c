@@ -2,132 +2,765 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <unistd.h>
-#include <fcntl.h>
-#include <sys/ioctl.h>
-#include <linux/i2c-dev.h>
-#include <i2c/smbus.h>
 #include <pthread.h>
 #include <time.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <string.h>
 #include <signal.h>
 #include <errno.h>
-
-// --- LDC1614 Register Definitions ---
-#define LDC1614_ADDR             0x2B
-#define LDC1614_DATA0_MSB        0x00
-#define LDC1614_DATA0_LSB        0x01
-#define LDC1614_RCOUNT0          0x08
-#define LDC1614_SETTLECOUNT0     0x10
-#define LDC1614_CLOCK_DIVIDERS0  0x14
-#define LDC1614_ERROR_CONFIG     0x19
-#define LDC1614_MUX_CONFIG       0x1B
-#define LDC1614_CONFIG           0x1A
-#define LDC1614_DRIVE_CURRENT0   0x1E
-
-// --- Error Config Bit Masks ---
-#define LDC_DRDY_2INT            (1 << 0)
-#define LDC1614_AL_ERR2OUT       (1 << 11)
-#define LDC1614_AH_ERR2OUT       (1 << 12)
-#define LDC1614_WD_ERR2OUT       (1 << 13)
-#define LDC1614_OR_ERR2OUT       (1 << 14)
-#define LDC1614_UR_ERR2OUT       (1 << 15)
-
-#define ERROR_CONFIG_VAL (LDC_DRDY_2INT | LDC1614_AH_ERR2OUT | LDC1614_AL_ERR2OUT | LDC1614_UR_ERR2OUT | LDC1614_OR_ERR2OUT)
+#include <stdatomic.h>
+
+#include "ldc1614.h"
+#include "ldc_bus.h"
+#include "ldc_sim.h"
+#include "ldc_trace.h"
+#include "ldc_ring.h"
+#include "ldc_proto.h"
+#include "ldc_stream.h"
+#include "ldc_query.h"
+#include "ldc_server.h"
+#include "ldc_shm.h"
+#include "ldc_event.h"
+#include "ldc_time.h"
+#include "ldc_log.h"
+#include "ldc_metrics.h"
+#include "ldc_rt.h"
+#include "ldc_profile.h"
+#include "ldc_filter.h"
 
 // --- Polling Configuration ---
-#define POLL_INTERVAL_NS         1000000 // 1 ms in nanoseconds (1 kHz polling rate)
+#define EVENT_TIMEOUT_MS         100     // re-read STATUS if INTB stays quiet this long
+#define PHASE_RETRY_DIV          16      // polling: re-read 1/16 period later when a conversion is not done yet
+#define PHASE_PULL_DIV           256     // polling: move 1/256 period earlier after each read that found new data
+#define ERROR_REPORT_NS          10000000000ULL // summarize conversion errors at most every 10 s
+#define HOUSEKEEPING_MS          500     // main thread: metrics dump and error summary check
+
+// --- UDP Request Codes (first byte of the datagram) ---
+#define REQ_ALL_CHANNELS         0xFF    // latest value of every channel
+#define REQ_HISTORY              0x80    // 0x80 | ch, count: last count values of channel ch
 
 // --- Global Shared State ---
-pthread_mutex_t value_lock = PTHREAD_MUTEX_INITIALIZER;
-uint32_t current_frequency_value = 0;
+// per-channel sample history, each written only by its device's polling thread;
+// device d's CHn is at d * LDC_DEVICE_CHANNELS + n, filtered at + LDC_FILTERED_OFFSET
+struct ldc_ring ring_store[LDC_MAX_DEVICES * LDC_DEVICE_CHANNELS];
+struct ldc_ring *rings = ring_store; // or the rings of the shared memory segment (-m)
+char shm_name[LDC_SHM_NAME_LEN] = ""; // POSIX shared memory name the rings are exported under, empty = none
+struct ldc_shm shm;
+uint8_t channel_mask = 0x01; // channels to acquire (bit n = CHn) on devices without their own list, default CH0 only
+#define DEFAULT_CHANNEL_CONFIG {LDC1614_DEFAULT_RCOUNT, LDC1614_DEFAULT_SETTLECOUNT, \
+                                LDC1614_DEFAULT_CLOCK_DIVIDERS, LDC1614_DEFAULT_DRIVE_CURRENT}
+struct ldc1614_channel_config chan_config[LDC1614_NUM_CHANNELS] = {
+    DEFAULT_CHANNEL_CONFIG, DEFAULT_CHANNEL_CONFIG, DEFAULT_CHANNEL_CONFIG, DEFAULT_CHANNEL_CONFIG,
+};
 volatile sig_atomic_t stop_event = 0;
+volatile sig_atomic_t dump_metrics = 0; // set by SIGUSR1, the main thread prints the metrics
 int logging = 0; // default logging disabled
-char logfile[50] = "./testing/ldc1614_log.csv"; // default logfile name
+char logfile[50] = "./testing/ldc1614_log.bin"; // default logfile name, a .csv name logs text
 int port = 5432; // default UDP port
+int server_threads = 1; // UDP server threads, each with its own SO_REUSEPORT socket (-w)
+struct ldc_server server = { .stop_fd = -1 };
+char bus_spec[128] = LDC_BUS_DEFAULT; // i2c-dev adapter, "wiringpi", "sim[:options]" or a trace
+int use_intb = 1; // wait for the INTB data-ready edge, 0 = poll once per conversion period
+char gpio_chip[32] = LDC_GPIO_CHIP; // GPIO character device INTB is wired to (device 0's)
+unsigned int intb_line = LDC_INTB_LINE;
+int rt_mode = 0; // SCHED_FIFO acquisition, CPU pinning and locked memory
+struct ldc_rt_config rt_config;
+struct ldc_profile_set profiles; // built-in, loaded with -S, plus "startup"; read-only once running
+char startup_profile[LDC_PROFILE_NAME_LEN] = ""; // -s, empty = the -C settings
+const struct ldc_profile *_Atomic active_profile = NULL; // settings the devices are running
+const struct ldc_profile *_Atomic requested_profile = NULL; // latest switch, applied by every polling thread
+_Atomic uint32_t profile_generation = 0; // profile switches requested so far
+pthread_mutex_t profile_lock = PTHREAD_MUTEX_INITIALIZER; // the polling threads' reports of a switch
+uint32_t report_generation = 0; // switch being reported, under profile_lock
+int profile_reports = 0;        // polling threads done with report_generation, under profile_lock
+int filtering = 0; // run the -F pipeline and publish its output as channels 4-7 of each device
+struct ldc_filter filter; // the parsed -F pipeline, copied to every device
+double tank_f[LDC1614_NUM_CHANNELS] = {0}; // LC tank capacitance per channel in farads, 0 = unknown (-T)
+
+// --- Devices ---
+// One LDC1614 of the channel namespace, set up from -D (or -d and -c)
+struct device {
+    int index;                  // CHn is served as index * LDC_DEVICE_CHANNELS + n
+    char bus_spec[128];         // as for -d
+    uint8_t addr;               // LDC1614_ADDR or LDC1614_ADDR_LOW
+    uint8_t channel_mask;       // channels to acquire, 0 until set = the -c list
+    int open;                   // bus is open
+    struct ldc_bus bus;         // used only by the device's polling thread once running
+    struct ldc1614_channel_config config[LDC1614_NUM_CHANNELS]; // settings the device runs
+    struct ldc_filter filter;   // -F pipeline state of this device's channels
+    struct ldc_log *log;        // asynchronous log writer, NULL when logging is disabled
+    struct ldc_log_config log_config; // device setup recorded in the binary log header
+    uint64_t logged, log_dropped; // records written and dropped by the log files closed so far
+    uint8_t profile_start;      // channels whose next sample is the first of a new profile
+};
+
+// One polling thread per bus: chips sharing the bus are read one after the other on each wakeup
+struct bus_worker {
+    pthread_t thread;
+    struct device *devices[LDC_MAX_DEVICES];
+    int num_devices;
+    struct ldc_event_source event_src; // what the thread waits on between reads
+    uint32_t profile_generation; // last profile switch applied
+    const struct ldc_profile *profile; // what its devices run, written under profile_lock
+};
+
+struct device devices[LDC_MAX_DEVICES];
+int num_devices = 0;
+struct bus_worker workers[LDC_MAX_DEVICES];
+int num_workers = 0;
 
 
 // Signal handler to gracefully shut down the service
 void handle_sigint(int sig) {
+    (void)sig;
     stop_event = 1;
+    ldc_server_stop(&server);
 }
 
-// Read 16-bit register (SMBus reads little-endian, LDC1614 requires big-endian swap)
-int32_t i2c_read_reg16(int fd, uint8_t reg) {
-    int32_t word = i2c_smbus_read_word_data(fd, reg);
-    if (word < 0) return word;
-    return (int32_t)ntohs((uint16_t)word);
+void handle_sigusr1(int sig) {
+    (void)sig;
+    dump_metrics = 1;
 }
 
-// Write 16-bit register (LDC1614 requires big-endian format)
-int32_t i2c_write_reg16(int fd, uint8_t reg, uint16_t value) {
-    uint16_t swapped = htons(value);
-    return i2c_smbus_write_word_data(fd, reg, swapped);
+// Initializes the LDC1614 with specific configuration values
+int init_device(struct device *dev) {
+    if (ldc1614_configure(&dev->bus, dev->channel_mask, dev->config, error_config) != 0) {
+        return -1;
+    }
+    dev->log_config.channel_mask = dev->channel_mask;
+    dev->log_config.fref_hz = LDC1614_FREF_HZ;
+    dev->log_config.error_config = error_config;
+    ldc1614_sequence_regs(dev->channel_mask, &dev->log_config.config, &dev->log_config.mux_config);
+    memcpy(dev->log_config.channels, dev->config, sizeof(dev->log_config.channels));
+    return 0;
 }
 
-// Initializes the LDC1614 with specific configuration values
-void init_device(int fd) {
-    i2c_write_reg16(fd, LDC1614_RCOUNT0, 0xFFFF);
-    i2c_write_reg16(fd, LDC1614_SETTLECOUNT0, 0x000A);
-    i2c_write_reg16(fd, LDC1614_CLOCK_DIVIDERS0, 0x1001);
-    i2c_write_reg16(fd, LDC1614_ERROR_CONFIG, ERROR_CONFIG_VAL);
-    i2c_write_reg16(fd, LDC1614_MUX_CONFIG, 0x020C);
-    i2c_write_reg16(fd, LDC1614_DRIVE_CURRENT0, 0xB000);
-    i2c_write_reg16(fd, LDC1614_CONFIG, 0x1601);
+
+// Parse a comma separated channel list ("0,1,3") into a channel mask
+int parse_channels(const char *arg, uint8_t *mask) {
+    uint8_t m = 0;
+    char *end = NULL;
+    while (*arg) {
+        long ch = strtol(arg, &end, 10);
+        if (end == arg || ch < 0 || ch >= LDC1614_NUM_CHANNELS) return -1;
+        m |= 1 << ch;
+        arg = end;
+        if (*arg == ',') arg++;
+        else if (*arg) return -1;
+    }
+    if (m == 0) return -1;
+    *mask = m;
+    return 0;
+}
+
+// Parse "bus@addr[:channels]", e.g. "/dev/i2c-1@0x2A:0,1", into the next device
+int parse_device(const char *arg) {
+    const char *at = strrchr(arg, '@');
+    char *end = NULL;
+
+    if (num_devices == LDC_MAX_DEVICES || at == NULL || at == arg ||
+        (size_t)(at - arg) >= sizeof(devices[0].bus_spec)) {
+        return -1;
+    }
+    long addr = strtol(at + 1, &end, 0);
+    if (end == at + 1 || (addr != LDC1614_ADDR && addr != LDC1614_ADDR_LOW)) return -1;
+
+    struct device *dev = &devices[num_devices];
+    memset(dev, 0, sizeof(*dev));
+    if (*end == ':') {
+        if (parse_channels(end + 1, &dev->channel_mask) != 0) return -1;
+    } else if (*end != '\0') {
+        return -1;
+    }
+    memcpy(dev->bus_spec, arg, at - arg);
+    dev->addr = (uint8_t)addr;
+    dev->index = num_devices++;
+    return 0;
+}
+
+// Parse "ch,rcount,settlecount,clock_dividers,drive_current" into chan_config
+int parse_channel_config(const char *arg) {
+    unsigned int ch;
+    int rcount, settle, dividers, drive;
+    if (sscanf(arg, "%u,%i,%i,%i,%i", &ch, &rcount, &settle, &dividers, &drive) != 5 ||
+        ch >= LDC1614_NUM_CHANNELS) {
+        return -1;
+    }
+    chan_config[ch].rcount = rcount;
+    chan_config[ch].settlecount = settle;
+    chan_config[ch].clock_dividers = dividers;
+    chan_config[ch].drive_current = drive;
+    return 0;
+}
+
+// Parse "pF" (every channel) or "pF,pF,pF,pF" into tank_f
+int parse_tank_capacitance(const char *arg) {
+    double pf[LDC1614_NUM_CHANNELS];
+    char *end = NULL;
+    int n = 0;
+    while (*arg && n < LDC1614_NUM_CHANNELS) {
+        pf[n] = strtod(arg, &end);
+        if (end == arg || pf[n] <= 0.0) return -1;
+        n++;
+        arg = end;
+        if (*arg == ',') arg++;
+        else if (*arg) return -1;
+    }
+    if (*arg || (n != 1 && n != LDC1614_NUM_CHANNELS)) return -1;
+    for (int ch = 0; ch < LDC1614_NUM_CHANNELS; ch++) {
+        tank_f[ch] = pf[(n == 1) ? 0 : ch] * 1e-12;
+    }
+    return 0;
+}
+
+// Polling without INTB: keep the timer deadlines just after each sequence completes.
+// Reads creep earlier until one finds the last channel of the sequence still converting,
+// which puts the next one a fraction of a period after that conversion.
+void track_conversion_phase(struct ldc_event_source *src, int complete, uint64_t t_read) {
+    if (src->period_ns == 0) return; // INTB already marks the end of each sequence
+    if (complete) {
+        src->next_ns -= src->period_ns / PHASE_PULL_DIV;
+    } else {
+        src->next_ns = t_read + src->period_ns / PHASE_RETRY_DIV - src->period_ns;
+    }
+}
+
+// Log file of a device: logfile for device 0, <logfile without extension>.d<index><extension>
+// for the others, and with .<generation>.<profile> before the extension once the profile switched
+void device_log_path(const struct device *dev, const char *profile, uint32_t generation, char *path, size_t len) {
+    char device[16] = "", switched[LDC_PROFILE_NAME_LEN + 16] = "";
+    const char *slash = strrchr(logfile, '/');
+    const char *ext = strrchr(slash ? slash : logfile, '.');
+    int base_len = ext ? (int)(ext - logfile) : (int)strlen(logfile);
+
+    if (dev->index > 0) snprintf(device, sizeof(device), ".d%d", dev->index);
+    if (profile != NULL) snprintf(switched, sizeof(switched), ".%u.%s", generation, profile);
+    snprintf(path, len, "%.*s%s%s%s", base_len, logfile, device, switched, ext ? ext : "");
+}
+
+// Binary log headers describe one configuration, so every profile switch starts a new file
+void rotate_log(struct device *dev, const char *profile, uint32_t generation) {
+    char path[sizeof(logfile) + LDC_PROFILE_NAME_LEN + 32];
+    struct ldc_log_stats log_stats;
+
+    device_log_path(dev, profile, generation, path, sizeof(path));
+    if (ldc_log_close(dev->log, &log_stats) != 0) {
+        fprintf(stderr, "Failed to write data to log file\n");
+    }
+    dev->logged += log_stats.records;
+    dev->log_dropped += log_stats.dropped;
+    dev->log = ldc_log_open(path, ldc_log_format_for(path), &dev->log_config);
+    if (dev->log == NULL) {
+        fprintf(stderr, "Logging stopped\n");
+    } else {
+        printf("Logging to %s\n", path);
+    }
+}
+
+// Timer period of a polling thread without INTB. Chips sharing a bus convert on their own
+// clocks, so the bus is read twice per sequence of the fastest one to catch every result.
+uint64_t worker_period_ns(const struct bus_worker *w) {
+    uint64_t period = UINT64_MAX;
+    for (int d = 0; d < w->num_devices; d++) {
+        const struct device *dev = w->devices[d];
+        uint64_t p = ldc1614_sequence_period_ns(dev->channel_mask, dev->config, LDC1614_FREF_HZ);
+        if (p < period) period = p;
+    }
+    return (w->num_devices > 1) ? period / 2 : period;
+}
+
+// Switch the device to profile p between two reads. The device sleeps while its registers
+// change, and the results of the old settings are read out first so none is published as new.
+int apply_profile(struct device *dev, const struct ldc_profile *p, uint32_t generation) {
+    struct ldc1614_burst burst;
+
+    if (ldc1614_sleep(&dev->bus) != 0 || ldc1614_read_burst(&dev->bus, dev->channel_mask, &burst) != 0) {
+        return -1;
+    }
+    memcpy(dev->config, p->channels, sizeof(dev->config));
+    if (init_device(dev) != 0) {
+        return -1;
+    }
+    ldc_filter_reset(&dev->filter); // the filter state belongs to the old settings' noise and rate
+    if (dev->log != NULL) {
+        rotate_log(dev, p->name, generation);
+    }
+    dev->profile_start = dev->channel_mask;
+    printf("Device %d switched to profile %s (%.3f ms per sample)\n", dev->index, p->name,
+           ldc1614_sequence_period_ns(dev->channel_mask, dev->config, LDC1614_FREF_HZ) / 1e6);
+    return 0;
+}
+
+// Read and publish every new conversion of one device.
+// Returns 1 if the last channel of its sequence had a new result, 0 if not, -1 on a bus error.
+int read_device(struct device *dev, uint64_t t_event) {
+    int base = dev->index * LDC_DEVICE_CHANNELS;
+    int last = 0; // highest channel, whose result ends each sequence
+    for (int ch = 0; ch < LDC1614_NUM_CHANNELS; ch++) {
+        if (dev->channel_mask & (1 << ch)) last = ch;
+    }
+
+    // STATUS and every active channel's MSB/LSB pair in a single I2C transaction
+    struct ldc1614_burst burst;
+    uint64_t t_start = ldc_now_ns();
+    int ret = ldc1614_read_burst(&dev->bus, dev->channel_mask, &burst);
+    uint64_t t_read = ldc_now_ns();
+    ldc_metrics_record(LDC_HIST_BUS_XFER, t_read - t_start);
+    if (ret != 0) {
+        ldc_metrics_count(&ldc_metrics.bus_errors, 1);
+        return -1;
+    }
+
+    // Stamp with the kernel's edge time when there is one, else right after the transfer
+    uint64_t t_ns = (t_event != 0) ? t_event : t_read;
+    int stale = 0;
+    uint8_t fresh = 0;
+    int32_t x[LDC_FILTER_LANES] = {0}; // every lane is filtered, inactive and stale ones run on 0
+    uint32_t xflags[LDC1614_NUM_CHANNELS] = {0};
+    for (int ch = 0; ch < LDC1614_NUM_CHANNELS; ch++) {
+        if (!(dev->channel_mask & (1 << ch))) continue;
+        // DATAx still holds a result we already published: not a new sample
+        if (!(burst.status & LDC1614_UNREADCONV(ch))) {
+            stale = 1;
+            continue;
+        }
+        uint32_t flags = burst.errors[ch] | LDC_FLAG_NEW_CONVERSION;
+        ldc_errors_count(&ldc_metrics.errors, base + ch, burst.errors[ch]); // reported by the main thread
+        if (dev->profile_start & (1 << ch)) {
+            flags |= LDC_FLAG_PROFILE_START;
+            dev->profile_start &= ~(1 << ch);
+        }
+        ldc_ring_publish(&rings[base + ch], t_ns, burst.value[ch], flags);
+        fresh |= 1 << ch;
+        x[ch] = burst.value[ch];
+        xflags[ch] = flags;
+        if (dev->log != NULL) {
+            struct ldc_log_rec rec = {t_ns - dev->log_config.start_ns, burst.value[ch], 0, ch, burst.errors[ch]};
+            ldc_log_push(dev->log, &rec); // drops are counted by the logger
+        }
+    }
+    if (stale) ldc_metrics_count(&ldc_metrics.stale_reads, 1);
+    if (filtering && fresh != 0) {
+        // Decimating stages publish only every R-th sample; a held-back sample's flags are dropped
+        uint8_t out = ldc_filter_run(&dev->filter, fresh, x);
+        for (int ch = 0; ch < LDC1614_NUM_CHANNELS; ch++) {
+            if (out & (1 << ch)) {
+                ldc_ring_publish(&rings[base + ch + LDC_FILTERED_OFFSET], t_ns, x[ch], xflags[ch]);
+            }
+        }
+    }
+    return (burst.status & LDC1614_UNREADCONV(last)) != 0;
 }
 
-// polling thread
+// A polling thread is done with switch generation, its devices now run applied. The last thread
+// to report publishes the profile if every bus runs it; if some bus had to stay on the old one,
+// a switch back is requested so all buses run the same settings again.
+void report_profile(struct bus_worker *w, uint32_t generation, const struct ldc_profile *applied) {
+    pthread_mutex_lock(&profile_lock);
+    w->profile = applied;
+    if (generation > report_generation) {
+        report_generation = generation;
+        profile_reports = 0;
+    }
+    // Reports of a superseded switch only update the thread's profile
+    if (generation == report_generation && ++profile_reports == num_workers &&
+        generation == atomic_load(&profile_generation)) {
+        int same = 1;
+        for (int i = 1; i < num_workers; i++) {
+            same &= (workers[i].profile == workers[0].profile);
+        }
+        if (same) {
+            atomic_store(&active_profile, applied);
+            ldc_stream_set_convert(&applied->convert);
+        } else {
+            atomic_store(&requested_profile, atomic_load(&active_profile));
+            atomic_fetch_add(&profile_generation, 1);
+        }
+    }
+    pthread_mutex_unlock(&profile_lock);
+}
+
+// Switch every device of a worker to profile, or leave them all on the one they ran.
+// Returns the profile the devices run afterwards.
+const struct ldc_profile *switch_profile(struct bus_worker *w, const struct ldc_profile *profile,
+                                         uint32_t generation) {
+    const struct ldc_profile *previous = w->profile;
+    int failed = 0;
+
+    if (profile == previous) return previous; // already running it: no sleep, no new log
+    for (int d = 0; d < w->num_devices && !failed; d++) {
+        if (apply_profile(w->devices[d], profile, generation) != 0) {
+            fprintf(stderr, "Failed to switch device %d to profile %s\n", w->devices[d]->index, profile->name);
+            ldc_metrics_count(&ldc_metrics.profile_failures, 1);
+            failed = 1;
+        }
+    }
+    if (!failed) return profile;
+    // Put every device back on the previous settings, the failed one included
+    for (int d = 0; d < w->num_devices; d++) {
+        if (apply_profile(w->devices[d], previous, generation) != 0) {
+            fprintf(stderr, "Failed to restore device %d to profile %s\n", w->devices[d]->index, previous->name);
+        }
+    }
+    return previous;
+}
+
+// polling thread of one bus: one burst read per device and data-ready event
 void* polling_worker(void* arg) {
-    int fd = *(int*)arg;
-    struct timespec next_time;
-    
-    printf("Starting LDC1614 hardware polling thread...\n");
-    clock_gettime(CLOCK_MONOTONIC, &next_time);
+    struct bus_worker *w = arg;
+    struct ldc_event_source *src = &w->event_src;
+    uint32_t overruns = src->overruns;
 
-    while (!stop_event) {
-        int32_t msb = i2c_read_reg16(fd, LDC1614_DATA0_MSB);
-        int32_t lsb = i2c_read_reg16(fd, LDC1614_DATA0_LSB);
+    printf("Starting LDC1614 hardware polling thread for %s (%d device%s, %s)...\n",
+           w->devices[0]->bus_spec, w->num_devices, (w->num_devices > 1) ? "s" : "", src->name);
+    if (rt_mode) ldc_rt_prefault_stack();
 
-        if (msb >= 0 && lsb >= 0) {
-            // Mask out error flags (top 4 bits of MSB) and combine to 28-bit
-            uint32_t val = (((uint32_t)msb & 0x0FFF) << 16) | (uint32_t)lsb;
-            
-            pthread_mutex_lock(&value_lock);
-            current_frequency_value = val;
-            pthread_mutex_unlock(&value_lock);
+    while (!stop_event) {
+        uint32_t generation = atomic_load(&profile_generation);
+        if (generation != w->profile_generation) {
+            const struct ldc_profile *requested = atomic_load(&requested_profile);
+            int reconfigured = (requested != w->profile);
+            const struct ldc_profile *applied = switch_profile(w, requested, generation);
+            w->profile_generation = generation;
+            if (reconfigured && src->period_ns != 0) {
+                src->period_ns = worker_period_ns(w);
+                src->next_ns = ldc_now_ns(); // the phase lock finds the new sequence from here
+            }
+            report_profile(w, generation, applied);
         }
 
-        // Calculate next wake-up time to prevent drift
-        next_time.tv_nsec += POLL_INTERVAL_NS;
-        if (next_time.tv_nsec >= 1000000000L) {
-            next_time.tv_nsec -= 1000000000L;
-            next_time.tv_sec += 1;
+        uint64_t t_event = 0;
+        int ev = src->wait(src, EVENT_TIMEOUT_MS, &t_event);
+        if (ev < 0) {
+            if (errno != ENODATA) perror("Event source failed"); // else a replayed trace ended
+            break;
+        }
+        // On a timeout we read anyway: reading STATUS re-arms INTB if an edge was missed
+        uint64_t t_wake = ldc_now_ns();
+        if (ev > 0) {
+            // Simulated and replayed events are on their own clock, which runs ahead in virtual mode
+            struct ldc_bus *bus = &w->devices[0]->bus;
+            uint64_t woke = t_wake;
+            if (t_event != 0 && ldc_bus_is_sim(bus)) woke = ldc_sim_now_ns(bus);
+            if (ldc_bus_is_replay(bus)) woke = ldc_replay_now_ns(bus);
+            uint64_t ready = (t_event != 0) ? t_event : src->next_ns;
+            ldc_metrics_record(LDC_HIST_WAKE_LATENESS, (woke > ready) ? woke - ready : 0);
+            ldc_metrics_count(&ldc_metrics.wakeups, 1);
+        } else {
+            ldc_metrics_count(&ldc_metrics.timeouts, 1);
+            t_event = 0;
+        }
+        if (src->overruns != overruns) {
+            ldc_metrics_count(&ldc_metrics.missed, src->overruns - overruns);
+            overruns = src->overruns;
         }
 
-        // Sleep until the next 1ms interval
-        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_time, NULL);
+        // Chips on one bus are read back to back; an edge time only exists for a bus with one chip
+        for (int d = 0; d < w->num_devices; d++) {
+            int complete = read_device(w->devices[d], t_event);
+            if (complete >= 0 && w->num_devices == 1) {
+                track_conversion_phase(src, complete, ldc_now_ns());
+            }
+        }
+        // Readers blocked on the segment re-check their rings, so a wakeup without new samples is harmless
+        if (shm.hdr != NULL) ldc_shm_notify(&shm);
     }
     
     return NULL;
 }
 
+// LDC_OP_PROFILE: queue a switch for the polling thread and report the profile that will run.
+// Returns -1 if the request is not a profile request.
+int handle_profile(int sock, const uint8_t *req, int n, const struct sockaddr_in *from) {
+    const struct ldc_msg_hdr *hdr = (const struct ldc_msg_hdr *)req;
+    struct ldc_profile_msg reply;
+    char name[LDC_PROFILE_NAME_LEN];
+    const struct ldc_profile *p;
+    uint32_t generation;
+
+    if (hdr->opcode != LDC_OP_PROFILE) return -1;
+    if (n < (int)sizeof(struct ldc_profile_msg)) {
+        ldc_query_reply_status(hdr, LDC_STATUS_BAD_REQ, from);
+        return 0;
+    }
+    memcpy(name, ((const struct ldc_profile_msg *)req)->name, sizeof(name));
+    name[sizeof(name) - 1] = '\0';
+
+    if (name[0] == '\0') {
+        p = atomic_load(&active_profile);
+        generation = atomic_load(&profile_generation);
+    } else if ((p = ldc_profile_find(&profiles, name)) != NULL) {
+        // The profile first: polling threads pick it up when they see the generation change
+        atomic_store(&requested_profile, p);
+        generation = atomic_fetch_add(&profile_generation, 1) + 1;
+    } else {
+        ldc_query_reply_status(hdr, LDC_STATUS_BAD_REQ, from);
+        return 0;
+    }
+
+    memset(&reply, 0, sizeof(reply));
+    reply.hdr = *hdr;
+    reply.hdr.status = LDC_STATUS_OK;
+    strncpy(reply.name, p->name, sizeof(reply.name) - 1);
+    reply.generation = htonl(generation);
+    // Devices with more channels take longer per sequence: the slowest one bounds every channel's rate
+    uint64_t period = 0;
+    for (int d = 0; d < num_devices; d++) {
+        uint64_t dev_period = ldc1614_sequence_period_ns(devices[d].channel_mask, p->channels, LDC1614_FREF_HZ);
+        if (dev_period > period) period = dev_period;
+    }
+    reply.period_ns = htobe64(period);
+    for (int ch = 0; ch < LDC1614_NUM_CHANNELS; ch++) {
+        reply.rcount[ch] = htons(p->channels[ch].rcount);
+    }
+    ldc_server_send(sock, &reply, sizeof(reply), from);
+    return 0;
+}
+
+// LDC_OP_TIME: echo the client's clock with the service's receive and send times.
+// Returns -1 if the request is not a time request.
+int handle_time(int sock, const uint8_t *req, int n, const struct sockaddr_in *from, uint64_t t_rx) {
+    const struct ldc_msg_hdr *hdr = (const struct ldc_msg_hdr *)req;
+    struct ldc_time_msg reply;
+
+    if (hdr->opcode != LDC_OP_TIME) return -1;
+    if (n < (int)sizeof(struct ldc_time_msg)) {
+        ldc_query_reply_status(hdr, LDC_STATUS_BAD_REQ, from);
+        return 0;
+    }
+    memcpy(&reply, req, sizeof(reply));
+    reply.hdr.status = LDC_STATUS_OK;
+    reply.service_rx_ns = htobe64(t_rx);
+    reply.realtime_ns = htobe64(ldc_realtime_ns());
+    reply.service_tx_ns = htobe64(ldc_now_ns()); // last: closest to the reply leaving
+    ldc_server_send(sock, &reply, sizeof(reply), from);
+    return 0;
+}
+
+// Build the reply for one request into reply[], returns its length in bytes
+// Requests: [ch] latest value of ch, [0xFF] latest of all channels,
+// [0x80|ch, count] last count values of ch (oldest first). Empty requests read CH0.
+int build_reply(const uint8_t *req, int n, uint32_t *reply, int max_words) {
+    int words = 0;
+    uint8_t code = (n > 0) ? req[0] : 0;
+    uint64_t now = ldc_now_ns();
+    struct ldc_sample sample;
+
+    if (code == REQ_ALL_CHANNELS) {
+        for (int ch = 0; ch < LDC1614_NUM_CHANNELS; ch++) {
+            uint32_t val = 0;
+            if (ldc_ring_latest(&rings[ch], &sample) == 0) {
+                val = sample.value;
+                ldc_metrics_record_age(now, sample.t_ns);
+            }
+            reply[words++] = htonl(val);
+        }
+    } else if ((code & REQ_HISTORY) && (code & 0x7F) < LDC1614_NUM_CHANNELS) {
+        int ch = code & 0x7F;
+        uint64_t count = (n > 1) ? req[1] : 1;
+        uint64_t head = ldc_ring_head(&rings[ch]);
+        if (count > head) count = head;
+        if (count > (uint64_t)max_words) count = max_words;
+        for (uint64_t seq = head - count + 1; seq <= head; seq++) {
+            if (ldc_ring_get(&rings[ch], seq, &sample) == 0) {
+                reply[words++] = htonl(sample.value);
+                ldc_metrics_record_age(now, sample.t_ns);
+            }
+        }
+    } else if (code < LDC1614_NUM_CHANNELS) {
+        uint32_t val = 0;
+        if (ldc_ring_latest(&rings[code], &sample) == 0) {
+            val = sample.value;
+            ldc_metrics_record_age(now, sample.t_ns);
+        }
+        reply[words++] = htonl(val);
+    }
+
+    return words * sizeof(uint32_t);
+}
+
+// Answer one datagram, on whichever server thread received it
+void handle_request(int sock, const uint8_t *req, int n, const struct sockaddr_in *from, uint64_t t_rx) {
+    if (n >= (int)sizeof(struct ldc_msg_hdr) && req[0] == LDC_PROTO_MAGIC) {
+        const struct ldc_msg_hdr *hdr = (const struct ldc_msg_hdr *)req;
+        if (hdr->version != LDC_PROTO_VERSION) {
+            ldc_query_reply_status(hdr, LDC_STATUS_BAD_VER, from);
+        } else if (handle_time(sock, req, n, from, t_rx) != 0 &&
+                   handle_profile(sock, req, n, from) != 0 &&
+                   ldc_stream_handle(req, n, from) != 0 &&
+                   ldc_query_handle(req, n, from) != 0) {
+            ldc_query_reply_status(hdr, LDC_STATUS_BAD_REQ, from);
+        }
+    } else {
+        uint32_t reply[256];
+        ldc_query_count_legacy();
+        // Values go out as 4-byte Big-Endian network integers
+        int reply_len = build_reply(req, n, reply, sizeof(reply) / sizeof(reply[0]));
+        if (reply_len > 0) {
+            ldc_server_send(sock, reply, reply_len, from);
+        }
+    }
+}
+
+// Stop and join the first n polling threads
+void stop_workers(int n) {
+    stop_event = 1;
+    for (int w = 0; w < n; w++) {
+        pthread_join(workers[w].thread, NULL);
+    }
+}
+
+// Close the data-ready sources, logs, buses and shared memory opened so far
+void close_devices(void) {
+    for (int w = 0; w < num_workers; w++) {
+        ldc_event_close(&workers[w].event_src);
+    }
+    for (int d = 0; d < num_devices; d++) {
+        struct device *dev = &devices[d];
+        if (dev->log != NULL) {
+            struct ldc_log_stats log_stats;
+            if (ldc_log_close(dev->log, &log_stats) != 0) {
+                fprintf(stderr, "Failed to write data to log file\n");
+            }
+            dev->logged += log_stats.records;
+            dev->log_dropped += log_stats.dropped;
+            dev->log = NULL;
+        }
+        if (logging) {
+            // Totals of every file, the ones closed by profile switches included
+            printf("Logged %llu samples of device %d, %llu dropped\n", (unsigned long long)dev->logged, d,
+                   (unsigned long long)dev->log_dropped);
+        }
+        if (dev->open) {
+            ldc_bus_close(&dev->bus);
+            dev->open = 0;
+        }
+    }
+    ldc_shm_close(&shm); // readers see the writer gone
+}
+
+void usage(const char *prog) {
+    printf("Usage: %s [-h] [-p port] [-l] [-f logfile] [-c channels] [-C ch,rcount,settle,dividers,drive] [-g chip:line] [-P] [-d bus] [-D bus@addr[:channels]]... [-R prio[,cpu[,serve_cpu]]] [-S profile_file] [-s profile] [-F filter] [-T tank_pF] [-w threads] [-m shm_name]\n", prog);
+}
+
 int main(int argc, char *argv[]) {
     int opt = 0; // option for command line argument parsing
 
     printf("Initializing LDC1614 Sensor Service...\n");
+    ldc_profile_builtin(&profiles);
 
-    while((opt = getopt(argc, argv, "hp:lf:")) != -1) {
+    while((opt = getopt(argc, argv, "hp:lf:c:C:g:Pd:D:R:S:s:F:T:w:m:")) != -1) {
         switch(opt) {
             case 'h':
-                printf("Usage: %s [-h] [-p port] [-l] [-f logfile]\n", argv[0]);
+                usage(argv[0]);
                 printf("  -h : Show this help message\n");
+                printf("  -c : Comma separated channels to acquire, e.g. 0,1,2,3 (default 0)\n");
+                printf("  -C : Per-channel RCOUNT, SETTLECOUNT, CLOCK_DIVIDERS and DRIVE_CURRENT, may be repeated\n");
+                printf("  -g : GPIO chip and line INTB is wired to (default %s:%u)\n", LDC_GPIO_CHIP, LDC_INTB_LINE);
+                printf("  -P : Poll once per conversion period instead of waiting for INTB\n");
+                printf("  -d : LDC1614 bus: i2c-dev adapter, wiringpi, or sim[:options] (default %s);\n"
+                       "       record:<file>:<bus> records a trace, replay:<file>[:fast] plays one back\n", LDC_BUS_DEFAULT);
+                printf("  -D : Acquire an LDC1614 at address 0x2A or 0x2B on a bus (channels default to -c), e.g.\n"
+                       "       /dev/i2c-1@0x2B:0,1; repeat for up to %d devices, one polling thread per bus.\n"
+                       "       Device d's channel n is served as channel %d*d + n\n", LDC_MAX_DEVICES, LDC_DEVICE_CHANNELS);
+                printf("  -R : Real-time mode: SCHED_FIFO priority (default %d), acquisition CPU (default last,\n"
+                       "       further buses on the CPUs below it), serving CPU (default all others); locks memory\n",
+                       LDC_RT_DEFAULT_PRIORITY);
+                printf("  -S : Load sensor profiles from an INI file\n");
+                printf("  -s : Start with a sensor profile instead of the -C settings (built-in: high_res,\n"
+                       "       balanced, fast, max_rate); LDC_OP_PROFILE switches while running\n");
+                printf("  -F : Filter pipeline, e.g. median:5,cic:3:16,biquad:0.05; output is served as\n"
+                       "       channels 4-7 (stages: ma:N cic:M:R iir1:FC biquad:FC[:Q] median:N)\n");
+                printf("  -T : LC tank capacitance in pF, one value or one per channel, for serving inductance\n");
                 return 0;
+            case 'g': {
+                char *colon = strrchr(optarg, ':');
+                if (colon == NULL || (size_t)(colon - optarg) >= sizeof(gpio_chip)) {
+                    fprintf(stderr, "Invalid GPIO line: %s\n", optarg);
+                    return -1;
+                }
+                memcpy(gpio_chip, optarg, colon - optarg);
+                gpio_chip[colon - optarg] = '\0';
+                intb_line = atoi(colon + 1);
+                break;
+            }
+            case 'P':
+                use_intb = 0;
+                break;
+            case 'S':
+                if (ldc_profile_load(&profiles, optarg) != 0) {
+                    return -1;
+                }
+                break;
+            case 's':
+                strncpy(startup_profile, optarg, sizeof(startup_profile) - 1);
+                startup_profile[sizeof(startup_profile) - 1] = '\0'; // Ensure null termination
+                break;
+            case 'R':
+                if (ldc_rt_parse(optarg, &rt_config) != 0) {
+                    fprintf(stderr, "Invalid real-time settings: %s\n", optarg);
+                    return -1;
+                }
+                rt_mode = 1;
+                break;
+            case 'F':
+                if (ldc_filter_parse(&filter, optarg) != 0) {
+                    fprintf(stderr, "Invalid filter: %s\n", optarg);
+                    return -1;
+                }
+                filtering = 1;
+                break;
+            case 'T':
+                if (parse_tank_capacitance(optarg) != 0) {
+                    fprintf(stderr, "Invalid tank capacitance: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            case 'd':
+                strncpy(bus_spec, optarg, sizeof(bus_spec) - 1);
+                bus_spec[sizeof(bus_spec) - 1] = '\0'; // Ensure null termination
+                break;
+            case 'D':
+                if (parse_device(optarg) != 0) {
+                    fprintf(stderr, "Invalid device: %s (at most %d of bus@0x2A or bus@0x2B[:channels])\n",
+                            optarg, LDC_MAX_DEVICES);
+                    return -1;
+                }
+                break;
+            case 'c':
+                if (parse_channels(optarg, &channel_mask) != 0) {
+                    fprintf(stderr, "Invalid channel list: %s\n", optarg);
+                    return -1;
+                }
+                printf("Channel mask set to: 0x%X\n", channel_mask);
+                break;
+            case 'C':
+                if (parse_channel_config(optarg) != 0) {
+                    fprintf(stderr, "Invalid channel configuration: %s\n", optarg);
+                    return -1;
+                }
+                break;
             case 'p':
                 port = atoi(optarg);
                 printf("UDP port set to: %d\n", port);
                 break;
+            case 'm':
+                if (optarg[0] != '/' || strlen(optarg) >= sizeof(shm_name) || strchr(optarg + 1, '/') != NULL) {
+                    fprintf(stderr, "Invalid shared memory name: %s (e.g. /ldc1614)\n", optarg);
+                    return -1;
+                }
+                strcpy(shm_name, optarg);
+                break;
+            case 'w':
+                server_threads = atoi(optarg);
+                if (server_threads < 1 || server_threads > LDC_SERVER_MAX_THREADS) {
+                    fprintf(stderr, "Invalid server thread count: %s (1 to %d)\n", optarg, LDC_SERVER_MAX_THREADS);
+                    return -1;
+                }
+                break;
             case 'l':
                 logging = 1;
                 printf("Logging enabled\n");
@@ -139,99 +772,228 @@ int main(int argc, char *argv[]) {
                 printf("Log file set to: %s\n", logfile);
                 break;
             default:
-                printf("Usage: %s [-h] [-p port] [-l] [-f logfile]\n", argv[0]);
+                usage(argv[0]);
                 return -1; // Exit on invalid option
         }
     }
 
-    // Trap SIGINT (Ctrl+C)
+    // --- Sensor Profile ---
+    if (startup_profile[0] != '\0') {
+        const struct ldc_profile *p = ldc_profile_find(&profiles, startup_profile);
+        if (p == NULL) {
+            fprintf(stderr, "Unknown profile: %s\n", startup_profile);
+            return -1;
+        }
+        memcpy(chan_config, p->channels, sizeof(chan_config));
+        atomic_store(&active_profile, p);
+    } else {
+        // The command line settings, so clients can switch back to them
+        struct ldc_profile startup = { .name = "startup" };
+        memcpy(startup.channels, chan_config, sizeof(startup.channels));
+        const struct ldc_profile *p = ldc_profile_add(&profiles, &startup);
+        if (p == NULL) {
+            fprintf(stderr, "No room for the startup profile: at most %d profiles including the built-in ones\n",
+                    LDC_MAX_PROFILES - 1);
+            return -1;
+        }
+        atomic_store(&active_profile, p);
+    }
+    printf("Sensor profile %s\n", atomic_load(&active_profile)->name);
+    ldc_profile_prepare(&profiles, LDC1614_FREF_HZ, tank_f); // a reserved divider only leaves NaN units
+    ldc_stream_set_convert(&atomic_load(&active_profile)->convert);
+
+    // Trap SIGINT (Ctrl+C), SIGUSR1 dumps the timing metrics
     signal(SIGINT, handle_sigint);
+    signal(SIGUSR1, handle_sigusr1);
+
+    // --- Devices ---
+    if (num_devices == 0) {
+        // The single device of -d and -c
+        memset(&devices[0], 0, sizeof(devices[0]));
+        strcpy(devices[0].bus_spec, bus_spec);
+        devices[0].addr = LDC1614_ADDR;
+        num_devices = 1;
+    }
+    for (int d = 0; d < num_devices; d++) {
+        struct device *dev = &devices[d];
+        int w;
+        for (int e = 0; e < d; e++) {
+            if (strcmp(devices[e].bus_spec, dev->bus_spec) == 0 && devices[e].addr == dev->addr) {
+                fprintf(stderr, "Device %d: 0x%02X on %s is already device %d\n", d, dev->addr, dev->bus_spec, e);
+                return -1;
+            }
+        }
+        if (dev->channel_mask == 0) dev->channel_mask = channel_mask;
+        memcpy(dev->config, chan_config, sizeof(dev->config));
+        if (filtering) {
+            dev->filter = filter;
+            ldc_filter_reset(&dev->filter);
+        }
+        // Chips on the same bus share its polling thread
+        for (w = 0; w < num_workers; w++) {
+            if (strcmp(workers[w].devices[0]->bus_spec, dev->bus_spec) == 0) break;
+        }
+        if (w == num_workers) {
+            memset(&workers[w], 0, sizeof(workers[w]));
+            num_workers++;
+        }
+        workers[w].devices[workers[w].num_devices++] = dev;
+    }
 
-    // --- I2C Setup ---
-    int i2c_fd = open("/dev/i2c-1", O_RDWR);
-    if (i2c_fd < 0) {
-        perror("Failed to open I2C bus");
-        return 1;
+    // --- Bus Setup ---
+    for (int d = 0; d < num_devices; d++) {
+        struct device *dev = &devices[d];
+        if (ldc_bus_open(&dev->bus, dev->bus_spec, dev->addr) != 0) {
+            close_devices();
+            return 1;
+        }
+        dev->open = 1;
+        printf("Device %d: LDC1614 0x%02X on %s bus %s, channels 0x%X served from %d\n", d, dev->addr,
+               dev->bus.name, dev->bus_spec, dev->channel_mask, d * LDC_DEVICE_CHANNELS);
+        if (init_device(dev) != 0) {
+            fprintf(stderr, "Failed to configure LDC1614 %d\n", d);
+            close_devices();
+            return 1;
+        }
+    }
+    // One namespace for every device: rings up to the last device's last served channel
+    int num_rings = (num_devices - 1) * LDC_DEVICE_CHANNELS + (filtering ? LDC_DEVICE_CHANNELS : LDC1614_NUM_CHANNELS);
+    uint32_t served_mask = 0;
+    for (int d = 0; d < num_devices; d++) {
+        uint32_t mask = devices[d].channel_mask | (filtering ? (uint32_t)devices[d].channel_mask << LDC_FILTERED_OFFSET : 0);
+        served_mask |= mask << (d * LDC_DEVICE_CHANNELS);
+    }
+    if (shm_name[0] != '\0') {
+        if (ldc_shm_create(&shm, shm_name, num_rings, served_mask) != 0) {
+            close_devices();
+            return 1;
+        }
+        rings = shm.rings; // initialized by ldc_shm_create
+        printf("Samples shared in %s (%d channels)\n", shm_name, num_rings);
+    } else {
+        for (int ch = 0; ch < num_rings; ch++) {
+            ldc_ring_init(&rings[ch]);
+        }
     }
 
-    if (ioctl(i2c_fd, I2C_SLAVE, LDC1614_ADDR) < 0) {
-        perror("Failed to acquire bus access and/or talk to slave");
-        close(i2c_fd);
-        return 1;
+    // --- Sample Log ---
+    if (logging) {
+        // One file per device, each header describing its chip, all on the same time base
+        uint64_t start_ns = ldc_now_ns();
+        for (int d = 0; d < num_devices; d++) {
+            struct device *dev = &devices[d];
+            char path[sizeof(logfile) + 16];
+            device_log_path(dev, NULL, 0, path, sizeof(path));
+            dev->log_config.start_ns = start_ns;
+            dev->log = ldc_log_open(path, ldc_log_format_for(path), &dev->log_config);
+            if (dev->log == NULL) {
+                close_devices();
+                return 1;
+            }
+            printf("Logging to %s\n", path);
+        }
     }
 
-    init_device(i2c_fd);
+    // --- Data-Ready Sources ---
+    for (int w = 0; w < num_workers; w++) {
+        struct bus_worker *worker = &workers[w];
+        struct device *first = worker->devices[0];
+        // INTB marks one chip's conversions: a bus with several chips is polled
+        int single = (worker->num_devices == 1);
+        if (ldc_bus_is_replay(&first->bus)) {
+            // Waits come from the trace, whatever the recording used
+            ldc_event_open_replay(&worker->event_src, &first->bus);
+        } else if (use_intb && single && ldc_bus_is_sim(&first->bus)) {
+            ldc_event_open_sim(&worker->event_src, &first->bus);
+        } else if (use_intb && single && first->index == 0 &&
+                   ldc_event_open_gpio(&worker->event_src, gpio_chip, intb_line) == 0) {
+            printf("Waiting for INTB on %s line %u\n", gpio_chip, intb_line);
+        } else {
+            // Reading faster than the devices convert would only return the same results again
+            uint64_t period = worker_period_ns(worker);
+            if (use_intb && single && first->index == 0) fprintf(stderr, "INTB unavailable, falling back to polling\n");
+            ldc_event_open_timer(&worker->event_src, period);
+            printf("Polling %s every %.3f ms%s\n", first->bus_spec, period / 1e6,
+                   single ? ", phase-locked to the conversions" : "");
+        }
+        if (ldc_bus_is_recording(&first->bus)) ldc_event_record(&worker->event_src, &first->bus);
+    }
 
-    // --- Start Polling Thread ---
-    pthread_t poll_thread;
-    if (pthread_create(&poll_thread, NULL, polling_worker, &i2c_fd) != 0) {
-        perror("Failed to create polling thread");
-        close(i2c_fd);
-        return 1;
+    // --- Start Polling Threads ---
+    ldc_metrics_init();
+    for (int w = 0; w < num_workers; w++) {
+        workers[w].profile = atomic_load(&active_profile);
     }
+    pthread_t poll_threads[LDC_MAX_DEVICES];
+    if (rt_mode) {
+        // Rings, log queues and every thread stack stay resident from here on
+        rt_config.num_acquire = num_workers;
+        ldc_rt_lock_memory();
+        ldc_rt_pin_serving(&rt_config); // inherited by the streaming thread
+    }
+    for (int w = 0; w < num_workers; w++) {
+        int ret = rt_mode ? ldc_rt_thread_create(&workers[w].thread, &rt_config, w, polling_worker, &workers[w])
+                          : pthread_create(&workers[w].thread, NULL, polling_worker, &workers[w]);
+        if (ret != 0) {
+            if (!rt_mode) perror("Failed to create polling thread");
+            stop_workers(w);
+            close_devices();
+            return 1;
+        }
+        poll_threads[w] = workers[w].thread;
+    }
+    if (rt_mode) ldc_rt_report(stdout, poll_threads, num_workers, &rt_config);
 
     // --- UDP Server Setup ---
-    int udp_sock = socket(AF_INET, SOCK_DGRAM, 0);
-    if (udp_sock < 0) {
-        perror("Failed to create UDP socket");
-        stop_event = 1;
-        pthread_join(poll_thread, NULL);
-        close(i2c_fd);
+    if (ldc_server_open(&server, port, server_threads) != 0) {
+        stop_workers(num_workers);
+        close_devices();
         return 1;
     }
 
-    struct sockaddr_in servaddr;
-    memset(&servaddr, 0, sizeof(servaddr));
-    servaddr.sin_family = AF_INET;
-    servaddr.sin_addr.s_addr = INADDR_ANY;
-    servaddr.sin_port = htons(port);
-
-    if (bind(udp_sock, (const struct sockaddr *)&servaddr, sizeof(servaddr)) < 0) {
-        perror("UDP Bind failed");
+    // --- Start Streaming Thread ---
+    ldc_stream_init(server.socks[0], rings, num_rings);
+    ldc_query_init(server.socks[0], rings, num_rings, served_mask);
+    pthread_t stream_thread;
+    if (pthread_create(&stream_thread, NULL, ldc_stream_worker, (void *)&stop_event) != 0) {
+        perror("Failed to create streaming thread");
+        ldc_server_close(&server);
+        stop_workers(num_workers);
+        close_devices();
+        return 1;
+    }
+    if (ldc_server_start(&server, handle_request) != 0) {
         stop_event = 1;
-        close(udp_sock);
-        pthread_join(poll_thread, NULL);
-        close(i2c_fd);
+        pthread_join(stream_thread, NULL);
+        ldc_server_close(&server);
+        stop_workers(num_workers);
+        close_devices();
         return 1;
     }
 
-    // Set 0.5s receive timeout on the UDP socket to periodically check stop_event
-    struct timeval tv;
-    tv.tv_sec = 0;
-    tv.tv_usec = 500000;
-    setsockopt(udp_sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    printf("UDP Server listening on port %d with %d thread%s...\n", port, server_threads,
+           (server_threads > 1) ? "s" : "");
 
-    printf("UDP Server listening on port %d...\n", port);
+    struct ldc_error_report error_report = { .interval_ns = ERROR_REPORT_NS, .last_ns = ldc_now_ns() };
+    struct pollfd stop_poll = { .fd = server.stop_fd, .events = POLLIN };
 
-    struct sockaddr_in cliaddr;
-    socklen_t len = sizeof(cliaddr);
-    char recv_buffer[1024];
-
-    // --- Main UDP Server Loop ---
+    // --- Housekeeping: requests are answered by the server threads ---
     while (!stop_event) {
-        int n = recvfrom(udp_sock, recv_buffer, sizeof(recv_buffer), 0, 
-                         (struct sockaddr*)&cliaddr, &len);
-        
-        if (n > 0) {
-            // Retrieve thread-safe value
-            pthread_mutex_lock(&value_lock);
-            uint32_t val = current_frequency_value;
-            pthread_mutex_unlock(&value_lock);
-
-            // Pack the 28-bit integer into a 4-byte Big-Endian network integer
-            uint32_t net_val = htonl(val);
-            sendto(udp_sock, &net_val, sizeof(net_val), 0, 
-                   (struct sockaddr*)&cliaddr, len);
-        } else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
-            perror("UDP receive error");
+        if (dump_metrics) {
+            dump_metrics = 0;
+            ldc_metrics_dump(stderr);
         }
+        ldc_errors_report(&ldc_metrics.errors, &error_report, stderr, ldc_now_ns());
+        poll(&stop_poll, 1, HOUSEKEEPING_MS); // SIGINT makes the eventfd readable
     }
 
     // --- Cleanup ---
     printf("\nShutting down service...\n");
-    pthread_join(poll_thread, NULL);
-    close(udp_sock);
-    close(i2c_fd);
+    ldc_server_close(&server);
+    stop_workers(num_workers);
+    pthread_join(stream_thread, NULL);
+    ldc_metrics_dump(stdout);
+    close_devices();
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,61 @@
+// Source file for the sweep settle detector.
+#include "ldc_settle.h"
+#include <math.h>
+#include <string.h>
+
+int ldc_settle_init(struct ldc_settle *s, int window, double max_std, double max_slope) {
+    if (window < 3 || window > LDC_SETTLE_MAX_WINDOW || !(max_std >= 0.0) || !(max_slope >= 0.0)) {
+        return -1;
+    }
+    memset(s, 0, sizeof(*s));
+    s->window = window;
+    s->max_std = max_std;
+    s->max_slope = max_slope;
+    return 0;
+}
+
+void ldc_settle_reset(struct ldc_settle *s) {
+    s->count = 0;
+    s->head = 0;
+    s->sum_y = s->sum_y2 = s->sum_iy = 0;
+}
+
+int ldc_settle_add(struct ldc_settle *s, uint32_t value) {
+    int64_t rank;
+
+    if (s->count == 0) s->ref = value;
+    int64_t v = (int64_t)value - s->ref;
+    if (s->count == s->window) {
+        // Drop the oldest: every other sample moves one rank down
+        int64_t old = s->y[s->head];
+        s->sum_iy -= s->sum_y - old;
+        s->sum_y -= old;
+        s->sum_y2 -= old * old;
+        rank = s->window - 1;
+    } else {
+        rank = s->count++;
+    }
+    s->y[s->head] = v;
+    s->head = (s->head + 1) % s->window;
+    s->sum_y += v;
+    s->sum_y2 += v * v;
+    s->sum_iy += rank * v;
+
+    return s->count == s->window && ldc_settle_std(s) <= s->max_std && fabs(ldc_settle_slope(s)) <= s->max_slope;
+}
+
+double ldc_settle_std(const struct ldc_settle *s) {
+    int n = s->count;
+    if (n < 2) return 0.0;
+    double var = ((double)s->sum_y2 - (double)s->sum_y * s->sum_y / n) / (n - 1);
+    return (var > 0.0) ? sqrt(var) : 0.0;
+}
+
+double ldc_settle_slope(const struct ldc_settle *s) {
+    int64_t n = s->count;
+    if (n < 2) return 0.0;
+    // Ranks 0..n-1: sum n(n-1)/2, and n*sum(i^2) - sum(i)^2 = n^2(n^2-1)/12
+    double num = (double)(n * s->sum_iy) - (double)(n * (n - 1) / 2) * s->sum_y;
+    double den = (double)(n * n * (n * n - 1)) / 12.0;
+    return num / den;
+}
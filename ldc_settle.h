@@ -0,0 +1,54 @@
+/*
+ * ldc_settle.h
+ *
+ * Online settle detection for the ldc_test sweep (-S).
+ *
+ * After each command step the samples go through a sliding window. The
+ * signal counts as settled once the window is full, its standard deviation
+ * is at most max_std and the least-squares slope through it is at most
+ * max_slope in magnitude. Samples are kept as offsets from the first one
+ * after a reset, so the window sums are exact 64-bit integers that are
+ * updated in O(1) per sample without drift.
+ */
+
+#ifndef INC_LDC_SETTLE_H_
+#define INC_LDC_SETTLE_H_
+
+#include <stdint.h>
+
+#define LDC_SETTLE_MAX_WINDOW 64 // keeps the sum of squares of 28-bit offsets within int64
+
+struct ldc_settle {
+    int window;         // samples in the window
+    double max_std;     // counts
+    double max_slope;   // counts per sample
+    int count;          // samples in the window so far
+    int head;           // next slot of y
+    uint32_t ref;       // first sample since the reset
+    int64_t y[LDC_SETTLE_MAX_WINDOW];
+    int64_t sum_y, sum_y2, sum_iy; // sum_iy weights each sample by its age rank, oldest 0
+};
+
+/**
+ * @brief Set the window and thresholds and reset the detector.
+ * @param window samples, 3 to LDC_SETTLE_MAX_WINDOW
+ * @return 0 on success, -1 if window or a threshold is out of range
+ */
+int ldc_settle_init(struct ldc_settle *s, int window, double max_std, double max_slope);
+
+// Forget the samples, e.g. after a new command
+void ldc_settle_reset(struct ldc_settle *s);
+
+/**
+ * @brief Add one sample.
+ * @return 1 if the window now meets both thresholds, 0 otherwise
+ */
+int ldc_settle_add(struct ldc_settle *s, uint32_t value);
+
+// Standard deviation of the window in counts (0 with fewer than 2 samples)
+double ldc_settle_std(const struct ldc_settle *s);
+
+// Least-squares slope of the window in counts per sample (0 with fewer than 2 samples)
+double ldc_settle_slope(const struct ldc_settle *s);
+
+#endif /* INC_LDC_SETTLE_H_ */
@@ -0,0 +1,165 @@
+// Source file for the shared-memory sample store.
+#include "ldc_shm.h"
+#include "ldc_time.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+// Shared between processes: no FUTEX_PRIVATE_FLAG
+static long futex(_Atomic uint32_t *word, int op, uint32_t val, const struct timespec *timeout) {
+    return syscall(SYS_futex, (uint32_t *)word, op, val, timeout, NULL, 0);
+}
+
+static void set_name(struct ldc_shm *shm, const char *name) {
+    strncpy(shm->name, name, sizeof(shm->name) - 1);
+    shm->name[sizeof(shm->name) - 1] = '\0';
+}
+
+int ldc_shm_create(struct ldc_shm *shm, const char *name, int num_rings, uint32_t channel_mask) {
+    memset(shm, 0, sizeof(*shm));
+    set_name(shm, name);
+    shm->size = LDC_SHM_RINGS_OFFSET + (size_t)num_rings * sizeof(struct ldc_ring);
+
+    shm_unlink(shm->name); // a crashed writer's segment
+    int fd = shm_open(shm->name, O_RDWR | O_CREAT | O_EXCL, 0660);
+    if (fd < 0) {
+        perror("Failed to create shared memory");
+        return -1;
+    }
+    if (ftruncate(fd, shm->size) != 0) {
+        perror("Failed to size shared memory");
+        close(fd);
+        shm_unlink(shm->name);
+        return -1;
+    }
+    void *base = mmap(NULL, shm->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("Failed to map shared memory");
+        shm_unlink(shm->name);
+        return -1;
+    }
+    shm->hdr = base;
+    shm->rings = (struct ldc_ring *)((uint8_t *)base + LDC_SHM_RINGS_OFFSET);
+    shm->owner = 1;
+    for (int ch = 0; ch < num_rings; ch++) {
+        ldc_ring_init(&shm->rings[ch]);
+    }
+
+    struct ldc_shm_header *hdr = shm->hdr;
+    hdr->version = LDC_SHM_VERSION;
+    hdr->ring_capacity = LDC_RING_CAPACITY;
+    hdr->ring_size = sizeof(struct ldc_ring);
+    hdr->num_rings = num_rings;
+    hdr->channel_mask = channel_mask;
+    hdr->pid = getpid();
+    hdr->start_ns = ldc_now_ns();
+    atomic_store(&hdr->alive, 1);
+    atomic_thread_fence(memory_order_release);
+    hdr->magic = LDC_SHM_MAGIC; // last: a reader that sees it sees a complete header
+    return 0;
+}
+
+void ldc_shm_notify(struct ldc_shm *shm) {
+    // Pairs with ldc_shm_wait(): either the reader is counted here or FUTEX_WAIT sees the new value
+    atomic_fetch_add(&shm->hdr->futex, 1);
+    if (atomic_load(&shm->hdr->waiters) != 0) {
+        futex(&shm->hdr->futex, FUTEX_WAKE, INT_MAX, NULL);
+    }
+}
+
+int ldc_shm_open(struct ldc_shm *shm, const char *name) {
+    struct stat st;
+
+    memset(shm, 0, sizeof(*shm));
+    set_name(shm, name);
+    int fd = shm_open(shm->name, O_RDWR, 0);
+    if (fd < 0) {
+        perror("Failed to open shared memory");
+        return -1;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size < LDC_SHM_RINGS_OFFSET) {
+        fprintf(stderr, "Shared memory %s is not an LDC1614 sample store\n", shm->name);
+        close(fd);
+        return -1;
+    }
+    void *base = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("Failed to map shared memory");
+        return -1;
+    }
+    shm->hdr = base;
+    shm->size = st.st_size;
+
+    const struct ldc_shm_header *hdr = shm->hdr;
+    if (hdr->magic != LDC_SHM_MAGIC || hdr->version != LDC_SHM_VERSION ||
+        hdr->ring_capacity != LDC_RING_CAPACITY || hdr->ring_size != sizeof(struct ldc_ring) ||
+        LDC_SHM_RINGS_OFFSET + (size_t)hdr->num_rings * sizeof(struct ldc_ring) > shm->size) {
+        fprintf(stderr, "Shared memory %s has an incompatible layout\n", shm->name);
+        munmap(base, shm->size);
+        shm->hdr = NULL;
+        return -1;
+    }
+    atomic_thread_fence(memory_order_acquire);
+    shm->rings = (struct ldc_ring *)((uint8_t *)base + LDC_SHM_RINGS_OFFSET);
+    return 0;
+}
+
+void ldc_shm_close(struct ldc_shm *shm) {
+    if (shm->hdr == NULL) return;
+    if (shm->owner) {
+        atomic_store(&shm->hdr->alive, 0);
+        ldc_shm_notify(shm);
+        shm_unlink(shm->name);
+    }
+    munmap(shm->hdr, shm->size);
+    shm->hdr = NULL;
+    shm->rings = NULL;
+}
+
+const struct ldc_ring *ldc_shm_ring(const struct ldc_shm *shm, int ch) {
+    if (ch < 0 || ch >= (int)shm->hdr->num_rings || ch >= 32 || !(shm->hdr->channel_mask & (1u << ch))) {
+        return NULL;
+    }
+    return &shm->rings[ch];
+}
+
+int ldc_shm_wait(struct ldc_shm *shm, uint32_t *seen, int timeout_ms) {
+    struct ldc_shm_header *hdr = shm->hdr;
+    uint64_t deadline = (timeout_ms >= 0) ? ldc_now_ns() + (uint64_t)timeout_ms * 1000000 : 0;
+
+    for (;;) {
+        uint32_t now = atomic_load(&hdr->futex);
+        if (now != *seen) {
+            *seen = now;
+            return 1;
+        }
+        if (!atomic_load(&hdr->alive)) return -1;
+
+        struct timespec ts, *timeout = NULL;
+        if (timeout_ms >= 0) {
+            uint64_t t = ldc_now_ns();
+            if (t >= deadline) return 0;
+            ts.tv_sec = (deadline - t) / 1000000000;
+            ts.tv_nsec = (deadline - t) % 1000000000;
+            timeout = &ts;
+        }
+        atomic_fetch_add(&hdr->waiters, 1);
+        long ret = futex(&hdr->futex, FUTEX_WAIT, now, timeout);
+        int err = errno;
+        atomic_fetch_sub(&hdr->waiters, 1);
+        if (ret != 0 && err != EAGAIN && err != EINTR && err != ETIMEDOUT) {
+            perror("futex wait failed");
+            return -1;
+        }
+    }
+}
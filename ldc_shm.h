@@ -0,0 +1,96 @@
+/*
+ * ldc_shm.h
+ *
+ * Sample store of ldc_service in POSIX shared memory, for readers on the
+ * same host.
+ *
+ * The segment is a header followed by the service's sample rings, the same
+ * struct ldc_ring the UDP handlers read. Readers map it and use the
+ * ldc_ring_* functions directly: the per-slot sequence check detects a
+ * sample overwritten mid-copy, so reading the latest value or a range of
+ * history costs no system call. To block for new data a reader waits on
+ * the header's futex word, which the polling threads bump after every
+ * wakeup; they only enter the kernel to wake it while a reader is waiting.
+ *
+ * Readers map the segment read-write because waiting registers in the
+ * header; they must never write to the rings.
+ */
+
+#ifndef INC_LDC_SHM_H_
+#define INC_LDC_SHM_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "ldc_ring.h"
+
+#define LDC_SHM_MAGIC       0x4C445348 // "LDSH"
+#define LDC_SHM_VERSION     1
+#define LDC_SHM_RINGS_OFFSET 4096      // rings start on their own page
+#define LDC_SHM_NAME_LEN    64
+
+struct ldc_shm_header {
+    uint32_t magic;             // LDC_SHM_MAGIC
+    uint32_t version;           // LDC_SHM_VERSION
+    uint32_t ring_capacity;     // LDC_RING_CAPACITY of the writer
+    uint32_t ring_size;         // sizeof(struct ldc_ring) of the writer
+    uint32_t num_rings;         // rings following the header, indexed by channel number
+    uint32_t channel_mask;      // channels being published
+    uint32_t pid;               // of the writer
+    uint32_t reserved;
+    uint64_t start_ns;          // CLOCK_MONOTONIC time the segment was created
+    _Atomic uint32_t alive;     // 1 while the writer runs, 0 once it has exited
+    _Atomic uint32_t waiters;   // readers blocked in ldc_shm_wait()
+    _Atomic uint32_t futex;     // bumped after each batch of publishes
+};
+
+// A mapped segment, writer or reader side
+struct ldc_shm {
+    struct ldc_shm_header *hdr;
+    struct ldc_ring *rings;     // hdr->num_rings of them
+    size_t size;
+    int owner;                  // created it: unlinked on close
+    char name[LDC_SHM_NAME_LEN];
+};
+
+/**
+ * @brief Create the segment and initialize its rings (writer). A segment left
+ * behind by a writer that died is replaced; readers still mapping it keep the old one.
+ * @param name POSIX shared memory name, e.g. "/ldc1614"
+ * @param num_rings rings to allocate
+ * @param channel_mask channels that will be published
+ * @return 0 on success, -1 on failure (reported with perror)
+ */
+int ldc_shm_create(struct ldc_shm *shm, const char *name, int num_rings, uint32_t channel_mask);
+
+// Wake the readers waiting for new samples (writer, after publishing)
+void ldc_shm_notify(struct ldc_shm *shm);
+
+/**
+ * @brief Map an existing segment (reader).
+ * @return 0 on success, -1 if it does not exist or was made by an incompatible writer
+ */
+int ldc_shm_open(struct ldc_shm *shm, const char *name);
+
+// Unmap; the writer also marks the segment dead, wakes the readers and unlinks it
+void ldc_shm_close(struct ldc_shm *shm);
+
+// Ring of channel ch, NULL if the writer does not publish it
+const struct ldc_ring *ldc_shm_ring(const struct ldc_shm *shm, int ch);
+
+/**
+ * @brief Wait until the writer has published since *seen, or timeout_ms passed.
+ * Start with *seen = ldc_shm_generation(); no wakeup is lost between reading
+ * the rings and calling this.
+ * @param seen in: generation already handled, out: the current generation
+ * @param timeout_ms -1 waits forever
+ * @return 1 if there is something new, 0 on a timeout, -1 once the writer has exited
+ */
+int ldc_shm_wait(struct ldc_shm *shm, uint32_t *seen, int timeout_ms);
+
+// Current generation for ldc_shm_wait()
+static inline uint32_t ldc_shm_generation(const struct ldc_shm *shm) {
+    return atomic_load_explicit(&shm->hdr->futex, memory_order_acquire);
+}
+
+#endif /* INC_LDC_SHM_H_ */
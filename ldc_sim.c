@@ -0,0 +1,411 @@
+// Source file for the simulated LDC1614.
+#include "ldc_sim.h"
+#include "ldc_time.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+
+#define NUM_REGS          0x80
+#define MAX_CATCHUP_NS    10000000ULL // after a longer gap, skip whole sequences instead of converting them all
+#define STATUS_ERR_MASK   0xFF00      // ERR_CHAN and error flags, cleared by reading STATUS
+
+struct ldc_sim {
+    struct ldc_sim_config config;
+    uint16_t regs[NUM_REGS];
+    uint16_t lsb_latch[LDC1614_NUM_CHANNELS]; // DATAx_LSB captured by the MSB read
+    uint64_t virt_ns;        // virtual clock
+    uint64_t start_ns;       // waveform t = 0
+    uint64_t rng;            // xorshift state for the noise
+
+    // Sequencer
+    int running;
+    int seq[LDC1614_NUM_CHANNELS]; // channels converted in order
+    int seq_len;
+    int pos;                 // index in seq of the conversion in progress
+    uint64_t step_ns[LDC1614_NUM_CHANNELS]; // duration of each conversion step
+    uint64_t seq_ns;         // one full sequence
+    uint64_t next_done_ns;   // completion time of the conversion in progress
+
+    uint64_t drdy_ns;        // time of the latest DRDY
+    uint64_t drdy_count;     // DRDYs raised so far
+    uint64_t drdy_reported;  // DRDYs already returned by the INTB event source
+    uint64_t conversions;
+};
+
+static const uint16_t reset_values[NUM_REGS] = {
+    [LDC1614_RCOUNT0] = 0x0080, [LDC1614_RCOUNT1] = 0x0080,
+    [LDC1614_RCOUNT2] = 0x0080, [LDC1614_RCOUNT3] = 0x0080,
+    [LDC1614_CONFIG] = 0x2801,
+    [LDC1614_MUX_CONFIG] = 0x020F,
+    [LDC1614_MANUFACTURER_ID] = LDC1614_MANUFACTURER_ID_VALUE,
+    [LDC1614_DEVICE_ID] = LDC1614_DEVICE_ID_VALUE,
+};
+
+void ldc_sim_default_config(struct ldc_sim_config *config) {
+    memset(config, 0, sizeof(*config));
+    config->fclk_hz = LDC_SIM_FCLK_HZ;
+    config->bus_hz = LDC_SIM_BUS_HZ;
+    config->seed = 0x9E3779B97F4A7C15ULL;
+    for (int ch = 0; ch < LDC1614_NUM_CHANNELS; ch++) {
+        config->channels[ch].wave = LDC_SIM_SINE;
+        config->channels[ch].center_hz = 3e6;
+        config->channels[ch].amplitude_hz = 1e4;
+        config->channels[ch].wave_hz = 1.0;
+        config->channels[ch].noise_hz = 20.0;
+    }
+}
+
+int ldc_sim_parse(struct ldc_sim_config *config, const char *opts) {
+    char buf[256];
+    char *save = NULL;
+
+    if (strlen(opts) >= sizeof(buf)) return -1;
+    strcpy(buf, opts);
+    for (char *tok = strtok_r(buf, ",", &save); tok != NULL; tok = strtok_r(NULL, ",", &save)) {
+        char *eq = strchr(tok, '=');
+        double val = (eq != NULL) ? strtod(eq + 1, NULL) : 0.0;
+        if (eq != NULL) *eq = '\0';
+
+        if (strcmp(tok, "virtual") == 0) {
+            config->virtual_clock = 1;
+        } else if (strcmp(tok, "clk") == 0 && eq != NULL) {
+            config->fclk_hz = (uint32_t)val;
+        } else if (strcmp(tok, "bus") == 0 && eq != NULL) {
+            config->bus_hz = (uint32_t)val;
+        } else if (strcmp(tok, "seed") == 0 && eq != NULL) {
+            config->seed = strtoull(eq + 1, NULL, 0);
+        } else {
+            for (int ch = 0; ch < LDC1614_NUM_CHANNELS; ch++) {
+                struct ldc_sim_channel *c = &config->channels[ch];
+                if (strcmp(tok, "const") == 0) c->wave = LDC_SIM_CONST;
+                else if (strcmp(tok, "sine") == 0) c->wave = LDC_SIM_SINE;
+                else if (strcmp(tok, "square") == 0) c->wave = LDC_SIM_SQUARE;
+                else if (strcmp(tok, "ramp") == 0) c->wave = LDC_SIM_RAMP;
+                else if (strcmp(tok, "f") == 0 && eq != NULL) c->center_hz = val;
+                else if (strcmp(tok, "a") == 0 && eq != NULL) c->amplitude_hz = val;
+                else if (strcmp(tok, "hz") == 0 && eq != NULL) c->wave_hz = val;
+                else if (strcmp(tok, "n") == 0 && eq != NULL) c->noise_hz = val;
+                else if (strcmp(tok, "open") == 0 && eq != NULL) c->open = ((int)val >> ch) & 1;
+                else return -1;
+            }
+        }
+    }
+    if (config->fclk_hz == 0 || config->bus_hz == 0) return -1;
+    return 0;
+}
+
+static uint64_t sim_now(struct ldc_sim *sim) {
+    return sim->config.virtual_clock ? sim->virt_ns : ldc_now_ns();
+}
+
+// Roughly gaussian noise with unit variance: scaled sum of four uniforms
+static double sim_noise(struct ldc_sim *sim) {
+    double sum = 0.0;
+    for (int i = 0; i < 4; i++) {
+        sim->rng ^= sim->rng << 13;
+        sim->rng ^= sim->rng >> 7;
+        sim->rng ^= sim->rng << 17;
+        sum += (double)(sim->rng >> 11) * (2.0 / 9007199254740992.0) - 1.0;
+    }
+    return sum * 0.8660254037844386; // sqrt(3/4)
+}
+
+static double sensor_hz(struct ldc_sim *sim, int ch, uint64_t t_ns) {
+    const struct ldc_sim_channel *c = &sim->config.channels[ch];
+    double phase = (double)(t_ns - sim->start_ns) * 1e-9 * c->wave_hz + 0.25 * ch;
+    double frac = phase - floor(phase);
+    double f = c->center_hz;
+
+    switch (c->wave) {
+        case LDC_SIM_SINE:   f += c->amplitude_hz * sin(2.0 * M_PI * frac); break;
+        case LDC_SIM_SQUARE: f += (frac < 0.5) ? c->amplitude_hz : -c->amplitude_hz; break;
+        case LDC_SIM_RAMP:   f += c->amplitude_hz * (2.0 * frac - 1.0); break;
+        case LDC_SIM_CONST:  break;
+    }
+    if (c->noise_hz > 0.0) f += c->noise_hz * sim_noise(sim);
+    return f;
+}
+
+static double fref_hz(struct ldc_sim *sim, int ch) {
+    uint16_t div = LDC1614_FREF_DIVIDER(sim->regs[LDC1614_CLOCK_DIVIDERS(ch)]);
+    return (double)sim->config.fclk_hz / (div ? div : 1);
+}
+
+// Latch one finished conversion into DATAx and STATUS
+static void complete_conversion(struct ldc_sim *sim, int ch, uint64_t t_ns) {
+    uint16_t err_cfg = sim->regs[LDC1614_ERROR_CONFIG];
+    uint16_t fin = LDC1614_FIN_DIVIDER(sim->regs[LDC1614_CLOCK_DIVIDERS(ch)]);
+    uint16_t data_err = 0;   // DATAx_MSB bits 15:12 (UR/OR/WD/AE)
+    uint16_t status_err = 0; // STATUS error flags enabled in ERROR_CONFIG
+    uint32_t code = 0;
+
+    if (sim->config.channels[ch].open) {
+        data_err |= 0x2; // WD
+        if (err_cfg & (LDC1614_WD_ERR2OUT)) status_err |= LDC1614_STATUS_ERR_WD;
+    } else {
+        double f = sensor_hz(sim, ch, t_ns);
+        double c = f / (fin ? fin : 1) / fref_hz(sim, ch) * 268435456.0; // 2^28
+        if (c >= 268435455.0) {
+            code = 0x0FFFFFFF;
+            data_err |= 0x4; // OR
+            if (err_cfg & (LDC1614_OR_ERR2OUT)) status_err |= LDC1614_STATUS_ERR_OR;
+        } else if (c < 1.0) {
+            data_err |= 0x8; // UR
+            if (err_cfg & (LDC1614_UR_ERR2OUT)) status_err |= LDC1614_STATUS_ERR_UR;
+        } else {
+            code = (uint32_t)c;
+        }
+    }
+    // No drive current set: the oscillation amplitude is too low
+    if (LDC1614_IDRIVE(sim->regs[LDC1614_DRIVE_CURRENT(ch)]) == 0) {
+        data_err |= 0x1; // AE
+        if (err_cfg & (LDC1614_AL_ERR2OUT)) status_err |= LDC1614_STATUS_ERR_ALE;
+    }
+
+    sim->regs[LDC1614_DATA_MSB(ch)] = (uint16_t)((data_err << 12) | ((code >> 16) & 0x0FFF));
+    sim->regs[LDC1614_DATA_LSB(ch)] = (uint16_t)(code & 0xFFFF);
+    sim->regs[LDC1614_STATUS] |= LDC1614_UNREADCONV(ch);
+    if (status_err) {
+        sim->regs[LDC1614_STATUS] = (sim->regs[LDC1614_STATUS] & ~STATUS_ERR_MASK) |
+                                    LDC1614_STATUS_ERR_CHAN(ch) | status_err;
+    }
+    sim->conversions++;
+}
+
+// Build the conversion sequence from CONFIG/MUX_CONFIG and start it at t_ns
+static void sequencer_start(struct ldc_sim *sim, uint64_t t_ns) {
+    uint16_t mux = sim->regs[LDC1614_MUX_CONFIG];
+    uint16_t config = sim->regs[LDC1614_CONFIG];
+    int autoscan = (mux & LDC1614_MUX_AUTOSCAN_EN) != 0;
+
+    if (autoscan) {
+        int rr_seq = (mux >> 13) & 0x3;
+        sim->seq_len = (rr_seq == 3) ? 2 : rr_seq + 2; // CH0..CH1, CH0..CH2, CH0..CH3
+    } else {
+        sim->seq_len = 1;
+    }
+    sim->seq_ns = 0;
+    for (int i = 0; i < sim->seq_len; i++) {
+        int ch = autoscan ? i : (config >> 14) & 0x3;
+        double fref = fref_hz(sim, ch);
+        uint16_t settle = sim->regs[LDC1614_SETTLECOUNT(ch)];
+        double t_conv = (sim->regs[LDC1614_RCOUNT(ch)] * 16.0 + 4.0) / fref;
+        double t_settle = ((settle <= 1) ? 32.0 : settle * 16.0) / fref;
+        double t_switch = LDC1614_SWITCH_DELAY_NS * 1e-9 + 5.0 / fref;
+
+        sim->seq[i] = ch;
+        // A single channel converts back to back; autoscan switches and settles before each channel
+        sim->step_ns[i] = (uint64_t)((autoscan ? t_switch + t_settle + t_conv : t_conv) * 1e9);
+        if (sim->step_ns[i] == 0) sim->step_ns[i] = 1;
+        sim->seq_ns += sim->step_ns[i];
+        if (!autoscan) t_ns += (uint64_t)(t_settle * 1e9); // first conversion settles once
+    }
+    sim->pos = 0;
+    sim->next_done_ns = t_ns + sim->step_ns[0];
+    sim->running = 1;
+}
+
+// Run the sequencer up to now
+static void sim_advance(struct ldc_sim *sim, uint64_t now) {
+    if (!sim->running || now < sim->next_done_ns) return;
+
+    // Results are overwritten anyway, so a long gap only needs its last sequence
+    uint64_t behind = now - sim->next_done_ns;
+    if (behind > MAX_CATCHUP_NS && behind / sim->seq_ns > 1) {
+        sim->next_done_ns += (behind / sim->seq_ns - 1) * sim->seq_ns;
+    }
+    while (sim->next_done_ns <= now) {
+        complete_conversion(sim, sim->seq[sim->pos], sim->next_done_ns);
+        if (sim->pos == sim->seq_len - 1) {
+            // DRDY (and INTB) once the whole sequence is done
+            sim->regs[LDC1614_STATUS] |= LDC1614_DATA_READY;
+            sim->drdy_ns = sim->next_done_ns;
+            sim->drdy_count++;
+        }
+        sim->pos = (sim->pos + 1) % sim->seq_len;
+        sim->next_done_ns += sim->step_ns[sim->pos];
+    }
+}
+
+// Time the sequence in progress raises DRDY
+static uint64_t next_drdy_ns(const struct ldc_sim *sim) {
+    uint64_t t = sim->next_done_ns;
+    for (int i = sim->pos + 1; i < sim->seq_len; i++) {
+        t += sim->step_ns[i];
+    }
+    return t;
+}
+
+static uint16_t read_reg(struct ldc_sim *sim, uint8_t reg) {
+    if (reg >= NUM_REGS) return 0;
+    uint16_t value = sim->regs[reg];
+
+    if (reg == LDC1614_STATUS) {
+        sim->regs[reg] &= ~(STATUS_ERR_MASK | LDC1614_DATA_READY);
+    } else if (reg <= LDC1614_DATA3_LSB) {
+        int ch = reg / 2;
+        if ((reg & 1) == 0) {
+            sim->lsb_latch[ch] = sim->regs[LDC1614_DATA_LSB(ch)];
+            sim->regs[LDC1614_STATUS] &= ~LDC1614_UNREADCONV(ch);
+        } else {
+            value = sim->lsb_latch[ch];
+        }
+    }
+    return value;
+}
+
+static void reset_device(struct ldc_sim *sim) {
+    memcpy(sim->regs, reset_values, sizeof(sim->regs));
+    memset(sim->lsb_latch, 0, sizeof(sim->lsb_latch));
+    sim->running = 0;
+}
+
+static void write_reg(struct ldc_sim *sim, uint8_t reg, uint16_t value, uint64_t now) {
+    if (reg >= NUM_REGS || reg <= LDC1614_DATA3_LSB || reg == LDC1614_STATUS ||
+        reg == LDC1614_MANUFACTURER_ID || reg == LDC1614_DEVICE_ID) {
+        return; // read-only
+    }
+    if (reg == LDC1614_RESET_DEV) {
+        if (value & LDC1614_RESET_DEV_BIT) reset_device(sim);
+        return;
+    }
+    sim->regs[reg] = value;
+    if (reg == LDC1614_CONFIG && (value & LDC1614_CONFIG_SLEEP_MODE_EN)) {
+        sim->running = 0;
+    } else if (reg == LDC1614_CONFIG || sim->running) {
+        // Waking up, or reconfigured while active (not allowed on the device): restart the sequence
+        sequencer_start(sim, now);
+    }
+}
+
+// Virtual time a transfer of len bytes occupies the bus: 9 clocks per byte
+static void charge_bus(struct ldc_sim *sim, uint32_t len) {
+    if (sim->config.virtual_clock) {
+        sim->virt_ns += (uint64_t)len * 9 * NS_PER_SEC / sim->config.bus_hz;
+    }
+}
+
+static int sim_read(struct ldc_bus *bus, const struct ldc_bus_xfer *xfers, int n) {
+    struct ldc_sim *sim = bus->ctx;
+    uint32_t bytes = 0;
+
+    for (int i = 0; i < n; i++) {
+        bytes += 3 + xfers[i].len; // address + register, address + data
+    }
+    charge_bus(sim, bytes);
+    sim_advance(sim, sim_now(sim));
+
+    for (int i = 0; i < n; i++) {
+        uint8_t reg = xfers[i].reg;
+        for (uint16_t j = 0; j < xfers[i].len; j += 2) {
+            uint16_t value = read_reg(sim, reg++); // register address auto-increments
+            xfers[i].buf[j] = value >> 8;
+            if (j + 1 < xfers[i].len) xfers[i].buf[j + 1] = value & 0xFF;
+        }
+    }
+    return 0;
+}
+
+static int sim_write(struct ldc_bus *bus, uint8_t reg, uint16_t value) {
+    struct ldc_sim *sim = bus->ctx;
+
+    charge_bus(sim, 4);
+    uint64_t now = sim_now(sim);
+    sim_advance(sim, now);
+    write_reg(sim, reg, value, now);
+    return 0;
+}
+
+static void sim_close(struct ldc_bus *bus) {
+    free(bus->ctx);
+    bus->ctx = NULL;
+}
+
+int ldc_bus_open_sim(struct ldc_bus *bus, const struct ldc_sim_config *config, uint8_t addr) {
+    memset(bus, 0, sizeof(*bus));
+    bus->fd = -1;
+
+    struct ldc_sim *sim = calloc(1, sizeof(*sim));
+    if (sim == NULL) {
+        fprintf(stderr, "Failed to allocate simulated device\n");
+        return -1;
+    }
+    sim->config = *config;
+    sim->rng = config->seed ? config->seed : 1;
+    sim->virt_ns = ldc_now_ns(); // virtual time starts at the real time, then runs ahead
+    sim->start_ns = sim->virt_ns;
+    reset_device(sim);
+
+    bus->read = sim_read;
+    bus->write = sim_write;
+    bus->close = sim_close;
+    bus->name = config->virtual_clock ? "sim (virtual clock)" : "sim";
+    bus->addr = addr;
+    bus->ctx = sim;
+    return 0;
+}
+
+int ldc_bus_is_sim(const struct ldc_bus *bus) {
+    return bus->read == sim_read;
+}
+
+uint64_t ldc_sim_now_ns(struct ldc_bus *bus) {
+    return sim_now(bus->ctx);
+}
+
+uint64_t ldc_sim_conversions(const struct ldc_bus *bus) {
+    const struct ldc_sim *sim = bus->ctx;
+    return sim->conversions;
+}
+
+static int sim_event_wait(struct ldc_event_source *src, int timeout_ms, uint64_t *t_ns) {
+    struct ldc_bus *bus = src->ctx;
+    struct ldc_sim *sim = bus->ctx;
+    uint64_t now = sim_now(sim);
+
+    sim_advance(sim, now);
+    // Like a GPIO edge queue, DRDYs raised while the caller was busy collapse into one event
+    if (sim->drdy_count == sim->drdy_reported && sim->running) {
+        uint64_t ready = next_drdy_ns(sim);
+        if (sim->config.virtual_clock) {
+            sim->virt_ns = ready;
+        } else {
+            uint64_t deadline = now + (uint64_t)timeout_ms * 1000000ULL;
+            struct timespec ts = ldc_ns_to_timespec(ready < deadline ? ready : deadline);
+            int ret = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+            if (ret != 0) return (ret == EINTR) ? 0 : -1;
+            if (ready >= deadline) return 0;
+        }
+        sim_advance(sim, ready);
+    }
+    if (sim->drdy_count == sim->drdy_reported) {
+        // Asleep: nothing will convert until CONFIG is written
+        if (!sim->config.virtual_clock) {
+            struct timespec ts = { timeout_ms / 1000, (timeout_ms % 1000) * 1000000L };
+            nanosleep(&ts, NULL);
+        }
+        return 0;
+    }
+    src->overruns += sim->drdy_count - sim->drdy_reported - 1;
+    sim->drdy_reported = sim->drdy_count;
+    *t_ns = sim->drdy_ns;
+    return 1;
+}
+
+int ldc_event_open_sim(struct ldc_event_source *src, struct ldc_bus *bus) {
+    memset(src, 0, sizeof(*src));
+    src->fd = -1;
+    if (!ldc_bus_is_sim(bus)) {
+        fprintf(stderr, "%s bus has no simulated INTB\n", bus->name);
+        return -1;
+    }
+    src->wait = sim_event_wait;
+    src->name = "simulated INTB";
+    src->ctx = bus;
+    ((struct ldc_sim *)bus->ctx)->drdy_reported = ((struct ldc_sim *)bus->ctx)->drdy_count;
+    return 0;
+}
@@ -0,0 +1,90 @@
+/*
+ * ldc_sim.h
+ *
+ * Simulated LDC1614 behind the ldc_bus interface.
+ *
+ * The simulator keeps the full register file and runs the conversion
+ * sequencer selected by CONFIG/MUX_CONFIG: conversion and settling times
+ * follow RCOUNT, SETTLECOUNT and the reference divider, results are derived
+ * from a configurable sensor waveform through FIN_DIVIDER, and STATUS
+ * carries UNREADCONV, DRDY and the error flags enabled in ERROR_CONFIG.
+ * Register side effects match the device: reading STATUS clears DRDY and the
+ * error flags, reading DATAx_MSB latches DATAx_LSB and clears UNREADCONVx.
+ *
+ * Time is either CLOCK_MONOTONIC (behaves like a device on the bench) or a
+ * virtual clock that only advances by the modelled bus transfer time and by
+ * waits on the simulated INTB, so the acquisition path runs as fast as the
+ * host allows while seeing a consistent device timeline.
+ */
+
+#ifndef INC_LDC_SIM_H_
+#define INC_LDC_SIM_H_
+
+#include <stdint.h>
+#include "ldc1614.h"
+#include "ldc_bus.h"
+#include "ldc_event.h"
+
+#define LDC_SIM_FCLK_HZ   LDC1614_FREF_HZ
+#define LDC_SIM_BUS_HZ    400000   // SCL rate charged to the virtual clock
+
+enum ldc_sim_wave {
+    LDC_SIM_CONST,
+    LDC_SIM_SINE,
+    LDC_SIM_SQUARE,
+    LDC_SIM_RAMP,    // sawtooth from -amplitude to +amplitude
+};
+
+// Sensor oscillation frequency seen by one channel
+struct ldc_sim_channel {
+    enum ldc_sim_wave wave;
+    double center_hz;      // frequency at rest
+    double amplitude_hz;   // peak deviation
+    double wave_hz;        // waveform repetition rate
+    double noise_hz;       // rms white noise added to every conversion
+    int open;              // 1: no sensor attached, conversions report a watchdog error
+};
+
+struct ldc_sim_config {
+    uint32_t fclk_hz;      // CLKIN frequency
+    uint32_t bus_hz;       // I2C clock for the virtual transfer time
+    int virtual_clock;     // 1: virtual time, 0: CLOCK_MONOTONIC
+    uint64_t seed;         // noise generator seed
+    struct ldc_sim_channel channels[LDC1614_NUM_CHANNELS];
+};
+
+// Defaults: real time, 3 MHz sensors with a 1 Hz, 10 kHz sine and 20 Hz of noise, phases 90 degrees apart
+void ldc_sim_default_config(struct ldc_sim_config *config);
+
+/**
+ * @brief Apply comma separated options to every channel.
+ * @param opts e.g. "sine,f=3e6,a=1e4,hz=2,n=20,open=8,virtual". Waveforms: const, sine, square, ramp.
+ * Keys: f center Hz, a amplitude Hz, hz waveform Hz, n noise Hz, open channel mask without a sensor,
+ * clk CLKIN Hz, bus SCL Hz, seed, virtual (use the virtual clock)
+ * @return 0 on success, -1 on an unknown option
+ */
+int ldc_sim_parse(struct ldc_sim_config *config, const char *opts);
+
+/**
+ * @brief Create a simulated device in its power-on state (asleep, reset register values).
+ * @return 0 on success, -1 on failure
+ */
+int ldc_bus_open_sim(struct ldc_bus *bus, const struct ldc_sim_config *config, uint8_t addr);
+
+// 1 if bus is a simulated device
+int ldc_bus_is_sim(const struct ldc_bus *bus);
+
+// Current time on the simulator's clock (virtual or CLOCK_MONOTONIC)
+uint64_t ldc_sim_now_ns(struct ldc_bus *bus);
+
+// Conversions completed since the device was opened
+uint64_t ldc_sim_conversions(const struct ldc_bus *bus);
+
+/**
+ * @brief Event source that fires when the simulated device raises DRDY (end of each sequence).
+ * @note With the virtual clock a wait returns immediately and moves the clock to the event.
+ * @return 0 on success, -1 if bus is not simulated
+ */
+int ldc_event_open_sim(struct ldc_event_source *src, struct ldc_bus *bus);
+
+#endif /* INC_LDC_SIM_H_ */
@@ -0,0 +1,393 @@
+// Source file for the streaming subscription service.
+#include "ldc_stream.h"
+#include "ldc_proto.h"
+#include "ldc_time.h"
+#include "ldc_metrics.h"
+#include "ldc_convert.h"
+#include "ldc_server.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <endian.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <math.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#define DEFAULT_LATENCY_MS  100
+#define DEFAULT_LEASE_MS    5000
+#define MAX_LEASE_MS        60000
+#define MAX_STREAM_CHANNELS 32 // width of the channel mask
+
+struct subscriber {
+    int active;
+    struct sockaddr_in addr;
+    uint32_t channel_mask;
+    uint16_t batch_size;
+    uint16_t decimation;
+    uint8_t decimate_mode;  // LDC_DECIMATE_*
+    uint8_t units;          // LDC_UNITS_* asked for, taken over by buf_units once buf is empty
+    uint8_t buf_units;      // LDC_UNITS_* of the records in buf
+    uint16_t max_latency_ms;
+    uint16_t window;
+    uint32_t lease_ms;
+    uint64_t expires_ns;
+    uint64_t next_seq[MAX_STREAM_CHANNELS]; // next sample to stream per channel
+    uint32_t batch_seq;     // last batch sent
+    uint32_t acked_batch;   // last batch acknowledged by the client
+    uint32_t dropped;       // samples lost to ring overrun
+    uint16_t pending;       // records assembled in buf, not yet sent
+    uint64_t first_pending_ns;
+    int next_channel;       // channel to start filling from, rotated for fairness
+    uint8_t buf[LDC_MAX_DATAGRAM]; // batch being assembled, already in wire format
+};
+
+static pthread_mutex_t sub_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct subscriber subs[LDC_MAX_SUBSCRIBERS];
+static int stream_sock = -1;
+static struct ldc_ring *stream_rings = NULL;
+static int stream_num_rings = 0;
+static const struct ldc_convert *_Atomic stream_convert = NULL;
+
+void ldc_stream_init(int sock, struct ldc_ring *rings, int num_rings) {
+    stream_sock = sock;
+    stream_rings = rings;
+    stream_num_rings = (num_rings > MAX_STREAM_CHANNELS) ? MAX_STREAM_CHANNELS : num_rings;
+    memset(subs, 0, sizeof(subs));
+}
+
+void ldc_stream_set_convert(const struct ldc_convert *cv) {
+    atomic_store(&stream_convert, cv);
+}
+
+void ldc_stream_fill_units(uint8_t *records, int count) {
+    struct ldc_unit_record *rec = (struct ldc_unit_record *)records;
+    const struct ldc_convert *cv = atomic_load(&stream_convert);
+    uint32_t data[LDC_MAX_UNIT_RECORDS];
+    double hz[LDC_MAX_UNIT_RECORDS], henry[LDC_MAX_UNIT_RECORDS];
+
+    for (int i = 0; i < count;) {
+        // Records come in runs of one channel, each run is converted as one batch
+        int n = 0;
+        while (i + n < count && rec[i + n].channel == rec[i].channel) {
+            data[n] = ntohl(rec[i + n].value);
+            n++;
+        }
+        int ch = rec[i].channel % LDC_FILTERED_OFFSET; // filtered channels have the raw scale
+        if (cv != NULL) {
+            ldc_convert_frequency(cv, ch, data, hz, n);
+            ldc_convert_inductance(cv, ch, data, henry, n);
+        }
+        for (int k = 0; k < n; k++, i++) {
+            uint64_t bits;
+            double v = (cv != NULL) ? hz[k] : NAN;
+            memcpy(&bits, &v, sizeof(bits));
+            rec[i].frequency_hz = htobe64(bits);
+            v = (cv != NULL) ? henry[k] : NAN;
+            memcpy(&bits, &v, sizeof(bits));
+            rec[i].inductance_h = htobe64(bits);
+        }
+    }
+}
+
+static void reply_status(const struct ldc_msg_hdr *req, uint8_t status, const struct sockaddr_in *to) {
+    struct ldc_msg_hdr hdr = *req;
+    hdr.version = LDC_PROTO_VERSION;
+    hdr.status = status;
+    ldc_server_send(stream_sock, &hdr, sizeof(hdr), to);
+}
+
+static struct subscriber *find_subscriber(const struct sockaddr_in *addr) {
+    for (int i = 0; i < LDC_MAX_SUBSCRIBERS; i++) {
+        if (subs[i].active && subs[i].addr.sin_addr.s_addr == addr->sin_addr.s_addr &&
+            subs[i].addr.sin_port == addr->sin_port) {
+            return &subs[i];
+        }
+    }
+    return NULL;
+}
+
+static void handle_subscribe(const struct ldc_subscribe *req, const struct sockaddr_in *from) {
+    uint32_t valid = (stream_num_rings >= 32) ? 0xFFFFFFFF : ((1u << stream_num_rings) - 1);
+    uint32_t mask = ntohl(req->channel_mask) & valid;
+    if (mask == 0) {
+        reply_status(&req->hdr, LDC_STATUS_BAD_REQ, from);
+        return;
+    }
+
+    struct subscriber *sub = find_subscriber(from);
+    if (sub == NULL) {
+        for (int i = 0; i < LDC_MAX_SUBSCRIBERS && sub == NULL; i++) {
+            if (!subs[i].active) sub = &subs[i];
+        }
+        if (sub == NULL) {
+            reply_status(&req->hdr, LDC_STATUS_BUSY, from);
+            return;
+        }
+        // A new subscription starts with the next sample acquired
+        memset(sub, 0, sizeof(*sub));
+        sub->addr = *from;
+        for (int ch = 0; ch < stream_num_rings; ch++) {
+            sub->next_seq[ch] = ldc_ring_head(&stream_rings[ch]) + 1;
+        }
+        sub->active = 1;
+    } else {
+        // Renewal: channels that were not streamed before start at the newest sample
+        for (int ch = 0; ch < stream_num_rings; ch++) {
+            if ((mask & ~sub->channel_mask) & (1u << ch)) {
+                sub->next_seq[ch] = ldc_ring_head(&stream_rings[ch]) + 1;
+            }
+        }
+    }
+
+    // Negotiate: clamp everything the client asked for to what we can honour
+    uint16_t batch = ntohs(req->batch_size);
+    sub->units = (req->units == LDC_UNITS_SI) ? LDC_UNITS_SI : LDC_UNITS_RAW;
+    uint16_t max_batch = (sub->units == LDC_UNITS_SI) ? LDC_MAX_UNIT_RECORDS : LDC_MAX_RECORDS;
+    sub->channel_mask = mask;
+    sub->batch_size = (batch == 0 || batch > max_batch) ? max_batch : batch;
+    sub->decimation = ntohs(req->decimation) ? ntohs(req->decimation) : 1;
+    // Averaging needs the whole window still held by the ring
+    sub->decimate_mode = (req->decimate_mode == LDC_DECIMATE_AVERAGE && sub->decimation > 1 &&
+                          2 * (uint32_t)sub->decimation - 1 <= LDC_RING_CAPACITY / 2)
+                         ? LDC_DECIMATE_AVERAGE : LDC_DECIMATE_PICK;
+    sub->max_latency_ms = ntohs(req->max_latency_ms) ? ntohs(req->max_latency_ms) : DEFAULT_LATENCY_MS;
+    sub->window = ntohs(req->window);
+    sub->lease_ms = ntohl(req->lease_ms) ? ntohl(req->lease_ms) : DEFAULT_LEASE_MS;
+    if (sub->lease_ms > MAX_LEASE_MS) sub->lease_ms = MAX_LEASE_MS;
+    sub->expires_ns = ldc_now_ns() + (uint64_t)sub->lease_ms * 1000000ULL;
+    sub->acked_batch = sub->batch_seq; // a (re)subscription reopens the window
+
+    struct ldc_subscribe granted = *req;
+    granted.hdr.version = LDC_PROTO_VERSION;
+    granted.hdr.status = LDC_STATUS_OK;
+    granted.channel_mask = htonl(sub->channel_mask);
+    granted.batch_size = htons(sub->batch_size);
+    granted.decimation = htons(sub->decimation);
+    granted.decimate_mode = sub->decimate_mode;
+    granted.units = sub->units;
+    memset(granted.reserved, 0, sizeof(granted.reserved));
+    granted.max_latency_ms = htons(sub->max_latency_ms);
+    granted.window = htons(sub->window);
+    granted.lease_ms = htonl(sub->lease_ms);
+    ldc_server_send(stream_sock, &granted, sizeof(granted), from);
+}
+
+int ldc_stream_handle(const uint8_t *req, int n, const struct sockaddr_in *from) {
+    const struct ldc_msg_hdr *hdr = (const struct ldc_msg_hdr *)req;
+    if (n < (int)sizeof(*hdr)) return -1;
+
+    switch (hdr->opcode) {
+        case LDC_OP_SUBSCRIBE:
+            pthread_mutex_lock(&sub_lock);
+            if (n < (int)LDC_SUBSCRIBE_MIN_LEN) {
+                reply_status(hdr, LDC_STATUS_BAD_REQ, from);
+            } else {
+                // Fields a shorter (older) request leaves out read as zero
+                struct ldc_subscribe full;
+                memset(&full, 0, sizeof(full));
+                memcpy(&full, req, (n < (int)sizeof(full)) ? (size_t)n : sizeof(full));
+                handle_subscribe(&full, from);
+            }
+            pthread_mutex_unlock(&sub_lock);
+            return 0;
+        case LDC_OP_HEARTBEAT: {
+            pthread_mutex_lock(&sub_lock);
+            struct subscriber *sub = find_subscriber(from);
+            if (sub == NULL || n < (int)sizeof(struct ldc_heartbeat)) {
+                reply_status(hdr, LDC_STATUS_BAD_REQ, from); // tells the client to subscribe again
+            } else {
+                uint32_t acked = ntohl(((const struct ldc_heartbeat *)req)->acked_batch);
+                // Only move forward, and never past what was actually sent
+                if ((int32_t)(acked - sub->acked_batch) > 0 && (int32_t)(sub->batch_seq - acked) >= 0) {
+                    sub->acked_batch = acked;
+                }
+                sub->expires_ns = ldc_now_ns() + (uint64_t)sub->lease_ms * 1000000ULL;
+            }
+            pthread_mutex_unlock(&sub_lock);
+            return 0;
+        }
+        case LDC_OP_UNSUBSCRIBE: {
+            pthread_mutex_lock(&sub_lock);
+            struct subscriber *sub = find_subscriber(from);
+            if (sub != NULL) sub->active = 0;
+            reply_status(hdr, LDC_STATUS_OK, from);
+            pthread_mutex_unlock(&sub_lock);
+            return 0;
+        }
+        default:
+            return -1;
+    }
+}
+
+int ldc_stream_count(void) {
+    int count = 0;
+    pthread_mutex_lock(&sub_lock);
+    for (int i = 0; i < LDC_MAX_SUBSCRIBERS; i++) {
+        count += subs[i].active;
+    }
+    pthread_mutex_unlock(&sub_lock);
+    return count;
+}
+
+// Size of one record in buf
+static size_t record_size(const struct subscriber *sub) {
+    return (sub->buf_units == LDC_UNITS_SI) ? sizeof(struct ldc_unit_record) : sizeof(struct ldc_record);
+}
+
+// Records that fit buf: the batch size, or less while buf still holds unit records from before
+// a renewal asked for raw ones
+static uint16_t batch_limit(const struct subscriber *sub) {
+    if (sub->buf_units == LDC_UNITS_SI && sub->batch_size > LDC_MAX_UNIT_RECORDS) return LDC_MAX_UNIT_RECORDS;
+    return sub->batch_size;
+}
+
+static void append_record(struct subscriber *sub, int ch, const struct ldc_sample *s, uint64_t now) {
+    // The unit record starts with the fields of the plain one; the units are added when the batch is sent
+    struct ldc_record *rec = (struct ldc_record *)(sub->buf + sizeof(struct ldc_batch) + sub->pending * record_size(sub));
+    rec->channel = ch;
+    rec->flags = s->flags;
+    rec->reserved = 0;
+    rec->value = htonl(s->value);
+    rec->seq = htobe64(s->seq);
+    rec->t_ns = htobe64(s->t_ns);
+    ldc_metrics_record_age(now, s->t_ns);
+    if (sub->pending == 0) sub->first_pending_ns = now;
+    sub->pending++;
+}
+
+// LDC_DECIMATE_AVERAGE: triangular average of the 2d-1 samples ending at seq, i.e. a second
+// order CIC decimator evaluated from the ring. Returns -1 if part of the window is gone.
+static int average_window(struct ldc_ring *ring, uint64_t seq, uint16_t d, struct ldc_sample *out) {
+    struct ldc_sample s;
+    uint64_t acc = 0, t_ns = 0;
+    uint32_t flags = 0;
+
+    if (seq < 2 * (uint64_t)d - 1) return -1;
+    uint64_t first = seq - (2 * (uint64_t)d - 2);
+    for (uint64_t k = 0; k < 2 * (uint64_t)d - 1; k++) {
+        if (ldc_ring_get(ring, first + k, &s) != 0) return -1;
+        acc += (k < d ? k + 1 : 2 * (uint64_t)d - 1 - k) * s.value;
+        flags |= s.flags;
+        if (k == (uint64_t)d - 1) t_ns = s.t_ns;
+    }
+    out->t_ns = t_ns;
+    out->value = (uint32_t)((acc + (uint64_t)d * d / 2) / ((uint64_t)d * d)); // weights sum to d^2
+    out->flags = flags;
+    out->seq = seq;
+    return 0;
+}
+
+// Move samples from the rings into the pending batch, returns the number added
+static int fill_batch(struct subscriber *sub, uint64_t now) {
+    int added = 0;
+    if (sub->pending == 0) sub->buf_units = sub->units; // a renewal may have changed the record type
+    uint16_t limit = batch_limit(sub);
+    for (int i = 0; i < stream_num_rings && sub->pending < limit; i++) {
+        int ch = (sub->next_channel + i) % stream_num_rings;
+        if (!(sub->channel_mask & (1u << ch))) continue;
+
+        struct ldc_ring *ring = &stream_rings[ch];
+        uint64_t head = ldc_ring_head(ring);
+        uint64_t seq = sub->next_seq[ch];
+        struct ldc_sample sample;
+
+        while (sub->pending < limit && seq <= head) {
+            uint64_t tail = ldc_ring_tail(ring);
+            if (seq < tail) {
+                sub->dropped += tail - seq; // this subscriber fell behind the producer
+                seq = tail;
+            }
+            if (seq % sub->decimation != 0) {
+                seq += sub->decimation - seq % sub->decimation;
+                continue;
+            }
+            if (ldc_ring_get(ring, seq, &sample) != 0) {
+                continue; // overwritten while reading, the tail check skips past it
+            }
+            // A window that is not fully in the ring (the first ones, or overwritten) is not sent at all
+            if (sub->decimate_mode == LDC_DECIMATE_AVERAGE && average_window(ring, seq, sub->decimation, &sample) != 0) {
+                seq++;
+                continue;
+            }
+            append_record(sub, ch, &sample, now);
+            added++;
+            seq++;
+        }
+        sub->next_seq[ch] = seq;
+    }
+    return added;
+}
+
+// Send the pending batch if it is due, returns 1 if it went out
+static int flush_batch(struct subscriber *sub, uint64_t now) {
+    if (sub->pending == 0) return 0;
+    if (sub->pending < batch_limit(sub) &&
+        now - sub->first_pending_ns < (uint64_t)sub->max_latency_ms * 1000000ULL) {
+        return 0;
+    }
+    if (sub->window != 0 && sub->batch_seq - sub->acked_batch >= sub->window) {
+        return 0; // window full: hold this subscriber's cursor until it acknowledges
+    }
+
+    struct ldc_batch *batch = (struct ldc_batch *)sub->buf;
+    batch->hdr.magic = LDC_PROTO_MAGIC;
+    batch->hdr.version = LDC_PROTO_VERSION;
+    batch->hdr.opcode = LDC_OP_BATCH;
+    batch->hdr.status = LDC_STATUS_OK;
+    batch->hdr.req_id = 0;
+    batch->batch_seq = htonl(sub->batch_seq + 1);
+    batch->dropped = htonl(sub->dropped);
+    batch->count = htons(sub->pending);
+    batch->units = sub->buf_units;
+    batch->reserved = 0;
+    if (sub->buf_units == LDC_UNITS_SI) {
+        ldc_stream_fill_units(sub->buf + sizeof(struct ldc_batch), sub->pending);
+    }
+
+    size_t len = sizeof(struct ldc_batch) + sub->pending * record_size(sub);
+    // Never block: a full socket buffer just defers this subscriber to the next tick
+    if (sendto(stream_sock, sub->buf, len, MSG_DONTWAIT,
+               (const struct sockaddr *)&sub->addr, sizeof(sub->addr)) < 0) {
+        return 0;
+    }
+    sub->batch_seq++;
+    sub->pending = 0;
+    sub->next_channel = (sub->next_channel + 1) % stream_num_rings;
+    return 1;
+}
+
+void *ldc_stream_worker(void *arg) {
+    volatile sig_atomic_t *stop = arg;
+    struct timespec next_time;
+
+    clock_gettime(CLOCK_MONOTONIC, &next_time);
+    while (!*stop) {
+        uint64_t now = ldc_now_ns();
+
+        pthread_mutex_lock(&sub_lock);
+        for (int i = 0; i < LDC_MAX_SUBSCRIBERS; i++) {
+            struct subscriber *sub = &subs[i];
+            if (!sub->active) continue;
+            if (now > sub->expires_ns) {
+                sub->active = 0; // lease ran out without a heartbeat
+                continue;
+            }
+            // Drain the backlog in full batches, then hold the remainder until it is due
+            do {
+                fill_batch(sub, now);
+            } while (flush_batch(sub, now) && sub->pending == 0);
+        }
+        pthread_mutex_unlock(&sub_lock);
+
+        next_time.tv_nsec += STREAM_TICK_NS;
+        if (next_time.tv_nsec >= 1000000000L) {
+            next_time.tv_nsec -= 1000000000L;
+            next_time.tv_sec += 1;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_time, NULL);
+    }
+    return NULL;
+}
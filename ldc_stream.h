@@ -0,0 +1,57 @@
+/*
+ * ldc_stream.h
+ *
+ * Push-based sample streaming for ldc_service.
+ *
+ * Clients subscribe with LDC_OP_SUBSCRIBE and then receive LDC_OP_BATCH
+ * datagrams until their lease runs out. Every subscriber keeps its own
+ * cursor into the sample rings and its own send window, so a slow client
+ * only ever loses its own samples.
+ */
+
+#ifndef INC_LDC_STREAM_H_
+#define INC_LDC_STREAM_H_
+
+#include <stdint.h>
+#include <signal.h>
+#include <netinet/in.h>
+#include "ldc_ring.h"
+
+struct ldc_convert;
+
+#define LDC_MAX_SUBSCRIBERS 16
+#define STREAM_TICK_NS      1000000 // streaming thread period, 1 ms
+
+/**
+ * @brief Set up the subscriber table.
+ * @param sock UDP socket batches are sent from
+ * @param rings per-channel sample rings, indexed by channel number
+ * @param num_rings number of rings
+ */
+void ldc_stream_init(int sock, struct ldc_ring *rings, int num_rings);
+
+/**
+ * @brief Handle a SUBSCRIBE, HEARTBEAT or UNSUBSCRIBE request.
+ * @return 0 if the request was a streaming request, -1 if the opcode is not ours
+ */
+int ldc_stream_handle(const uint8_t *req, int n, const struct sockaddr_in *from);
+
+/**
+ * @brief Set the raw to engineering unit conversion of LDC_UNITS_SI records.
+ * @param cv conversion of the settings the device runs, must stay valid; NULL sends NaN
+ */
+void ldc_stream_set_convert(const struct ldc_convert *cv);
+
+/**
+ * @brief Fill in frequency and inductance of count wire format ldc_unit_record entries
+ * (at most LDC_MAX_UNIT_RECORDS) whose other fields are already set.
+ */
+void ldc_stream_fill_units(uint8_t *records, int count);
+
+// Number of live subscriptions
+int ldc_stream_count(void);
+
+// Streaming thread, arg points at the service's volatile sig_atomic_t stop flag
+void *ldc_stream_worker(void *arg);
+
+#endif /* INC_LDC_STREAM_H_ */
@@ -0,0 +1,40 @@
+/*
+ * ldc_time.h
+ *
+ * Monotonic timestamp helpers shared by the acquisition and serving code.
+ */
+
+#ifndef INC_LDC_TIME_H_
+#define INC_LDC_TIME_H_
+
+#include <stdint.h>
+#include <time.h>
+
+#define NS_PER_SEC 1000000000ULL
+
+static inline uint64_t ldc_timespec_to_ns(const struct timespec *ts) {
+    return (uint64_t)ts->tv_sec * NS_PER_SEC + (uint64_t)ts->tv_nsec;
+}
+
+static inline struct timespec ldc_ns_to_timespec(uint64_t ns) {
+    struct timespec ts;
+    ts.tv_sec = ns / NS_PER_SEC;
+    ts.tv_nsec = ns % NS_PER_SEC;
+    return ts;
+}
+
+// CLOCK_MONOTONIC in nanoseconds
+static inline uint64_t ldc_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ldc_timespec_to_ns(&ts);
+}
+
+// CLOCK_REALTIME in nanoseconds, for kernel socket timestamps and lining up several hosts
+static inline uint64_t ldc_realtime_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ldc_timespec_to_ns(&ts);
+}
+
+#endif /* INC_LDC_TIME_H_ */
@@ -0,0 +1,398 @@
+// Source file for bus trace recording and replay.
+#define _GNU_SOURCE // MAP_POPULATE
+#include "ldc_trace.h"
+#include "ldc_time.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define TRACE_BUF_SIZE (64 * 1024) // stdio buffer of the recorder: one write() per ~1500 bursts
+
+struct recorder {
+    struct ldc_bus inner;
+    FILE *f;
+    uint64_t start_ns;
+    char name[64];
+    // The event source being recorded: its own callbacks and ctx, swapped back in around each wait
+    struct ldc_event_source *src;
+    int (*src_wait)(struct ldc_event_source *src, int timeout_ms, uint64_t *t_ns);
+    void (*src_close)(struct ldc_event_source *src);
+    void *src_ctx;
+    uint32_t src_overruns;   // src->overruns after the last recorded wait
+};
+
+struct replay {
+    const uint8_t *base;     // the mapped trace
+    size_t size;
+    size_t pos;              // offset of the next record
+    int fast;
+    int started;             // clock0 is set
+    uint64_t clock0;         // replay time of the trace's t = 0
+    uint64_t event_ns;       // trace time of the last event, the virtual clock when fast
+    uint64_t records;        // consumed so far
+    int failed;              // errno of every call once diverged or at the end, 0 while replaying
+    char path[64];
+    char name[32];
+};
+
+// --- Recording ---
+
+static void put_header(struct recorder *r, uint8_t type, int result, uint16_t len) {
+    struct ldc_trace_rec rec = { ldc_now_ns() - r->start_ns, type, (int8_t)result, len };
+    fwrite(&rec, sizeof(rec), 1, r->f);
+}
+
+static int record_read(struct ldc_bus *bus, const struct ldc_bus_xfer *xfers, int n) {
+    struct recorder *r = bus->ctx;
+    int ret = r->inner.read(&r->inner, xfers, n);
+    uint32_t len = 0;
+
+    for (int i = 0; i < n; i++) {
+        len += 3 + xfers[i].len;
+    }
+    put_header(r, LDC_TRACE_READ, ret, (uint16_t)len);
+    for (int i = 0; i < n; i++) {
+        uint8_t range[3] = { xfers[i].reg, xfers[i].len & 0xFF, xfers[i].len >> 8 };
+        fwrite(range, sizeof(range), 1, r->f);
+        fwrite(xfers[i].buf, 1, xfers[i].len, r->f);
+    }
+    return ret;
+}
+
+static int record_write(struct ldc_bus *bus, uint8_t reg, uint16_t value) {
+    struct recorder *r = bus->ctx;
+    int ret = r->inner.write(&r->inner, reg, value);
+    uint8_t payload[3] = { reg, value & 0xFF, value >> 8 };
+
+    put_header(r, LDC_TRACE_WRITE, ret, sizeof(payload));
+    fwrite(payload, sizeof(payload), 1, r->f);
+    return ret;
+}
+
+static void record_close(struct ldc_bus *bus) {
+    struct recorder *r = bus->ctx;
+    if (r == NULL) return;
+    if (fclose(r->f) != 0) perror("Failed to write bus trace");
+    ldc_bus_close(&r->inner);
+    free(r);
+    bus->ctx = NULL;
+}
+
+int ldc_bus_open_record(struct ldc_bus *bus, const char *path, const char *spec, uint8_t addr) {
+    struct ldc_trace_header hdr;
+    struct recorder *r = calloc(1, sizeof(*r));
+
+    memset(bus, 0, sizeof(*bus));
+    bus->fd = -1;
+    if (r == NULL) {
+        fprintf(stderr, "Failed to allocate bus recorder\n");
+        return -1;
+    }
+    if (ldc_bus_open(&r->inner, spec, addr) != 0) {
+        free(r);
+        return -1;
+    }
+    r->f = fopen(path, "wb");
+    if (r->f == NULL) {
+        fprintf(stderr, "Failed to create bus trace %s: %s\n", path, strerror(errno));
+        ldc_bus_close(&r->inner);
+        free(r);
+        return -1;
+    }
+    setvbuf(r->f, NULL, _IOFBF, TRACE_BUF_SIZE);
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, LDC_TRACE_MAGIC, sizeof(hdr.magic));
+    hdr.version = LDC_TRACE_VERSION;
+    hdr.header_size = sizeof(hdr);
+    hdr.addr = addr;
+    r->start_ns = ldc_now_ns();
+    hdr.start_mono_ns = r->start_ns;
+    hdr.start_real_ns = ldc_realtime_ns();
+    strncpy(hdr.bus, spec, sizeof(hdr.bus) - 1);
+    fwrite(&hdr, sizeof(hdr), 1, r->f);
+
+    snprintf(r->name, sizeof(r->name), "%s, recording", r->inner.name);
+    bus->read = record_read;
+    bus->write = record_write;
+    bus->close = record_close;
+    bus->name = r->name;
+    bus->fd = r->inner.fd;
+    bus->addr = addr;
+    bus->ctx = r;
+    return 0;
+}
+
+int ldc_bus_is_recording(const struct ldc_bus *bus) {
+    return bus->read == record_read;
+}
+
+static int record_event_wait(struct ldc_event_source *src, int timeout_ms, uint64_t *t_ns) {
+    struct recorder *r = src->ctx;
+    uint64_t t_event = 0;
+
+    src->ctx = r->src_ctx;
+    int ret = r->src_wait(src, timeout_ms, &t_event);
+    src->ctx = r;
+
+    struct ldc_trace_event ev = { 0 };
+    ev.has_time = (ret > 0 && t_event != 0);
+    ev.t_event_ns = ev.has_time ? (int64_t)(t_event - r->start_ns) : 0;
+    ev.overruns = src->overruns - r->src_overruns;
+    r->src_overruns = src->overruns;
+    put_header(r, LDC_TRACE_EVENT, ret, sizeof(ev));
+    fwrite(&ev, sizeof(ev), 1, r->f);
+    if (ret > 0) *t_ns = t_event;
+    return ret;
+}
+
+static void record_event_close(struct ldc_event_source *src) {
+    struct recorder *r = src->ctx;
+
+    src->ctx = r->src_ctx;
+    src->wait = r->src_wait;
+    src->close = r->src_close;
+    r->src = NULL;
+    ldc_event_close(src);
+}
+
+int ldc_event_record(struct ldc_event_source *src, struct ldc_bus *bus) {
+    if (!ldc_bus_is_recording(bus)) {
+        fprintf(stderr, "%s bus is not recording\n", bus->name);
+        return -1;
+    }
+    struct recorder *r = bus->ctx;
+    r->src = src;
+    r->src_wait = src->wait;
+    r->src_close = src->close;
+    r->src_ctx = src->ctx;
+    r->src_overruns = src->overruns;
+    src->wait = record_event_wait;
+    src->close = record_event_close;
+    src->ctx = r;
+    return 0;
+}
+
+// --- Replay ---
+
+// Stop replaying: every later call fails with err
+static int replay_fail(struct replay *p, int err, const char *what) {
+    if (!p->failed) {
+        if (err == ENODATA) {
+            fprintf(stderr, "Replay of %s finished after %llu records\n", p->path, (unsigned long long)p->records);
+        } else {
+            fprintf(stderr, "Replay of %s diverged at record %llu: %s\n", p->path,
+                    (unsigned long long)p->records, what);
+        }
+        p->failed = err;
+    }
+    errno = p->failed;
+    return -1;
+}
+
+// Next record of type, its payload in *payload; -1 at the end, on a mismatch or once failed
+static int replay_next(struct replay *p, uint8_t type, struct ldc_trace_rec *rec, const uint8_t **payload,
+                       const char *what) {
+    if (p->failed) {
+        errno = p->failed;
+        return -1;
+    }
+    if (p->pos + sizeof(*rec) > p->size) return replay_fail(p, ENODATA, NULL);
+    memcpy(rec, p->base + p->pos, sizeof(*rec));
+    if (p->pos + sizeof(*rec) + rec->len > p->size) return replay_fail(p, ENODATA, NULL); // cut off by a crash
+    if (rec->type != type) return replay_fail(p, EPROTO, what);
+    *payload = p->base + p->pos + sizeof(*rec);
+    if (!p->started) {
+        p->clock0 = ldc_now_ns() - rec->t_ns; // the first record happens now
+        p->started = 1;
+    }
+    return 0;
+}
+
+static void replay_consume(struct replay *p, const struct ldc_trace_rec *rec) {
+    p->pos += sizeof(*rec) + rec->len;
+    p->records++;
+}
+
+static int replay_read(struct ldc_bus *bus, const struct ldc_bus_xfer *xfers, int n) {
+    struct replay *p = bus->ctx;
+    struct ldc_trace_rec rec;
+    const uint8_t *payload;
+    char what[64];
+    size_t off = 0;
+
+    snprintf(what, sizeof(what), "read of %d range(s) from 0x%02X", n, n > 0 ? xfers[0].reg : 0);
+    if (replay_next(p, LDC_TRACE_READ, &rec, &payload, what) != 0) return -1;
+    for (int i = 0; i < n; i++) {
+        if (off + 3 > rec.len) return replay_fail(p, EPROTO, what);
+        uint16_t len = payload[off + 1] | (payload[off + 2] << 8);
+        if (payload[off] != xfers[i].reg || len != xfers[i].len || off + 3 + len > rec.len) {
+            return replay_fail(p, EPROTO, what);
+        }
+        off += 3 + len;
+    }
+    if (off != rec.len) return replay_fail(p, EPROTO, what);
+
+    off = 0;
+    for (int i = 0; i < n; i++) {
+        memcpy(xfers[i].buf, payload + off + 3, xfers[i].len);
+        off += 3 + xfers[i].len;
+    }
+    replay_consume(p, &rec);
+    if (rec.result != 0) {
+        errno = EIO; // the recorded transfer failed
+        return -1;
+    }
+    return 0;
+}
+
+static int replay_write(struct ldc_bus *bus, uint8_t reg, uint16_t value) {
+    struct replay *p = bus->ctx;
+    struct ldc_trace_rec rec;
+    const uint8_t *payload;
+    char what[64];
+
+    snprintf(what, sizeof(what), "write of 0x%04X to 0x%02X", value, reg);
+    if (replay_next(p, LDC_TRACE_WRITE, &rec, &payload, what) != 0) return -1;
+    if (rec.len != 3 || payload[0] != reg || (payload[1] | (payload[2] << 8)) != value) {
+        return replay_fail(p, EPROTO, what);
+    }
+    replay_consume(p, &rec);
+    if (rec.result != 0) {
+        errno = EIO;
+        return -1;
+    }
+    return 0;
+}
+
+static void replay_close(struct ldc_bus *bus) {
+    struct replay *p = bus->ctx;
+    if (p == NULL) return;
+    munmap((void *)p->base, p->size);
+    free(p);
+    bus->ctx = NULL;
+}
+
+int ldc_bus_open_replay(struct ldc_bus *bus, const char *path, const char *opts, uint8_t addr) {
+    struct ldc_trace_header hdr;
+    struct stat st;
+
+    memset(bus, 0, sizeof(*bus));
+    bus->fd = -1;
+    if (opts != NULL && opts[0] != '\0' && strcmp(opts, "fast") != 0) {
+        fprintf(stderr, "Invalid replay option: %s (fast)\n", opts);
+        return -1;
+    }
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open bus trace %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(hdr)) {
+        fprintf(stderr, "%s is not a bus trace\n", path);
+        close(fd);
+        return -1;
+    }
+    void *base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "Failed to map bus trace %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    memcpy(&hdr, base, sizeof(hdr));
+    if (memcmp(hdr.magic, LDC_TRACE_MAGIC, sizeof(hdr.magic)) != 0 || hdr.version != LDC_TRACE_VERSION ||
+        hdr.header_size < sizeof(hdr) || hdr.header_size > st.st_size) {
+        fprintf(stderr, "%s is not a version %d bus trace\n", path, LDC_TRACE_VERSION);
+        munmap(base, st.st_size);
+        return -1;
+    }
+    if (hdr.addr != addr) {
+        fprintf(stderr, "Warning: %s was recorded at address 0x%02X\n", path, hdr.addr);
+    }
+
+    struct replay *p = calloc(1, sizeof(*p));
+    if (p == NULL) {
+        fprintf(stderr, "Failed to allocate bus replay\n");
+        munmap(base, st.st_size);
+        return -1;
+    }
+    p->base = base;
+    p->size = st.st_size;
+    p->pos = hdr.header_size;
+    p->fast = (opts != NULL && strcmp(opts, "fast") == 0);
+    strncpy(p->path, path, sizeof(p->path) - 1);
+    strcpy(p->name, p->fast ? "trace replay (fast)" : "trace replay");
+
+    bus->read = replay_read;
+    bus->write = replay_write;
+    bus->close = replay_close;
+    bus->name = p->name;
+    bus->addr = addr;
+    bus->ctx = p;
+    return 0;
+}
+
+int ldc_bus_is_replay(const struct ldc_bus *bus) {
+    return bus->read == replay_read;
+}
+
+uint64_t ldc_replay_now_ns(const struct ldc_bus *bus) {
+    const struct replay *p = bus->ctx;
+    return p->fast ? p->clock0 + p->event_ns : ldc_now_ns();
+}
+
+static int replay_event_wait(struct ldc_event_source *src, int timeout_ms, uint64_t *t_ns) {
+    struct ldc_bus *bus = src->ctx;
+    struct replay *p = bus->ctx;
+    struct ldc_trace_rec rec;
+    struct ldc_trace_event ev;
+    const uint8_t *payload;
+
+    if (replay_next(p, LDC_TRACE_EVENT, &rec, &payload, "wait for data ready") != 0) return -1;
+    if (rec.len != sizeof(ev)) return replay_fail(p, EPROTO, "malformed event record");
+    memcpy(&ev, payload, sizeof(ev));
+
+    // The recorded outcome is returned whatever timeout_ms is now: a wait that ended early
+    // (or late) here would call for reads the trace does not have next
+    (void)timeout_ms;
+    if (!p->fast) {
+        // Recorded speed: the wait returns when it did in the recording. Reads are answered at
+        // once, so this sleeps up to one recorded wait; a signal (shutdown) cuts it short.
+        struct timespec ts = ldc_ns_to_timespec(p->clock0 + rec.t_ns);
+        int ret = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+        if (ret != 0 && ret != EINTR) {
+            errno = ret;
+            return -1;
+        }
+    }
+    replay_consume(p, &rec);
+    p->event_ns = rec.t_ns;
+    src->overruns += ev.overruns;
+    if (rec.result > 0) {
+        int64_t t = ev.has_time ? ev.t_event_ns : (int64_t)rec.t_ns;
+        *t_ns = p->clock0 + (t > 0 ? (uint64_t)t : 0);
+    } else if (rec.result < 0) {
+        errno = EIO; // the recorded source failed
+    }
+    return rec.result;
+}
+
+int ldc_event_open_replay(struct ldc_event_source *src, struct ldc_bus *bus) {
+    memset(src, 0, sizeof(*src));
+    src->fd = -1;
+    if (!ldc_bus_is_replay(bus)) {
+        fprintf(stderr, "%s bus is not replaying a trace\n", bus->name);
+        return -1;
+    }
+    src->wait = replay_event_wait;
+    src->name = "replayed data ready";
+    src->ctx = bus;
+    return 0;
+}
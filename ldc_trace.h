@@ -0,0 +1,109 @@
+/*
+ * ldc_trace.h
+ *
+ * Record and replay of LDC1614 bus traffic.
+ *
+ * The recorder wraps any other bus ("record:<file>:<bus spec>") and
+ * writes every register transaction to a trace file: each combined read
+ * with the bytes it returned, each write, and each wait of the caller's
+ * data-ready event source with its outcome and edge time. The replay
+ * backend ("replay:<file>[:fast]") answers the same sequence of calls
+ * from the trace, so the driver and everything above it see exactly the
+ * recorded conversions, error bits and timing:
+ *
+ *   recorded speed  event waits sleep until their recorded time
+ *   fast            a virtual clock follows the trace, nothing sleeps
+ *
+ * Either way a wait returns its recorded outcome, recorded timeouts
+ * included, regardless of the timeout it is called with.
+ *
+ * Replayed events always carry a time on the trace's timeline (the edge
+ * if there was one, else the recorded wakeup), shifted so the first
+ * record happens when the replay starts: samples are spaced as recorded. A call
+ * that does not match the next record (different registers, a write that
+ * was not recorded) means the caller diverged from the recording: it fails
+ * with EPROTO and so does everything after it. The end of the trace ends
+ * the event source with ENODATA.
+ *
+ * A trace holds one device. Fields are little-endian.
+ *
+ *   ldc_trace_header
+ *   ldc_trace_rec + payload, ...
+ */
+
+#ifndef INC_LDC_TRACE_H_
+#define INC_LDC_TRACE_H_
+
+#include <stdint.h>
+#include "ldc_bus.h"
+#include "ldc_event.h"
+
+#define LDC_TRACE_MAGIC    "LDCTRC\0" // 8 bytes including the terminator
+#define LDC_TRACE_VERSION  1
+
+// Record types
+#define LDC_TRACE_READ     1  // payload: per range uint8_t reg, uint16_t len, len bytes read
+#define LDC_TRACE_WRITE    2  // payload: uint8_t reg, uint16_t value
+#define LDC_TRACE_EVENT    3  // payload: struct ldc_trace_event
+
+struct ldc_trace_header {
+    char magic[8];           // LDC_TRACE_MAGIC
+    uint16_t version;
+    uint16_t header_size;    // offset of the first record
+    uint8_t addr;            // 7-bit device address
+    uint8_t reserved[3];
+    uint64_t start_mono_ns;  // CLOCK_MONOTONIC at t = 0
+    uint64_t start_real_ns;  // CLOCK_REALTIME at t = 0
+    char bus[48];            // spec of the recorded bus, NUL padded
+} __attribute__((packed));
+
+struct ldc_trace_rec {
+    uint64_t t_ns;           // since t = 0, when the call returned
+    uint8_t type;            // LDC_TRACE_*
+    int8_t result;           // return value of the call
+    uint16_t len;            // payload bytes that follow
+} __attribute__((packed));
+
+struct ldc_trace_event {
+    int64_t t_event_ns;      // edge time since t = 0, valid if has_time
+    uint32_t overruns;       // events the source collapsed into this one
+    uint8_t has_time;
+    uint8_t reserved[3];
+} __attribute__((packed));
+
+/**
+ * @brief Open spec and record its traffic to path (truncated).
+ * @return 0 on success, -1 on failure
+ */
+int ldc_bus_open_record(struct ldc_bus *bus, const char *path, const char *spec, uint8_t addr);
+
+/**
+ * @brief Replay the trace at path.
+ * @param opts NULL or "" for recorded speed, "fast" for the virtual clock
+ * @return 0 on success, -1 if the trace cannot be read
+ */
+int ldc_bus_open_replay(struct ldc_bus *bus, const char *path, const char *opts, uint8_t addr);
+
+// 1 if bus is recording a trace
+int ldc_bus_is_recording(const struct ldc_bus *bus);
+
+// 1 if bus replays a trace
+int ldc_bus_is_replay(const struct ldc_bus *bus);
+
+// Current time of a replay: the recorded wakeup of the last event when fast, else CLOCK_MONOTONIC
+uint64_t ldc_replay_now_ns(const struct ldc_bus *bus);
+
+/**
+ * @brief Record every wait of src into the trace of a recording bus. src keeps working as
+ * before, including its timer state; closing it stops the recording of events.
+ * @return 0 on success, -1 if bus is not recording
+ */
+int ldc_event_record(struct ldc_event_source *src, struct ldc_bus *bus);
+
+/**
+ * @brief Event source that returns the recorded waits of a replaying bus.
+ * @return 0 on success, -1 if bus is not replaying
+ */
+int ldc_event_open_replay(struct ldc_event_source *src, struct ldc_bus *bus);
+
+#endif /* INC_LDC_TRACE_H_ */
@@ -1,5 +1,3 @@
-#include <wiringPi.h>
-#include <wiringPiI2C.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -9,14 +7,33 @@
 #include <fcntl.h>
 #include <syslog.h>
 #include <time.h>
+#include <math.h>
 #include "ldc1614.h"
+#include "ldc_bus.h"
 #include "UDP_client.h"
+#include "ldc_log.h"
+#include "ldc_time.h"
+#include "ldc_errors.h"
+#include "ldc_event.h"
+#include "ldc_sim.h"
+#include "ldc_trace.h"
+#include "ldc_control.h"
+#include "ldc_metrics.h"
+#include "ldc_settle.h"
 
 #define HOME 100
 #define ZERO_SAMPLES 100
+#define ERROR_REPORT_NS 5000000000ULL // summarize conversion errors at most every 5 s
+#define EVENT_TIMEOUT_MS 100 // closed loop: give up waiting for a conversion after this long
+#define SCRIPT_MAX_FRAMES 4096 // -q: command frames in one script
+#define ACK_DRAIN_US 100000 // wait this long for outstanding acknowledgements at the end
+#define SETTLE_TIMEOUT_MS 1000 // -S: default time a step may take to settle
 
 char ip[]="127.0.0.0";
 char port[] = "2345";
+struct ldc_error_counts sample_errors; // error bits of every sample read, summarized between steps
+struct cmd_frame command; // actuator command, kept in network byte order between sends
+int acks = 0; // -a: number commands and measure the acknowledgement latency
 
 
 
@@ -45,59 +62,374 @@ struct timespec get_elapsed_time(struct timespec start, struct timespec end) {
  * @param cmd_val
  * @return status: 0 on success, -1 on failure
  * @note This function sends command values to the actuater via UDP.
- * It prepares the command data and sends it using the UDP_send function.
+ * The command frame is only rewritten when the value changes and is sent
+ * in place with UDP_send_cmd. Nothing is printed, so it can be called once
+ * per conversion.
  */
 int send_command(int16_t cmd_val) {
-    union CMD_DATA cmd_data, buf_data;
+    static int16_t last_val;
+    static int filled = 0;
 
-    // Prepare the command data
-    for(int i = 0; i < CMD_SIZE/2; i++) {
-        cmd_data.values[i] = cmd_val; // Set command value
-        buf_data.values[i] = htons(cmd_val); // Convert to network byte order
+    if (!filled || cmd_val != last_val) {
+        UDP_cmd_fill(&command, cmd_val); // all actuator channels get the same value
+        last_val = cmd_val;
+        filled = 1;
     }
 
-    // Send the command buffer values
-    size_t bytes_sent = UDP_send(buf_data);
-    if (bytes_sent <= 0) {
-        fprintf(stderr, "Failed to send command data: %s\n", strerror(errno));
-        return -1; // Return error if sending fails
+    // Callers report failures, so the closed loop never prints here
+    int bytes_sent = UDP_send_cmd(&command);
+    if (bytes_sent < CMD_SIZE) {
+        return -1; // Return error if sending fails, errno says why
+    }
+    if (acks) {
+        UDP_poll_acks();
     }
-    printf("Sent %zu bytes\n", bytes_sent);
     return 0; // Return success
 
 }
 
+/**
+ * @brief Load a command script: one frame per line, with either one value for
+ * every actuator channel or up to CMD_CHANNELS values separated by commas or
+ * spaces (missing channels are 0). Empty lines and lines starting with # are skipped.
+ * @param path script file
+ * @param frames filled with the frames in network byte order
+ * @param max_frames capacity of frames
+ * @return number of frames, -1 on failure
+ */
+int load_script(const char *path, struct cmd_frame *frames, int max_frames) {
+    char line[512];
+    int count = 0, line_no = 0;
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        fprintf(stderr, "Failed to open command script %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    while (fgets(line, sizeof(line), f) != NULL) {
+        int16_t values[CMD_CHANNELS];
+        int n = 0;
+        char *p = line, *end;
+
+        line_no++;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '#' || *p == '\n' || *p == '\r' || *p == '\0') continue;
+        if (count == max_frames) {
+            fprintf(stderr, "%s: more than %d frames\n", path, max_frames);
+            fclose(f);
+            return -1;
+        }
+        for (;;) {
+            long v = strtol(p, &end, 0);
+            if (end == p) break;
+            if (n == CMD_CHANNELS || v < INT16_MIN || v > INT16_MAX) {
+                fprintf(stderr, "%s:%d: expected at most %d values in [%d, %d]\n", path, line_no,
+                        CMD_CHANNELS, INT16_MIN, INT16_MAX);
+                fclose(f);
+                return -1;
+            }
+            values[n++] = (int16_t)v;
+            p = end + strspn(end, ", \t");
+        }
+        if (n == 0 || (*p != '\n' && *p != '\r' && *p != '\0')) {
+            fprintf(stderr, "%s:%d: not a list of command values\n", path, line_no);
+            fclose(f);
+            return -1;
+        }
+        if (n == 1) {
+            UDP_cmd_fill(&frames[count], values[0]);
+        } else {
+            memset(&frames[count], 0, sizeof(frames[count]));
+            for (int i = 0; i < n; i++) UDP_cmd_set(&frames[count], i, values[i]);
+        }
+        count++;
+    }
+    fclose(f);
+    return count;
+}
+
+/**
+ * @brief Send a command script back to back, as few system calls as possible,
+ * then home the actuator.
+ * @return 0 if every frame was sent, -1 otherwise
+ */
+int run_script(const char *path) {
+    static struct cmd_frame frames[SCRIPT_MAX_FRAMES];
+    int count = load_script(path, frames, SCRIPT_MAX_FRAMES);
+    if (count < 0) {
+        return -1;
+    }
+
+    uint64_t t0 = ldc_now_ns();
+    int sent = UDP_send_burst(frames, count);
+    uint64_t elapsed = ldc_now_ns() - t0;
+    if (sent < 0) {
+        syslog(LOG_ERR, "Failed to send command script: %s\n", strerror(errno));
+        return -1;
+    }
+    syslog(LOG_INFO, "Sent %d of %d scripted commands in %.3f ms (%.0f commands/s)", sent, count,
+           elapsed / 1e6, elapsed ? sent * 1e9 / elapsed : 0.0);
+    send_command(HOME);
+    return (sent == count) ? 0 : -1;
+}
+
+// Collect the acknowledgements still in flight and print the latency summary
+void report_acks(void) {
+    struct udp_ack_stats stats;
+
+    usleep(ACK_DRAIN_US);
+    UDP_poll_acks();
+    UDP_ack_stats(&stats);
+    if (stats.acked == 0) {
+        fprintf(stderr, "Acknowledged 0 of %llu commands\n", (unsigned long long)stats.sent);
+        return;
+    }
+    fprintf(stderr, "Acknowledged %llu of %llu commands: mean=%.1fus min=%.1fus max=%.1fus\n",
+            (unsigned long long)stats.acked, (unsigned long long)stats.sent,
+            stats.sum_ns / 1e3 / stats.acked, stats.min_ns / 1e3, stats.max_ns / 1e3);
+}
+/**
+ * @brief Wait for a new conversion on a channel and read it.
+ * @param bus bus the LDC1614 is on
+ * @param channel channel to read
+ * @param value conversion result
+ * @param errors UR/OR/WD/AE error bits of the conversion
+ * @return 0 on success, -1 on failure
+ * @note STATUS and DATA are fetched together in one burst transaction, so
+ * each poll costs a single I2C transfer and the value returned is the one
+ * the unread-conversion bit refers to.
+ */
+int read_next_sample(struct ldc_bus *bus, int channel, uint32_t *value, uint8_t *errors) {
+    struct ldc1614_burst burst;
+    do {
+        if (ldc1614_read_burst(bus, 1 << channel, &burst) == -1) {
+            return -1;
+        }
+    } while (!(burst.status & LDC1614_UNREADCONV(channel)));
+
+    ldc_errors_count(&sample_errors, channel, burst.errors[channel]);
+    *value = burst.value[channel];
+    *errors = burst.errors[channel];
+    return 0;
+}
+
+/**
+ * @brief Read conversions until the signal has settled after a command change.
+ * @param bus bus the LDC1614 is on
+ * @param channel channel to read
+ * @param settle detector with the window and thresholds, reset here
+ * @param timeout_ns give up after this long
+ * @param settle_ns time it took to settle, or timeout_ns
+ * @return 1 if settled, 0 on timeout, -1 on a bus error
+ * @note Samples read while settling are not logged. Conversions with watchdog or range errors
+ * are not positions and are left out of the window.
+ */
+int wait_settled(struct ldc_bus *bus, int channel, struct ldc_settle *settle, uint64_t timeout_ns,
+                 uint64_t *settle_ns) {
+    uint64_t t0 = ldc_now_ns();
+    uint32_t value;
+    uint8_t errors;
+
+    ldc_settle_reset(settle);
+    for (;;) {
+        if (read_next_sample(bus, channel, &value, &errors) == -1) {
+            return -1;
+        }
+        *settle_ns = ldc_now_ns() - t0;
+        if (!(errors & ((1 << LDC_ERR_WD) | (1 << LDC_ERR_OR) | (1 << LDC_ERR_UR))) &&
+            ldc_settle_add(settle, value)) {
+            return 1;
+        }
+        if (*settle_ns >= timeout_ns) {
+            return 0;
+        }
+    }
+}
+
+/**
+ * @brief wait_settled() after a command step, recording the settle time and reporting failures.
+ * @param cmd command that was sent, for the messages
+ * @param stats settle times
+ * @return as wait_settled()
+ */
+int settle_step(struct ldc_bus *bus, int channel, struct ldc_settle *settle, uint64_t timeout_ns, int16_t cmd,
+                struct ldc_hist *stats) {
+    uint64_t settle_ns = 0;
+    int ret = wait_settled(bus, channel, settle, timeout_ns, &settle_ns);
+    if (ret == -1) {
+        syslog(LOG_ERR, "Failed to read value: %s\n", strerror(errno));
+    } else if (ret == 0) {
+        syslog(LOG_WARNING, "Command %d not settled after %.0f ms (std %.1f, slope %.2f)", cmd,
+               settle_ns / 1e6, ldc_settle_std(settle), ldc_settle_slope(settle));
+    }
+    ldc_hist_add(stats, settle_ns);
+    return ret;
+}
+
+/**
+ * @brief Queue a sample for the log writer thread.
+ * @param log logger returned by ldc_log_open()
+ * @param channel channel the sample was read from
+ * @param value conversion result
+ * @param errors error bits of the conversion
+ * @param cmd command value in effect
+ * @param start_ns start of the run (CLOCK_MONOTONIC)
+ * @note No formatting and no system call happen here; the writer thread does both.
+ */
+void log_sample(struct ldc_log *log, int channel, uint32_t value, uint8_t errors, int16_t cmd, uint64_t start_ns) {
+    struct ldc_log_rec rec;
+    rec.t_ns = ldc_now_ns() - start_ns; // elapsed time since t0
+    rec.value = value;
+    rec.cmd = cmd;
+    rec.channel = channel;
+    rec.flags = errors;
+    ldc_log_push(log, &rec); // drops are counted by the logger and reported at the end
+}
+
+/**
+ * @brief When the conversion behind an event finished, on CLOCK_MONOTONIC.
+ * @param t_event time the event source reported, 0 for none
+ * @param t_wake CLOCK_MONOTONIC right after the wait returned
+ * @note Simulated and replayed events are stamped on their own clock, which may run ahead in
+ * virtual mode: the lateness measured on that clock is carried over to t_wake.
+ */
+uint64_t ready_time(struct ldc_bus *bus, uint64_t t_event, uint64_t t_wake) {
+    if (t_event == 0) return t_wake;
+    uint64_t now = t_wake;
+    if (ldc_bus_is_sim(bus)) now = ldc_sim_now_ns(bus);
+    if (ldc_bus_is_replay(bus)) now = ldc_replay_now_ns(bus);
+    return t_wake - ((now > t_event) ? now - t_event : 0);
+}
+
+/**
+ * @brief Closed-loop mode: one PID step and one actuator command per conversion.
+ * @param bus bus the LDC1614 is on, configured for channel
+ * @param channel channel that is regulated
+ * @param setpoint wanted raw sensor value
+ * @param gains kp, ki and kd of the controller
+ * @param duration_s time to run
+ * @param max_cmd command limit, the output stays within +-max_cmd
+ * @param log logger every sample goes to, tagged with the command it produced
+ * @param start_ns start of the run (CLOCK_MONOTONIC)
+ * @return 0 on success, -1 if the event source or the bus failed
+ * @note Nothing in the loop allocates or prints: timing goes into ldc_hist histograms, errors into
+ * sample_errors and samples into the log queue, all reported after the loop. With INTB (or the
+ * simulator) the command leaves a bus transfer and a send after the conversion completes; the
+ * timer fallback can add up to one conversion period.
+ */
+int run_closed_loop(struct ldc_bus *bus, int channel, double setpoint, const double gains[3], double duration_s,
+                    int16_t max_cmd, struct ldc_log *log, uint64_t start_ns) {
+    struct ldc_event_source src;
+    struct ldc1614_channel_config cfg[LDC1614_NUM_CHANNELS] = {{LDC1614_DEFAULT_RCOUNT,
+        LDC1614_DEFAULT_SETTLECOUNT, LDC1614_DEFAULT_CLOCK_DIVIDERS, LDC1614_DEFAULT_DRIVE_CURRENT}};
+    cfg[channel] = cfg[0];
+    uint64_t period_ns = ldc1614_sequence_period_ns(1 << channel, cfg, LDC1614_FREF_HZ);
+    struct ldc_pid pid;
+    struct ldc_hist period_stats = {0}, latency_stats = {0};
+    uint64_t stale = 0, late = 0, bus_errors = 0, send_errors = 0;
+    int16_t cmd = 0;
+
+    if (ldc_bus_is_replay(bus)) {
+        ldc_event_open_replay(&src, bus);
+    } else if (ldc_bus_is_sim(bus)) {
+        ldc_event_open_sim(&src, bus);
+    } else if (ldc_event_open_gpio(&src, LDC_GPIO_CHIP, LDC_INTB_LINE) != 0 &&
+               ldc_event_open_timer(&src, period_ns) != 0) {
+        return -1;
+    }
+    if (ldc_bus_is_recording(bus)) ldc_event_record(&src, bus);
+    ldc_pid_init(&pid, gains[0], gains[1], gains[2], period_ns / 1e9, -max_cmd, max_cmd);
+    syslog(LOG_INFO, "Closed loop on CH%d at %.3f ms per conversion (%s), setpoint %.0f, gains %g/%g/%g",
+           channel, period_ns / 1e6, src.name, setpoint, gains[0], gains[1], gains[2]);
+
+    uint64_t end_ns = ldc_now_ns() + (uint64_t)(duration_s * 1e9);
+    uint64_t prev_ready = 0;
+    int ret = 0;
+    while (ldc_now_ns() < end_ns) {
+        uint64_t t_event = 0;
+        int ev = src.wait(&src, EVENT_TIMEOUT_MS, &t_event);
+        if (ev < 0) {
+            if (errno != ENODATA) ret = -1; // else a replayed trace ended
+            break;
+        }
+        uint64_t t_wake = ldc_now_ns();
+        uint64_t ready = ready_time(bus, t_event, t_wake);
+        struct ldc1614_burst burst;
+        if (ldc1614_read_burst(bus, 1 << channel, &burst) != 0) {
+            bus_errors++;
+            continue;
+        }
+        if (!(burst.status & LDC1614_UNREADCONV(channel))) {
+            stale++; // woken without a new conversion: timeout, or the timer ran ahead
+            continue;
+        }
+        uint8_t errors = burst.errors[channel];
+        ldc_errors_count(&sample_errors, channel, errors);
+        // A watchdog, over- or under-range result is not a position: hold the last command
+        if (!(errors & ((1 << LDC_ERR_WD) | (1 << LDC_ERR_OR) | (1 << LDC_ERR_UR)))) {
+            cmd = (int16_t)lround(ldc_pid_update(&pid, setpoint, burst.value[channel]));
+        }
+        if (send_command(cmd) != 0) send_errors++;
+        uint64_t t_sent = ldc_now_ns();
+
+        ldc_hist_add(&latency_stats, t_sent - ready);
+        if (prev_ready != 0) {
+            ldc_hist_add(&period_stats, ready - prev_ready);
+            if (ready - prev_ready > period_ns + period_ns / 2) late++;
+        }
+        prev_ready = ready;
+        log_sample(log, channel, burst.value[channel], errors, cmd, start_ns);
+    }
+    ldc_event_close(&src);
+    send_command(HOME);
+
+    ldc_hist_print(&period_stats, "Loop period:", stderr);
+    ldc_hist_print(&latency_stats, "Sensor to command:", stderr);
+    fprintf(stderr, "%llu periods over 1.5x the conversion period, %llu stale reads, %llu bus errors, "
+            "%llu failed sends, final integral %.1f\n", (unsigned long long)late, (unsigned long long)stale,
+            (unsigned long long)bus_errors, (unsigned long long)send_errors, pid.integral);
+    return ret;
+}
 
 int main(int argc, char *argv[]) {
 
     // private variables 
     int opt = 0; // option for command line argument parsing
-    int devID = 0x3055; // Device ID for LDC1614
-    int i2c_fd = 0; // File descriptor for LDC1614 I2C bus
+    int devID = LDC1614_DEVICE_ID_VALUE; // Device ID for LDC1614
+    struct ldc_bus bus; // Register access to the LDC1614
+    char bus_spec[128] = LDC_BUS_DEFAULT; // i2c-dev adapter, "wiringpi", "sim[:options]" or a trace
     int channel = 0; // Default channel to use
     uint32_t value = 0; // Variable to hold measurement value
-    uint16_t status = 0; // Variable to hold status register value
     int ret = 0; // Return value for function calls
-    char logfile[50] = "./testing/ldc1614_log.csv"; // default logfile name
-    int log_fd = -1; // File descriptor for log file
+    char logfile[50] = "./testing/ldc1614_log.bin"; // default logfile name, a .csv name logs text
+    struct ldc_log *log = NULL; // Asynchronous log writer
+    uint8_t errors = 0; // Error bits of the last sample
     int num_samples = 500; // default number of samples to read
     int num_steps = 1; // Number of steps for command value increment
     int16_t cmd_inc = 1000; // Increment value for command
     struct timespec start_time; // t0
-    struct timespec current_time; // t 
-    struct timespec elapsed_time; // Timestamp for datalogging (t - t0)
     int start_cmd = 0;
     int end_cmd = 0;
     int16_t cmd_val = 0;
     int16_t max_cmd = 24000; // Maximum command value
+    int closed_loop = 0; // -c: regulate the sensor to a setpoint instead of the staircase
+    double setpoint = 0.0; // closed loop: raw sensor value to hold
+    double gains[3] = {0.0, 0.0, 0.0}; // closed loop: kp, ki, kd
+    double duration_s = 10.0; // closed loop: run time
+    char *script = NULL; // -q: send this command script instead of collecting data
+    int settling = 0; // -S: wait for the signal to settle instead of logging the transient
+    struct ldc_settle settle; // sweep settle detector
+    uint64_t settle_timeout_ns = SETTLE_TIMEOUT_MS * 1000000ULL; // -T: time a step may take to settle
+    struct ldc_hist settle_stats = {0}; // time to settle after each command
+    int settle_timeouts = 0;
 
     // Initialize the timer and logger 
     clock_gettime(CLOCK_MONOTONIC, &start_time); // Start time measurement
+    uint64_t start_ns = ldc_timespec_to_ns(&start_time);
     openlog(NULL, LOG_PERROR, LOG_LOCAL6); // Open syslog for logging
     syslog(LOG_INFO, "Starting LDC1614 data collection program.\n");
 
     // Parse command line arguments for logfile, and number of samples
-    while ((opt = getopt(argc, argv, "hi:b:e:n:l:s:")) != -1) {
+    while ((opt = getopt(argc, argv, "hi:b:e:n:l:s:d:c:k:t:aq:S:T:")) != -1) {
         switch(opt) {
             case 'i':
                 strcpy(ip, optarg); // Set IP address
@@ -124,6 +456,58 @@ int main(int argc, char *argv[]) {
                     return -1; // Exit if invalid number of samples
                 }
                 break;
+            case 'd':
+                strncpy(bus_spec, optarg, sizeof(bus_spec) - 1); // Set LDC1614 bus
+                bus_spec[sizeof(bus_spec) - 1] = '\0';
+                syslog(LOG_INFO, "LDC1614 bus set to: %s\n", bus_spec);
+                break;
+            case 'c':
+                setpoint = strtod(optarg, NULL);
+                closed_loop = 1;
+                syslog(LOG_INFO, "Closed loop, setpoint %.0f", setpoint);
+                break;
+            case 'k':
+                if (sscanf(optarg, "%lf,%lf,%lf", &gains[0], &gains[1], &gains[2]) != 3) {
+                    syslog(LOG_ERR, "Gains must be given as kp,ki,kd.\n");
+                    return -1;
+                }
+                break;
+            case 't':
+                duration_s = strtod(optarg, NULL);
+                if (duration_s <= 0.0) {
+                    syslog(LOG_ERR, "Run time must be greater than 0.\n");
+                    return -1;
+                }
+                break;
+            case 'a':
+                acks = 1;
+                syslog(LOG_INFO, "Command acknowledgements on");
+                break;
+            case 'q':
+                script = optarg;
+                syslog(LOG_INFO, "Command script: %s", script);
+                break;
+            case 'S': {
+                int window = 0;
+                double max_std = 0.0, max_slope = 0.0;
+                if (sscanf(optarg, "%d,%lf,%lf", &window, &max_std, &max_slope) != 3 ||
+                    ldc_settle_init(&settle, window, max_std, max_slope) != 0) {
+                    syslog(LOG_ERR, "Settle criterion must be window,max_std,max_slope with a window of 3 to %d samples.\n",
+                           LDC_SETTLE_MAX_WINDOW);
+                    return -1;
+                }
+                settling = 1;
+                syslog(LOG_INFO, "Settle detection: %d samples, std <= %g counts, slope <= %g counts/sample",
+                       window, max_std, max_slope);
+                break;
+            }
+            case 'T':
+                if (atoi(optarg) <= 0) {
+                    syslog(LOG_ERR, "Settle timeout must be greater than 0 ms.\n");
+                    return -1;
+                }
+                settle_timeout_ns = atoi(optarg) * 1000000ULL;
+                break;
             case 's':
                 num_steps = atoi(optarg);
                 if(num_steps <= 0){
@@ -133,7 +517,7 @@ int main(int argc, char *argv[]) {
                 syslog(LOG_INFO, "Number of steps set to %d", num_steps);
                 break;
             default:
-                fprintf(stderr, "Usage: %s [-i ip] [-b start_cmd] [-e end_cmd] [-l logfile] [-n num_samples] [-v command] [-s number of steps]\n", argv[0]);
+                fprintf(stderr, "Usage: %s [-i ip] [-b start_cmd] [-e end_cmd] [-l logfile] [-n num_samples] [-v command] [-s number of steps] [-d bus] [-c setpoint -k kp,ki,kd [-t seconds]] [-q script] [-a] [-S window,max_std,max_slope [-T timeout_ms]]\n", argv[0]);
                 return -1; // Exit on invalid option
         }
     }
@@ -148,30 +532,34 @@ int main(int argc, char *argv[]) {
     } else{
         syslog(LOG_INFO, "UDP client initialized");
     }
+    UDP_ack_enable(acks);
 
-    /* Get baseline data */
-    send_command(HOME); // Send initial command value to actuater
-    usleep(100000); // Sleep for 100ms to allow actuater to settle
+    // Scripted commands only exercise the actuator, the LDC1614 is not needed
+    if (script != NULL) {
+        ret = run_script(script);
+        if (acks) report_acks();
+        closelog();
+        return ret;
+    }
 
-    // Initialize wiringPi library and get the file descriptor for I2C communication
-    i2c_fd = wiringPiI2CSetup(LDC1614_ADDR);
+    // Open the bus the LDC1614 is on
     uint16_t ID = 0;
 
-    if (i2c_fd == -1) {
+    if (ldc_bus_open(&bus, bus_spec, LDC1614_ADDR) == -1) {
         syslog(LOG_ERR,"Failed to initialize I2C peripheral: %s\n", strerror(errno));
         return -1;
     }
-    syslog(LOG_INFO, "I2C peripheral initialized.\n");
+    syslog(LOG_INFO, "%s bus initialized.\n", bus.name);
 
     // Initialize the LDC1614 for the specified channel 
-    if (ldc1614_init(i2c_fd, channel) != 0) {
+    if (ldc1614_init(&bus, channel) != 0) {
         syslog(LOG_ERR, "Failed to initialize LDC1614 on channel %d: %s\n", channel, strerror(errno));
         return -1;
     }
     syslog(LOG_DEBUG, "LDC1614 initialized on channel %d.\n", channel);
 
     // Read the device ID to confirm communication
-    ret = ldc1614_read_reg(i2c_fd, LDC1614_DEVICE_ID, &ID);
+    ret = ldc1614_read_reg(&bus, LDC1614_DEVICE_ID, &ID);
     if (ret == -1) {
         fprintf(stderr, "Failed to read device ID: %s\n", strerror(errno));
         return -1;
@@ -183,50 +571,54 @@ int main(int argc, char *argv[]) {
         syslog(LOG_INFO, "LDC1614 Device ID: 0x%04X verified\n", ID);
     }
 
-    // Open the log file for writing only, create it if non-existent, and overwrite it if it exists
-    log_fd = open(logfile, O_WRONLY | O_CREAT | O_TRUNC, 0666); // 
-    if (log_fd == -1 ) {
-        fprintf(stderr, "Failed to open log file %s: %s\n", logfile, strerror(errno));
-        return -1; // Exit if log file cannot be opened
+    /* Get baseline data */
+    send_command(HOME); // Send initial command value to actuater
+    if (!settling) {
+        usleep(100000); // Sleep for 100ms to allow actuater to settle
+    } else if (settle_step(&bus, channel, &settle, settle_timeout_ns, HOME, &settle_stats) == 0) {
+        settle_timeouts++;
     }
-    char log_header[] = "Channel,Timestamp,Value,Command\n"; // Header for log file
-    if (write(log_fd, log_header, sizeof(log_header) - 1) == -1) {
-        fprintf(stderr, "Failed to write header to log file: %s\n", strerror(errno));
-        close(log_fd);
-        return -1; // Exit if writing header fails
+
+    // Start the asynchronous logger; the sampling loop only queues records from here on
+    // The binary header records the device setup written by ldc1614_init()
+    struct ldc_log_config log_config = {
+        .start_ns = start_ns,
+        .channel_mask = 1u << channel,
+        .fref_hz = LDC1614_FREF_HZ,
+        .error_config = error_config,
+    };
+    ldc1614_sequence_regs(1 << channel, &log_config.config, &log_config.mux_config);
+    log_config.channels[channel] = (struct ldc1614_channel_config){LDC1614_DEFAULT_RCOUNT,
+        LDC1614_DEFAULT_SETTLECOUNT, LDC1614_DEFAULT_CLOCK_DIVIDERS, LDC1614_DEFAULT_DRIVE_CURRENT};
+    log = ldc_log_open(logfile, ldc_log_format_for(logfile), &log_config);
+    if (log == NULL) {
+        return -1; // Exit if log file cannot be opened
     }
 
  
-    // Get the data from the LDC1614 and log to a file
+    if (closed_loop && run_closed_loop(&bus, channel, setpoint, gains, duration_s, max_cmd, log, start_ns) != 0) {
+        syslog(LOG_ERR, "Closed loop stopped: %s\n", strerror(errno));
+    }
+
+    // Get the data from the LDC1614 and log to a file (open-loop staircase)
     cmd_val = start_cmd; // Initialize command value to start command
     cmd_inc = (end_cmd - start_cmd) / num_steps; // Calculate command increment based on number of steps
-    for(int step = 0; step < num_steps; step++) {
+    struct ldc_error_report error_report = { .interval_ns = ERROR_REPORT_NS, .last_ns = ldc_now_ns() };
+    for(int step = 0; !closed_loop && step < num_steps; step++) {
         if (send_command(cmd_val) == -1) {
             syslog(LOG_ERR, "Failed to send command value %d: %s\n", cmd_val, strerror(errno));
             break;
         }
+        if (settling && settle_step(&bus, channel, &settle, settle_timeout_ns, cmd_val, &settle_stats) == 0) {
+            settle_timeouts++;
+        }
         for(int i=0; i < num_samples; i++) {
-            status = 0;
-            while(status == 0) {
-                ldc1614_read_reg(i2c_fd, LDC1614_STATUS, &status);
-                status = status & 0x08; // Check if data is ready
-            }
-            ret = ldc1614_read_ch0(i2c_fd, &value);
+            ret = read_next_sample(&bus, channel, &value, &errors);
             if (ret == -1) {
                 syslog(LOG_ERR, "Failed to read value: %s\n", strerror(errno));
                 // return -1;
             } else {
-                clock_gettime(CLOCK_MONOTONIC, &current_time); // Get current time for timestamp
-                elapsed_time = get_elapsed_time(start_time, current_time); // Calculate elapsed time
-                char data_line[80]; 
-                int line_length = 0; 
-                line_length =  sprintf( data_line, "%d,%ld.%09ld,%d,%d\n", channel,elapsed_time.tv_sec,elapsed_time.tv_nsec, value, cmd_val); // format data into a string
-                if (write(log_fd, data_line, line_length) == -1) {
-                    syslog(LOG_ERR, "Failed to write data to log file: %s", strerror(errno));
-                    fprintf(stderr, "Failed to write data to log file: %s\n", strerror(errno));
-                    close(log_fd);
-                    return -1; // Exit with error if data write fails
-                }
+                log_sample(log, channel, value, errors, cmd_val, start_ns);
             }
         }
         /* Send home command for zeroing out the actuator */
@@ -234,32 +626,22 @@ int main(int argc, char *argv[]) {
             syslog(LOG_ERR, "Failed to send command value %d: %s\n", HOME, strerror(errno));
             break;
         }
+        if (settling && settle_step(&bus, channel, &settle, settle_timeout_ns, HOME, &settle_stats) == 0) {
+            settle_timeouts++;
+        }
 
         for(int i=0; i < ZERO_SAMPLES ; i++) {
-            status = 0;
-            while(status == 0) {
-                ldc1614_read_reg(i2c_fd, LDC1614_STATUS, &status);
-                status = status & 0x08; // Check if data is ready
-            }
-            ret = ldc1614_read_ch0(i2c_fd, &value);
+            ret = read_next_sample(&bus, channel, &value, &errors);
             if (ret == -1) {
                 syslog(LOG_ERR, "Failed to read value: %s\n", strerror(errno));
                 // return -1;
             } else {
-                clock_gettime(CLOCK_MONOTONIC, &current_time); // Get current time for timestamp
-                elapsed_time = get_elapsed_time(start_time, current_time); // Calculate elapsed time
-                char data_line[80]; 
-                int line_length = 0; 
-                line_length =  sprintf( data_line, "%d,%ld.%09ld,%d,%d\n", channel,elapsed_time.tv_sec,elapsed_time.tv_nsec, value, HOME); // format data into a string
-                if (write(log_fd, data_line, line_length) == -1) {
-                    syslog(LOG_ERR, "Failed to write data to log file: %s", strerror(errno));
-                    fprintf(stderr, "Failed to write data to log file: %s\n", strerror(errno));
-                    close(log_fd);
-                    return -1; // Exit with error if data write fails
-                }
+                log_sample(log, channel, value, errors, HOME, start_ns);
             }
         }
 
+        ldc_errors_report(&sample_errors, &error_report, stderr, ldc_now_ns());
+
         /* update command value */
         cmd_val += cmd_inc;
         if(abs(cmd_val) > max_cmd) {
@@ -268,7 +650,20 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    close(log_fd); 
+    struct ldc_log_stats log_stats;
+    if (ldc_log_close(log, &log_stats) != 0) {
+        syslog(LOG_ERR, "Failed to write data to log file");
+    }
+    syslog(LOG_INFO, "Logged %llu samples in %llu writes, %llu dropped, writer behind %llu times\n",
+           (unsigned long long)log_stats.records, (unsigned long long)log_stats.writes,
+           (unsigned long long)log_stats.dropped, (unsigned long long)log_stats.behind);
+    ldc_errors_dump(&sample_errors, stderr);
+    if (settling) {
+        ldc_hist_print(&settle_stats, "Settle time:", stderr);
+        fprintf(stderr, "%d settle timeouts\n", settle_timeouts);
+    }
+    if (acks) report_acks();
+    ldc_bus_close(&bus);
     syslog(LOG_INFO, "Data collection complete.\n");
     closelog();
     return 0;
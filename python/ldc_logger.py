@@ -9,13 +9,85 @@ import argparse
 SERVER_IP = "127.0.0.1"
 SERVER_PORT = 5432
 
+# --- Streaming Protocol (see ldc_proto.h) ---
+LDC_PROTO_MAGIC = 0x4C
+LDC_PROTO_VERSION = 1
+LDC_OP_LATEST = 0x01
+LDC_OP_TIME = 0x08
+LDC_OP_SUBSCRIBE = 0x10
+LDC_OP_HEARTBEAT = 0x11
+LDC_OP_UNSUBSCRIBE = 0x12
+LDC_OP_BATCH = 0x13
+LEASE_MS = 3000
+
+HDR = struct.Struct("!BBBBI")                # magic, version, opcode, status, req_id
+SUBSCRIBE = struct.Struct("!BBBBIIHHHHI")    # hdr, channel_mask, batch_size, decimation, max_latency_ms, window, lease_ms
+HEARTBEAT = struct.Struct("!BBBBII")         # hdr, acked_batch
+BATCH = struct.Struct("!BBBBIIIHH")          # hdr, batch_seq, dropped, count, reserved
+RECORD = struct.Struct("!BBHIQQ")            # channel, flags, reserved, value, seq, t_ns
+QUERY = struct.Struct("!BBBBIIIQQ")          # hdr, channel_mask, count, start, end
+REPLY = struct.Struct("!BBBBIHBBI")          # hdr, count, fragment, flags, reserved
+TIME = struct.Struct("!BBBBIQQQQ")           # hdr, client_tx_ns, service_rx_ns, service_tx_ns, realtime_ns
+SYNC_WINDOW = 8                              # exchanges the offset is picked from
+SYNC_INTERVAL_S = 1.0
+
+class ClockSync:
+    """Maps service CLOCK_MONOTONIC times onto this host's clock with LDC_OP_TIME exchanges.
+
+    Each exchange bounds the offset within half its network delay; the one with the
+    smallest delay among the last SYNC_WINDOW is used, so a slow round trip does not
+    move the time axis.
+    """
+
+    def __init__(self):
+        self.exchanges = []  # (delay_ns, offset_ns), offset = service clock - host clock
+
+    def request(self, sock, server_addr):
+        sock.sendto(TIME.pack(LDC_PROTO_MAGIC, LDC_PROTO_VERSION, LDC_OP_TIME, 0, 0,
+                              time.time_ns(), 0, 0, 0), server_addr)
+
+    def on_reply(self, data, t4):
+        """Takes a TIME reply received at host time t4 (ns)."""
+        if len(data) < TIME.size:
+            return
+        _, _, _, status, _, t1, t2, t3, _ = TIME.unpack_from(data)
+        if status != 0:
+            return
+        delay = (t4 - t1) - (t3 - t2)
+        offset = ((t2 - t1) + (t3 - t4)) // 2
+        self.exchanges = (self.exchanges + [(delay, offset)])[-SYNC_WINDOW:]
+
+    def sync(self, sock, server_addr, rounds=SYNC_WINDOW):
+        """Blocking exchanges, for before the first samples and between polls."""
+        for _ in range(rounds):
+            self.request(sock, server_addr)
+            try:
+                while True:
+                    data, _ = sock.recvfrom(2048)
+                    t4 = time.time_ns()
+                    if len(data) >= HDR.size and data[0] == LDC_PROTO_MAGIC and data[2] == LDC_OP_TIME:
+                        self.on_reply(data, t4)
+                        break
+            except socket.timeout:
+                print("Warning: no reply to a clock exchange", file=sys.stderr)
+        return self.valid()
+
+    def valid(self):
+        return len(self.exchanges) > 0
+
+    def to_host_ns(self, service_ns):
+        return service_ns - min(self.exchanges)[1]
+
+    def uncertainty_us(self):
+        return min(self.exchanges)[0] / 2e3
+
 def parse_arguments():
     """Configures and parses command-line arguments."""
     parser = argparse.ArgumentParser(
         description="Remote logging client for the LDC1614 frequency sensor service."
     )
     
-     parser.add_argument(
+    parser.add_argument(
         '-i', '--IP',
         type=str,
         default=SERVER_IP,
@@ -42,15 +114,118 @@ def parse_arguments():
         default=1000,
         help="Total number of data points to collect. Default is 1000."
     )
+
+    parser.add_argument(
+        '-s', '--stream',
+        action='store_true',
+        help="Subscribe to the service's sample stream instead of polling (logs every sample)."
+    )
+
+    parser.add_argument(
+        '-c', '--channels',
+        type=str,
+        default="0",
+        help="Comma separated channels to stream. Default is '0'."
+    )
+
+    parser.add_argument(
+        '-d', '--decimation',
+        type=int,
+        default=1,
+        help="Stream every Nth sample of each channel. Default is 1 (full rate)."
+    )
     
     return parser.parse_args()
 
+def stream_log(args):
+    """Subscribes to the sample stream and logs every sample received."""
+    channel_mask = 0
+    for ch in args.channels.split(','):
+        channel_mask |= 1 << int(ch)
+
+    udp_sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    udp_sock.settimeout(1.0)
+    server_addr = (args.IP, SERVER_PORT)
+
+    def subscribe():
+        udp_sock.sendto(SUBSCRIBE.pack(LDC_PROTO_MAGIC, LDC_PROTO_VERSION, LDC_OP_SUBSCRIBE, 0, 1,
+                                       channel_mask, 0, args.decimation, 50, 0, LEASE_MS), server_addr)
+
+    samples_collected = 0
+    last_batch = 0
+    last_seq = {}
+    next_heartbeat = time.time() + LEASE_MS / 3000.0
+    clock = ClockSync()
+
+    try:
+        if not clock.sync(udp_sock, server_addr):
+            print("Error: the service does not answer clock exchanges", file=sys.stderr)
+            return
+        print(f"Service clock offset known to +/-{clock.uncertainty_us():.1f} us")
+        print(f"Opening log file '{args.filename}'...")
+        with open(args.filename, mode='w', newline='') as csv_file:
+            csv_writer = csv.writer(csv_file)
+            # Timestamp is the service's acquisition time, HostTime the same instant on this host's clock
+            csv_writer.writerow(['Channel', 'Seq', 'Timestamp', 'Freq', 'Flags', 'HostTime', 'Latency_us'])
+
+            subscribe()
+            print("Streaming started...")
+            while samples_collected < args.samples:
+                if time.time() >= next_heartbeat:
+                    udp_sock.sendto(HEARTBEAT.pack(LDC_PROTO_MAGIC, LDC_PROTO_VERSION, LDC_OP_HEARTBEAT, 0, 0,
+                                                   last_batch), server_addr)
+                    clock.request(udp_sock, server_addr)  # answered among the batches
+                    next_heartbeat = time.time() + LEASE_MS / 3000.0
+                try:
+                    data, _ = udp_sock.recvfrom(2048)
+                    t_recv = time.time_ns()
+                except socket.timeout:
+                    print("Warning: No data from service, resubscribing...", file=sys.stderr)
+                    subscribe()
+                    continue
+
+                magic, _, opcode, status, _ = HDR.unpack_from(data)
+                if magic != LDC_PROTO_MAGIC:
+                    continue
+                if opcode == LDC_OP_HEARTBEAT and status != 0:
+                    subscribe()  # lease expired on the service side
+                    continue
+                if opcode == LDC_OP_TIME:
+                    clock.on_reply(data, t_recv)
+                    continue
+                if opcode != LDC_OP_BATCH:
+                    continue
+
+                _, _, _, _, _, batch_seq, dropped, count, _ = BATCH.unpack_from(data)
+                last_batch = batch_seq
+                for i in range(count):
+                    ch, flags, _, value, seq, t_ns = RECORD.unpack_from(data, BATCH.size + i * RECORD.size)
+                    if ch in last_seq and seq != last_seq[ch] + args.decimation:
+                        print(f"Warning: gap on channel {ch} before seq {seq} ({dropped} dropped)", file=sys.stderr)
+                    last_seq[ch] = seq
+                    host_ns = clock.to_host_ns(t_ns)
+                    csv_writer.writerow([ch, seq, f"{t_ns / 1e9:.9f}", value, flags, f"{host_ns / 1e9:.9f}",
+                                         f"{(t_recv - host_ns) / 1e3:.1f}"])
+                    samples_collected += 1
+
+        print(f"\nSuccessfully logged {samples_collected} data points.")
+
+    except KeyboardInterrupt:
+        print(f"\nLogging execution interrupted by user. Saved {samples_collected} points.")
+    finally:
+        udp_sock.sendto(HDR.pack(LDC_PROTO_MAGIC, LDC_PROTO_VERSION, LDC_OP_UNSUBSCRIBE, 0, 0), server_addr)
+        udp_sock.close()
+        print("UDP socket closed. Safe to exit.")
+
 def main():
     args = parse_arguments()
+    if args.stream:
+        stream_log(args)
+        return
     
     # Map arguments to local variables
     poll_interval_sec = args.period / 1000.0  # Convert ms input to seconds
-    filename = args.output
+    filename = args.filename
     total_samples = args.samples
     
     print("Initializing LDC1614 Remote Logger...")
@@ -62,33 +237,47 @@ def main():
     server_addr = (args.IP, SERVER_PORT)
     
     samples_collected = 0
+    clock = ClockSync()
+    latest = QUERY.pack(LDC_PROTO_MAGIC, LDC_PROTO_VERSION, LDC_OP_LATEST, 0, 0, 0x01, 0, 0, 0)
     
     try:
+        if not clock.sync(udp_sock, server_addr):
+            print("Error: the service does not answer clock exchanges", file=sys.stderr)
+            return
+        print(f"Service clock offset known to +/-{clock.uncertainty_us():.1f} us")
         print(f"Opening log file '{filename}'...")
         with open(filename, mode='w', newline='') as csv_file:
             csv_writer = csv.writer(csv_file)
             
-            # Write the header line
-            csv_writer.writerow(['Timestamp', 'Freq'])
+            # Write the header line: Timestamp is when the sample was acquired, on this host's clock
+            csv_writer.writerow(['Timestamp', 'Freq', 'Latency_us'])
             
             print("Logging started...")
             next_time = time.time()
+            next_sync = next_time + SYNC_INTERVAL_S
             
             while samples_collected < total_samples:
                 try:
-                    # Request data from service
-                    udp_sock.sendto(b'\x00', server_addr)
+                    if time.time() >= next_sync:
+                        clock.sync(udp_sock, server_addr, 1)  # one exchange per interval keeps the window fresh
+                        next_sync = time.time() + SYNC_INTERVAL_S
+
+                    # Request the newest CH0 sample with its acquisition time
+                    udp_sock.sendto(latest, server_addr)
                     
                     # Receive data from service
                     data, _ = udp_sock.recvfrom(1024)
-                    timestamp = time.time() 
+                    t_recv = time.time_ns()
                     
-                    if len(data) == 4:
-                        freq_val = struct.unpack("!I", data)[0]
+                    if len(data) >= REPLY.size + RECORD.size and data[2] == LDC_OP_LATEST:
+                        _, _, _, value, _, t_ns = RECORD.unpack_from(data, REPLY.size)
+                        host_ns = clock.to_host_ns(t_ns)
                         
                         # Log to CSV file
-                        csv_writer.writerow([timestamp, freq_val])
+                        csv_writer.writerow([f"{host_ns / 1e9:.9f}", value, f"{(t_recv - host_ns) / 1e3:.1f}"])
                         samples_collected += 1
+                    elif len(data) >= HDR.size and data[2] == LDC_OP_LATEST:
+                        print("Warning: no sample acquired yet", file=sys.stderr)
                     else:
                         print(f"Warning: Received payload of unexpected size ({len(data)} bytes)", file=sys.stderr)
                         